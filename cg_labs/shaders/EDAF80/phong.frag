@@ -4,15 +4,23 @@
 uniform vec3 light_position;
 uniform vec3 camera_position;
 
-uniform vec3 ambient_colour;
-uniform vec3 diffuse_colour;
-uniform vec3 specular_colour;
-
-uniform float shininess_value;
-uniform float index_of_refraction_value;
-uniform float opacity_value;
-
-uniform mat4 normal_model_to_world;
+layout (std140) uniform MaterialConstants
+{
+	vec3 diffuse_colour;
+	float shininess_value;
+	vec3 specular_colour;
+	float index_of_refraction_value;
+	vec3 ambient_colour;
+	float opacity_value;
+	vec3 emissive_colour;
+};
+
+layout (std140) uniform ObjectTransforms
+{
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+	mat4 vertex_world_to_clip;
+};
 
 uniform bool use_normal_mapping;
 
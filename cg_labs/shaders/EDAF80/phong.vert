@@ -7,9 +7,12 @@ layout (location = 3) in vec3 tangent;
 layout (location = 4) in vec3 binormal;
 
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
+layout (std140) uniform ObjectTransforms
+{
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+	mat4 vertex_world_to_clip;
+};
 
 uniform vec3 light_position;
 uniform vec3 camera_position;
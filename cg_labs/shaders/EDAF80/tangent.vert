@@ -3,9 +3,12 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 3) in vec3 tangent;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
+layout (std140) uniform ObjectTransforms
+{
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+	mat4 vertex_world_to_clip;
+};
 
 out VS_OUT {
 	vec3 tangent;
@@ -7,7 +7,12 @@ uniform sampler2D water_texture;
 uniform sampler2D normal_texture;
 uniform samplerCube cubemap;
 
-uniform mat4 normal_model_to_world;  // inverse-transpose of model
+layout (std140) uniform ObjectTransforms
+{
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+	mat4 vertex_world_to_clip;
+};
 
 uniform float t;
 
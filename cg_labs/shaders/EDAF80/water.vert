@@ -5,9 +5,12 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texcoord;
 
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
-uniform mat4 normal_model_to_world;
+layout (std140) uniform ObjectTransforms
+{
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+	mat4 vertex_world_to_clip;
+};
 
 uniform float t;
 
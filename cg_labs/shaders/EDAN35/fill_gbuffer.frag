@@ -4,10 +4,12 @@ uniform bool has_diffuse_texture;
 uniform bool has_specular_texture;
 uniform bool has_normals_texture;
 uniform bool has_opacity_texture;
+uniform bool has_lightmap;
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D normals_texture;
 uniform sampler2D opacity_texture;
+uniform sampler2D lightmap_texture;
 uniform mat4 normal_model_to_world;
 
 in VS_OUT {
@@ -15,6 +17,7 @@ in VS_OUT {
 	vec2 texcoord;
 	vec3 tangent;
 	vec3 binormal;
+	vec2 lightmap_texcoord;
 } fs_in;
 
 layout (location = 0) out vec4 geometry_diffuse;
@@ -32,6 +35,9 @@ void main()
 	if (has_diffuse_texture)
 		geometry_diffuse = texture(diffuse_texture, fs_in.texcoord);
 
+	// Baked ambient occlusion, in the otherwise unused alpha channel
+	geometry_diffuse.a = has_lightmap ? texture(lightmap_texture, fs_in.lightmap_texcoord).r : 1.0;
+
 	// Specular color
 	geometry_specular = vec4(0.0f);
 	if (has_specular_texture)
@@ -43,7 +49,7 @@ void main()
 	vec3 B = normalize(fs_in.binormal);
 	mat3 TBN = mat3(T, B, N) ;
 	
-	if (has_normals_texture) 
+	if (has_normals_texture) {
 		vec3 N_map = texture(normals_texture, fs_in.texcoord).xyz * 2.0 - 1; 
 		vec3 N = normalize(TBN * N_map);
 		geometry_normal = vec4(N * 0.5 + 0.5, 0.0);
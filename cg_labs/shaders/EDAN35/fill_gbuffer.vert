@@ -16,22 +16,26 @@ uniform mat4 vertex_model_to_world;
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
-layout (location = 4) in vec3 binormal;
+layout (location = 3) in vec4 tangent;  // w is the handedness, with packed normals
+layout (location = 4) in vec3 binormal; // all zeros with packed normals
+layout (location = 5) in vec2 lightmap_texcoord;
 
 out VS_OUT {
 	vec3 normal;
 	vec2 texcoord;
 	vec3 tangent;
 	vec3 binormal;
+	vec2 lightmap_texcoord;
 } vs_out;
 
 
 void main() {
 	vs_out.normal   = normalize(normal);
 	vs_out.texcoord = texcoord.xy;
-	vs_out.tangent  = normalize(tangent);
-	vs_out.binormal = normalize(binormal);
+	vs_out.tangent  = normalize(tangent.xyz);
+	vs_out.binormal = dot(binormal, binormal) > 0.0 ? normalize(binormal)
+	                                                : cross(vs_out.normal, vs_out.tangent) * sign(tangent.w);
+	vs_out.lightmap_texcoord = lightmap_texcoord;
 
 	gl_Position = camera.view_projection * vertex_model_to_world * vec4(vertex, 1.0);
 }
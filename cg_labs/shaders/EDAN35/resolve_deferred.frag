@@ -13,12 +13,13 @@ void main()
 {
 	ivec2 pixel_coord = ivec2(gl_FragCoord.xy);
 
-	vec3 diffuse  = texelFetch(diffuse_texture,  pixel_coord, 0).rgb;
+	vec4 diffuse_ao = texelFetch(diffuse_texture,  pixel_coord, 0);
+	vec3 diffuse  = diffuse_ao.rgb;
 	vec3 specular = texelFetch(specular_texture, pixel_coord, 0).rgb;
 
 	vec3 light_d  = texelFetch(light_d_texture,  pixel_coord, 0).rgb;
 	vec3 light_s  = texelFetch(light_s_texture,  pixel_coord, 0).rgb;
 	const vec3 ambient = vec3(0.15);
 
-	frag_color =  vec4((ambient + light_d) * diffuse + light_s * specular, 1.0);
+	frag_color =  vec4((ambient * diffuse_ao.a + light_d) * diffuse + light_s * specular, 1.0);
 }
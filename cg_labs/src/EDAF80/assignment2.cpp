@@ -5,7 +5,9 @@
 #include "config.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
+#include "core/GLStateCache.hpp"
 #include "core/node.hpp"
+#include "core/RenderQueue.hpp"
 #include "core/ShaderProgramManager.hpp"
 #include <imgui.h>
 
@@ -160,6 +162,9 @@ edaf80::Assignment2::run()
 	}
 
 
+	RenderQueue render_queue;
+
+
 	auto lastTime = std::chrono::high_resolution_clock::now();
 
 	std::int32_t program_index = 0;
@@ -228,12 +233,13 @@ edaf80::Assignment2::run()
 			}
 		}
 
-		circle_rings.render(mCamera.GetWorldToClipMatrix());
+		circle_rings.submit(render_queue, mCamera.GetWorldToClipMatrix());
 		if (show_control_points) {
 			for (auto const& control_point : control_points) {
-				control_point.render(mCamera.GetWorldToClipMatrix());
+				control_point.submit(render_queue, mCamera.GetWorldToClipMatrix());
 			}
 		}
+		render_queue.execute();
 
 		bool const opened = ImGui::Begin("Scene Controls", nullptr, ImGuiWindowFlags_None);
 		if (opened) {
@@ -255,6 +261,14 @@ edaf80::Assignment2::run()
 			ImGui::Checkbox("Show basis", &show_basis);
 			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
 			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
+			ImGui::Separator();
+			auto const& render_stats = render_queue.get_stats();
+			ImGui::Text("Draws: %zu", render_stats.draws);
+			ImGui::Text("State changes: %zu (%zu programs, %zu textures, %zu vertex arrays)",
+			            render_stats.state_changes(), render_stats.program_changes,
+			            render_stats.texture_changes, render_stats.vertex_array_changes);
+			auto const& state_stats = utils::opengl::state::getFrameStats();
+			ImGui::Text("Binding calls: %zu issued, %zu redundant ones skipped", state_stats.issued, state_stats.elided);
 		}
 		ImGui::End();
 
@@ -3,10 +3,14 @@
 #define GLM_FORCE_PURE 1
 
 #include "assignment2.hpp"
+#include "lightmap.hpp"
+#include "multi_draw.hpp"
 
 #include "config.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
+#include "core/FrustumCuller.hpp"
+#include "core/GLStateCache.hpp"
 #include "core/helpers.hpp"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
@@ -20,8 +24,11 @@
 
 #include <array>
 #include <clocale>
+#include <cstdint>
 #include <cstdlib>
+#include <numeric>
 #include <stdexcept>
+#include <vector>
 
 namespace constant
 {
@@ -30,6 +37,8 @@ namespace constant
 
 	constexpr float  scale_lengths       = 100.0f; // The scene is expressed in centimetres rather than metres, hence the x100.
 
+	constexpr bool   share_sponza_buffers = true; // Store all Sponza meshes in the same buffers, so that they can be multi-drawn.
+
 	constexpr size_t lights_nb           = 4;
 	constexpr float  light_intensity     = 72.0f * (scale_lengths * scale_lengths);
 	constexpr float  light_angle_falloff = glm::radians(37.0f);
@@ -124,6 +133,8 @@ namespace
 		GLuint has_specular_texture{ 0u };
 		GLuint has_normals_texture{ 0u };
 		GLuint has_opacity_texture{ 0u };
+		GLuint lightmap_texture{ 0u };
+		GLuint has_lightmap{ 0u };
 	};
 	void fillGBufferShaderLocations(GLuint gbuffer_shader, GBufferShaderLocations& locations);
 
@@ -185,39 +196,13 @@ edan35::Assignment2::~Assignment2()
 void
 edan35::Assignment2::run()
 {
-	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects(config::resources_path("sponza/sponza.obj"));
-	if (sponza_geometry.empty()) {
-		LogError("Failed to load the Sponza model");
-		return;
-	}
-	std::vector<GeometryTextureData> sponza_geometry_texture_data;
-	sponza_geometry_texture_data.reserve(sponza_geometry.size());
-	for (auto const& geometry : sponza_geometry) {
-		auto const diffuse_texture = geometry.bindings.find("diffuse_texture");
-		auto const specular_texture = geometry.bindings.find("specular_texture");
-		auto const normals_texture = geometry.bindings.find("normals_texture");
-		auto const opacity_texture = geometry.bindings.find("opacity_texture");
-
-		GeometryTextureData data;
-		if (diffuse_texture != geometry.bindings.end())
-		{
-			data.diffuse_texture_id = diffuse_texture->second;
-		}
-		if (specular_texture != geometry.bindings.end())
-		{
-			data.specular_texture_id = specular_texture->second;
-		}
-		if (normals_texture != geometry.bindings.end())
-		{
-			data.normals_texture_id = normals_texture->second;
-		}
-		if (opacity_texture != geometry.bindings.end())
-		{
-			data.opacity_texture_id = opacity_texture->second;
-		}
-		sponza_geometry_texture_data.emplace_back(std::move(data));
-	}
+	// Start loading Sponza in the background: the file is read while the
+	// OpenGL objects and shader programs below are created, and its
+	// textures keep streaming in once the window is up.
+	// Interleaved, packed vertices: `fill_gbuffer.vert` rebuilds the
+	// binormals from the tangents.
+	auto sponza_loading = bonobo::loadObjectsAsync(config::resources_path("sponza/sponza.obj"), constant::share_sponza_buffers,
+	                                               bonobo::vertex_format::compact());
 
 	auto const cone_geometry = loadCone();
 	Node cone;
@@ -313,6 +298,73 @@ edan35::Assignment2::run()
 		return;
 	}
 
+	// Load the geometry of Sponza
+	auto const sponza_geometry = sponza_loading.get();
+	if (sponza_geometry.empty()) {
+		LogError("Failed to load the Sponza model");
+		return;
+	}
+	std::vector<GeometryTextureData> sponza_geometry_texture_data;
+	sponza_geometry_texture_data.reserve(sponza_geometry.size());
+	for (auto const& geometry : sponza_geometry) {
+		auto const diffuse_texture = geometry.bindings.find("diffuse_texture");
+		auto const specular_texture = geometry.bindings.find("specular_texture");
+		auto const normals_texture = geometry.bindings.find("normals_texture");
+		auto const opacity_texture = geometry.bindings.find("opacity_texture");
+
+		GeometryTextureData data;
+		if (diffuse_texture != geometry.bindings.end())
+		{
+			data.diffuse_texture_id = diffuse_texture->second;
+		}
+		if (specular_texture != geometry.bindings.end())
+		{
+			data.specular_texture_id = specular_texture->second;
+		}
+		if (normals_texture != geometry.bindings.end())
+		{
+			data.normals_texture_id = normals_texture->second;
+		}
+		if (opacity_texture != geometry.bindings.end())
+		{
+			data.opacity_texture_id = opacity_texture->second;
+		}
+		sponza_geometry_texture_data.emplace_back(std::move(data));
+	}
+
+	// Ambient occlusion baked by EDAN35_LightmapBaker, sampled through a
+	// second set of texcoords; without it, the ambient term is unoccluded.
+	GLuint lightmap_texture = 0u;
+	std::vector<GLuint> lightmap_buffers(sponza_geometry.size(), 0u);
+	lightmap::atlas lightmap_atlas;
+	if (lightmap::readAtlas(config::resources_path("sponza/sponza.lightmap"), lightmap_atlas)) {
+		lightmap_texture = bonobo::loadTexture2D(config::resources_path("sponza/sponza_ao.png"), false);
+		if (lightmap_texture != 0u)
+			lightmap_buffers = lightmap::attachTexcoords(sponza_geometry, lightmap_atlas);
+	}
+	if (lightmap_texture == 0u)
+		LogInfo("No baked ambient occlusion found for Sponza; run EDAN35_LightmapBaker to create it.");
+
+	// Meshes binding the same textures are drawn together by a single
+	// multi-draw call; the shadow maps only need the opacity texture.
+	auto sponza_gbuffer_pass = multi_draw::createPass(sponza_geometry, [&](std::size_t i){
+		auto const& texture_data = sponza_geometry_texture_data[i];
+		return std::vector<GLuint>{ texture_data.diffuse_texture_id, texture_data.specular_texture_id,
+		                            texture_data.normals_texture_id, texture_data.opacity_texture_id,
+		                            lightmap_buffers[i] != 0u ? 1u : 0u };
+	});
+	auto sponza_shadowmap_pass = multi_draw::createPass(sponza_geometry, [&](std::size_t i){
+		return std::vector<GLuint>{ sponza_geometry_texture_data[i].opacity_texture_id };
+	});
+	LogInfo("Sponza is drawn with %zu multi-draw calls in the g-buffer pass and %zu per shadow map, instead of %zu draws.",
+	        sponza_gbuffer_pass.batches.size(), sponza_shadowmap_pass.batches.size(), sponza_geometry.size());
+
+	// Sponza meshes outside of the camera's or a light's frustum are
+	// skipped by the corresponding pass.
+	FrustumCuller sponza_culler;
+	sponza_culler.set_boxes(sponza_geometry);
+	std::vector<std::uint32_t> visible_sponza_meshes;
+
 	auto const set_uniforms = [](GLuint /*program*/){};
 
 	ViewProjTransforms camera_view_proj_transforms;
@@ -321,10 +373,10 @@ edan35::Assignment2::run()
 	const GLuint debug_texture_id = bonobo::getDebugTextureID();
 
 	auto const bind_texture_with_sampler = [](GLenum target, unsigned int slot, GLuint program, std::string const& name, GLuint texture, GLuint sampler){
-		glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTexture(target, texture);
-		glUniform1i(glGetUniformLocation(program, name.c_str()), static_cast<GLint>(slot));
-		glBindSampler(slot, sampler);
+		utils::opengl::state::activeTexture(GL_TEXTURE0 + slot);
+		utils::opengl::state::bindTexture(target, texture);
+		glUniform1i(ShaderProgramManager::GetUniformLocation(program, name), static_cast<GLint>(slot));
+		utils::opengl::state::bindSampler(slot, sampler);
 	};
 
 
@@ -362,7 +414,7 @@ edan35::Assignment2::run()
 	glEnable(GL_CULL_FACE);
 
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+	utils::opengl::state::bindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
 
 
 	auto seconds_nb = 0.0f;
@@ -377,9 +429,27 @@ edan35::Assignment2::run()
 	bool copy_elapsed_times = true;
 	bool first_frame = true;
 	bool show_basis = false;
+	bool use_multi_draw = constant::share_sponza_buffers;
+	bool use_frustum_culling = true;
+	FrustumCuller::Stats gbuffer_culling_stats;
+	std::array<FrustumCuller::Stats, constant::lights_nb> shadowmap_culling_stats;
 	float basis_thickness_scale = 40.0f;
 	float basis_length_scale = 400.0f;
 
+	auto const find_visible_sponza_meshes = [&](glm::mat4 const& world_to_clip, multi_draw::pass& pass){
+		FrustumCuller::Stats stats;
+		if (use_frustum_culling) {
+			stats = sponza_culler.cull(world_to_clip, visible_sponza_meshes);
+		} else {
+			visible_sponza_meshes.resize(sponza_geometry.size());
+			std::iota(visible_sponza_meshes.begin(), visible_sponza_meshes.end(), 0u);
+			stats.tested = sponza_geometry.size();
+		}
+		if (use_multi_draw)
+			multi_draw::setVisibleMeshes(pass, visible_sponza_meshes);
+		return stats;
+	};
+
 	while (!glfwWindowShouldClose(window)) {
 		auto const nowTime = std::chrono::high_resolution_clock::now();
 		auto const deltaTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(nowTime - lastTime);
@@ -460,25 +530,25 @@ edan35::Assignment2::run()
 			utils::opengl::debug::beginDebugGroup("Fill G-buffer");
 			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
+			utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
 			glViewport(0, 0, framebuffer_width, framebuffer_height);
 			glClear(GL_DEPTH_BUFFER_BIT);
 			// XXX: Is any other clearing needed?
 			glClear(GL_COLOR_BUFFER_BIT);
 
 
-			glUseProgram(fill_gbuffer_shader);
+			utils::opengl::state::useProgram(fill_gbuffer_shader);
 			glUniform1i(fill_gbuffer_shader_locations.diffuse_texture, 0);
 			glUniform1i(fill_gbuffer_shader_locations.specular_texture, 1);
 			glUniform1i(fill_gbuffer_shader_locations.normals_texture, 2);
 			glUniform1i(fill_gbuffer_shader_locations.opacity_texture, 3);
-			for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
-			{
-				auto const& geometry = sponza_geometry[i];
+			glUniform1i(fill_gbuffer_shader_locations.lightmap_texture, 4);
+			utils::opengl::state::bindSampler(4u, samplers[toU(Sampler::Linear)]);
+			utils::opengl::state::activeTexture(GL_TEXTURE4);
+			utils::opengl::state::bindTexture(GL_TEXTURE_2D, lightmap_texture != 0u ? lightmap_texture : debug_texture_id);
+			auto const set_gbuffer_state = [&](std::size_t i){
 				auto const& texture_data = sponza_geometry_texture_data[i];
 
-				utils::opengl::debug::beginDebugGroup(geometry.name);
-
 				auto const vertex_model_to_world = glm::mat4(1.0f);
 				auto const normal_model_to_world = glm::mat4(1.0f);
 
@@ -489,37 +559,59 @@ edan35::Assignment2::run()
 				auto const mipmap_sampler = samplers[toU(Sampler::Mipmaps)];
 
 				glUniform1i(fill_gbuffer_shader_locations.has_diffuse_texture, texture_data.diffuse_texture_id != 0u ? 1 : 0);
-				glBindSampler(0u, texture_data.diffuse_texture_id != 0u ? mipmap_sampler : default_sampler);
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, texture_data.diffuse_texture_id != 0u ? texture_data.diffuse_texture_id : debug_texture_id);
+				utils::opengl::state::bindSampler(0u, texture_data.diffuse_texture_id != 0u ? mipmap_sampler : default_sampler);
+				utils::opengl::state::activeTexture(GL_TEXTURE0);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_data.diffuse_texture_id != 0u ? texture_data.diffuse_texture_id : debug_texture_id);
 
 				glUniform1i(fill_gbuffer_shader_locations.has_specular_texture, texture_data.specular_texture_id != 0u ? 1 : 0);
-				glBindSampler(1u, texture_data.specular_texture_id != 0u ? mipmap_sampler : default_sampler);
-				glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, texture_data.specular_texture_id != 0u ? texture_data.specular_texture_id : debug_texture_id);
+				utils::opengl::state::bindSampler(1u, texture_data.specular_texture_id != 0u ? mipmap_sampler : default_sampler);
+				utils::opengl::state::activeTexture(GL_TEXTURE1);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_data.specular_texture_id != 0u ? texture_data.specular_texture_id : debug_texture_id);
 
 				glUniform1i(fill_gbuffer_shader_locations.has_normals_texture, texture_data.normals_texture_id != 0u ? 1 : 0);
-				glBindSampler(2u, texture_data.normals_texture_id != 0u ? mipmap_sampler : default_sampler);
-				glActiveTexture(GL_TEXTURE2);
-				glBindTexture(GL_TEXTURE_2D, texture_data.normals_texture_id != 0u ? texture_data.normals_texture_id : debug_texture_id);
+				utils::opengl::state::bindSampler(2u, texture_data.normals_texture_id != 0u ? mipmap_sampler : default_sampler);
+				utils::opengl::state::activeTexture(GL_TEXTURE2);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_data.normals_texture_id != 0u ? texture_data.normals_texture_id : debug_texture_id);
 
 				glUniform1i(fill_gbuffer_shader_locations.has_opacity_texture, texture_data.opacity_texture_id != 0u ? 1 : 0);
-				glBindSampler(3u, texture_data.opacity_texture_id != 0u ? mipmap_sampler : default_sampler);
-				glActiveTexture(GL_TEXTURE3);
-				glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
+				utils::opengl::state::bindSampler(3u, texture_data.opacity_texture_id != 0u ? mipmap_sampler : default_sampler);
+				utils::opengl::state::activeTexture(GL_TEXTURE3);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
+
+				glUniform1i(fill_gbuffer_shader_locations.has_lightmap, lightmap_buffers[i] != 0u ? 1 : 0);
+			};
+			gbuffer_culling_stats = find_visible_sponza_meshes(view_projection, sponza_gbuffer_pass);
+			if (use_multi_draw) {
+				for (auto const& batch : sponza_gbuffer_pass.batches) {
+					if (batch.counts.empty())
+						continue;
+					set_gbuffer_state(batch.first_mesh);
+					multi_draw::draw(sponza_gbuffer_pass, batch);
+				}
+			} else {
+				for (auto const i : visible_sponza_meshes)
+				{
+					auto const& geometry = sponza_geometry[i];
 
-				glBindVertexArray(geometry.vao);
-				if (geometry.ibo != 0u)
-					glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-				else
-					glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
+					utils::opengl::debug::beginDebugGroup(geometry.name);
 
+					set_gbuffer_state(i);
 
-				utils::opengl::debug::endDebugGroup();
+					utils::opengl::state::bindVertexArray(geometry.vao);
+					if (geometry.ibo != 0u)
+						glDrawElementsBaseVertex(geometry.drawing_mode, geometry.indices_nb, geometry.index_type,
+						                         reinterpret_cast<GLvoid const*>(static_cast<std::uintptr_t>(geometry.first_index) * bonobo::getIndexSize(geometry.index_type)),
+						                         geometry.base_vertex);
+					else
+						glDrawArrays(geometry.drawing_mode, geometry.base_vertex, geometry.vertices_nb);
+
+					utils::opengl::debug::endDebugGroup();
+				}
 			}
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glBindVertexArray(0u);
-			glUseProgram(0u);
+			utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0);
+			utils::opengl::state::bindSampler(4u, 0u);
+			utils::opengl::state::bindVertexArray(0u);
+			utils::opengl::state::useProgram(0u);
 
 			glEndQuery(GL_TIME_ELAPSED);
 			utils::opengl::debug::endDebugGroup();
@@ -529,7 +621,7 @@ edan35::Assignment2::run()
 			//
 			// Pass 2: Generate shadowmaps and accumulate lights' contribution
 			//
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
+			utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
 			glViewport(0, 0, framebuffer_width, framebuffer_height);
 			// XXX: Is any clearing needed?
 			glClear(GL_COLOR_BUFFER_BIT);
@@ -547,41 +639,56 @@ edan35::Assignment2::run()
 				utils::opengl::debug::beginDebugGroup("Create shadow map " + std::to_string(i));
 				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i]);
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
+				utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
 				glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
 				// XXX: Is any clearing needed?
 				glClear(GL_DEPTH_BUFFER_BIT);
 
-				glUseProgram(fill_shadowmap_shader);
+				utils::opengl::state::useProgram(fill_shadowmap_shader);
 				glUniform1i(fill_shadowmap_shader_locations.light_index, static_cast<int>(i));
 				glUniform1i(fill_shadowmap_shader_locations.opacity_texture, 0);
-				for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
-				{
-					auto const& geometry = sponza_geometry[i];
+				auto const set_shadowmap_state = [&](std::size_t i){
 					auto const& texture_data = sponza_geometry_texture_data[i];
 
-					utils::opengl::debug::beginDebugGroup(geometry.name);
-
 					auto const vertex_model_to_world = glm::mat4(1.0f);
 					glUniformMatrix4fv(fill_shadowmap_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
 
 					glUniform1i(fill_shadowmap_shader_locations.has_opacity_texture, texture_data.opacity_texture_id != 0u ? 1 : 0);
-					glBindSampler(0u, texture_data.opacity_texture_id != 0u ? samplers[toU(Sampler::Mipmaps)] : samplers[toU(Sampler::Nearest)]);
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
-
-					glBindVertexArray(geometry.vao);
-					if (geometry.ibo != 0u)
-						glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-					else
-						glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
-
-
-					utils::opengl::debug::endDebugGroup();
+					utils::opengl::state::bindSampler(0u, texture_data.opacity_texture_id != 0u ? samplers[toU(Sampler::Mipmaps)] : samplers[toU(Sampler::Nearest)]);
+					utils::opengl::state::activeTexture(GL_TEXTURE0);
+					utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
+				};
+				shadowmap_culling_stats[i] = find_visible_sponza_meshes(light_world_to_clip_matrix, sponza_shadowmap_pass);
+				if (use_multi_draw) {
+					for (auto const& batch : sponza_shadowmap_pass.batches) {
+						if (batch.counts.empty())
+							continue;
+						set_shadowmap_state(batch.first_mesh);
+						multi_draw::draw(sponza_shadowmap_pass, batch);
+					}
+				} else {
+					for (auto const i : visible_sponza_meshes)
+					{
+						auto const& geometry = sponza_geometry[i];
+
+						utils::opengl::debug::beginDebugGroup(geometry.name);
+
+						set_shadowmap_state(i);
+
+						utils::opengl::state::bindVertexArray(geometry.vao);
+						if (geometry.ibo != 0u)
+							glDrawElementsBaseVertex(geometry.drawing_mode, geometry.indices_nb, geometry.index_type,
+							                         reinterpret_cast<GLvoid const*>(static_cast<std::uintptr_t>(geometry.first_index) * bonobo::getIndexSize(geometry.index_type)),
+							                         geometry.base_vertex);
+						else
+							glDrawArrays(geometry.drawing_mode, geometry.base_vertex, geometry.vertices_nb);
+
+						utils::opengl::debug::endDebugGroup();
+					}
 				}
-				glBindTexture(GL_TEXTURE_2D, 0);
-				glBindVertexArray(0u);
-				glUseProgram(0u);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0);
+				utils::opengl::state::bindVertexArray(0u);
+				utils::opengl::state::useProgram(0u);
 
 				glEndQuery(GL_TIME_ELAPSED);
 				utils::opengl::debug::endDebugGroup();
@@ -598,8 +705,8 @@ edan35::Assignment2::run()
 				utils::opengl::debug::beginDebugGroup("Accumulate light " + std::to_string(i));
 				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Light0Accumulation) + i]);
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
-				glUseProgram(accumulate_lights_shader);
+				utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
+				utils::opengl::state::useProgram(accumulate_lights_shader);
 				glViewport(0, 0, framebuffer_width, framebuffer_height);
 				// XXX: Is any clearing needed?
 				//glClear(GL_COLOR_BUFFER_BIT);
@@ -617,29 +724,29 @@ edan35::Assignment2::run()
 				glUniform1f(accumulate_light_shader_locations.light_intensity, constant::light_intensity);
 				glUniform1f(accumulate_light_shader_locations.light_angle_falloff, constant::light_angle_falloff);
 
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
+				utils::opengl::state::activeTexture(GL_TEXTURE0);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
 				glUniform1i(accumulate_light_shader_locations.depth_texture, 0);
-				glBindSampler(0, samplers[toU(Sampler::Linear)]);
+				utils::opengl::state::bindSampler(0, samplers[toU(Sampler::Linear)]);
 
-				glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
+				utils::opengl::state::activeTexture(GL_TEXTURE1);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
 				glUniform1i(accumulate_light_shader_locations.normal_texture, 1);
-				glBindSampler(1, samplers[toU(Sampler::Linear)]);
+				utils::opengl::state::bindSampler(1, samplers[toU(Sampler::Linear)]);
 
-				glActiveTexture(GL_TEXTURE2);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
+				utils::opengl::state::activeTexture(GL_TEXTURE2);
+				utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
 				glUniform1i(accumulate_light_shader_locations.shadow_texture, 2);
-				glBindSampler(2, samplers[toU(Sampler::Linear)]);
+				utils::opengl::state::bindSampler(2, samplers[toU(Sampler::Linear)]);
 
-				glBindVertexArray(cone_geometry.vao);
+				utils::opengl::state::bindVertexArray(cone_geometry.vao);
 				glDrawArrays(cone_geometry.drawing_mode, 0, cone_geometry.vertices_nb);
 
-				glBindVertexArray(0u);
-				glUseProgram(0u);
-				glBindSampler(2u, 0u);
-				glBindSampler(1u, 0u);
-				glBindSampler(0u, 0u);
+				utils::opengl::state::bindVertexArray(0u);
+				utils::opengl::state::useProgram(0u);
+				utils::opengl::state::bindSampler(2u, 0u);
+				utils::opengl::state::bindSampler(1u, 0u);
+				utils::opengl::state::bindSampler(0u, 0u);
 
 				glEndQuery(GL_TIME_ELAPSED);
 				utils::opengl::debug::endDebugGroup();
@@ -657,8 +764,8 @@ edan35::Assignment2::run()
 			utils::opengl::debug::beginDebugGroup("Resolve");
 			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Resolve)]);
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
-			glUseProgram(resolve_deferred_shader);
+			utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+			utils::opengl::state::useProgram(resolve_deferred_shader);
 			glViewport(0, 0, framebuffer_width, framebuffer_height);
 			// XXX: Is any clearing needed?
 
@@ -669,11 +776,11 @@ edan35::Assignment2::run()
 
 			bonobo::drawFullscreen();
 
-			glBindSampler(3, 0u);
-			glBindSampler(2, 0u);
-			glBindSampler(1, 0u);
-			glBindSampler(0, 0u);
-			glUseProgram(0u);
+			utils::opengl::state::bindSampler(3, 0u);
+			utils::opengl::state::bindSampler(2, 0u);
+			utils::opengl::state::bindSampler(1, 0u);
+			utils::opengl::state::bindSampler(0, 0u);
+			utils::opengl::state::useProgram(0u);
 
 			glEndQuery(GL_TIME_ELAPSED);
 			utils::opengl::debug::endDebugGroup();
@@ -682,7 +789,7 @@ edan35::Assignment2::run()
 
 		auto const show_debug_elements = show_cone_wireframe || show_basis;
 		if (show_debug_elements) {
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
+			utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
 		}
 
 
@@ -720,7 +827,7 @@ edan35::Assignment2::run()
 		// If the basis and cone wireframe were not shown, FBO::Resolve
 		// is still bound so there is no need to rebind it.
 		if (show_debug_elements) {
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+			utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
 		}
 
 		//
@@ -745,6 +852,9 @@ edan35::Assignment2::run()
 		if (opened) {
 			ImGui::Text("Frame CPU time: %.3f ms", std::chrono::duration<float, std::milli>(deltaTimeUs).count());
 
+			auto const& state_stats = utils::opengl::state::getFrameStats();
+			ImGui::Text("Binding calls: %zu issued, %zu redundant ones skipped", state_stats.issued, state_stats.elided);
+
 			ImGui::Checkbox("Copy elapsed times back to CPU", &copy_elapsed_times);
 
 			if (ImGui::BeginTable("Pass durations", 2, ImGuiTableFlags_SizingFixedFit))
@@ -807,6 +917,12 @@ edan35::Assignment2::run()
 			ImGui::Checkbox("Show textures", &show_textures);
 			ImGui::Checkbox("Show light cones wireframe", &show_cone_wireframe);
 			ImGui::Separator();
+			ImGui::Checkbox("Use multi-draw calls for Sponza", &use_multi_draw);
+			ImGui::Checkbox("Frustum cull Sponza", &use_frustum_culling);
+			ImGui::Text("G-buffer: %zu of %zu meshes culled", gbuffer_culling_stats.culled, gbuffer_culling_stats.tested);
+			for (std::size_t i = 0; i < static_cast<std::size_t>(lights_nb); ++i)
+				ImGui::Text("Shadow map %zu: %zu of %zu meshes culled", i, shadowmap_culling_stats[i].culled, shadowmap_culling_stats[i].tested);
+			ImGui::Separator();
 			ImGui::Checkbox("Show basis", &show_basis);
 			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
 			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
@@ -828,7 +944,7 @@ edan35::Assignment2::run()
 
 		// FBO::Resolve has already been bound to GL_READ_FRAMEBUFFER before rendering the first frame,
 		// as no other frame buffer gets bound to it.
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
+		utils::opengl::state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
 		glBlitFramebuffer(0, 0, framebuffer_width, framebuffer_height, 0, 0, framebuffer_width, framebuffer_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
 		glEndQuery(GL_TIME_ELAPSED);
@@ -844,6 +960,10 @@ edan35::Assignment2::run()
 	glDeleteSamplers(static_cast<GLsizei>(samplers.size()), samplers.data());
 	glDeleteFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
 	glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+	glDeleteBuffers(static_cast<GLsizei>(lightmap_buffers.size()), lightmap_buffers.data());
+	glDeleteTextures(1, &lightmap_texture);
+	multi_draw::destroyPass(sponza_shadowmap_pass);
+	multi_draw::destroyPass(sponza_gbuffer_pass);
 
 	glDeleteProgram(resolve_deferred_shader);
 	resolve_deferred_shader = 0u;
@@ -878,39 +998,39 @@ Textures createTextures(GLsizei framebuffer_width, GLsizei framebuffer_height)
 	Textures textures;
 	glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, framebuffer_width, framebuffer_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::DepthBuffer)], "Depth buffer");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, constant::shadowmap_res_x, constant::shadowmap_res_y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::ShadowMap)], "Shadow map");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferDiffuse)], "GBuffer diffuse");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferSpecular)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferSpecular)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferSpecular)], "GBuffer specular");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferWorldSpaceNormal)], "GBuffer normals");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::LightDiffuseContribution)], "Light diffuse contribution");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::LightSpecularContribution)], "Light specular contribution");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::Result)]);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, textures[toU(Texture::Result)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::Result)], "Final result");
 
-	glBindTexture(GL_TEXTURE_2D, 0u);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
 	return textures;
 }
 
@@ -950,7 +1070,7 @@ FBOs createFramebufferObjects(Textures const& textures)
 	FBOs fbos;
 	glGenFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::GBufferSpecular)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)], 0);
@@ -966,12 +1086,12 @@ FBOs createFramebufferObjects(Textures const& textures)
 	validate_fbo("GBuffer");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)], "GBuffer");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)], 0);
 	validate_fbo("Shadow map generation");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)], "Shadow map generation");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
@@ -985,14 +1105,14 @@ FBOs createFramebufferObjects(Textures const& textures)
 	validate_fbo("Light accumulation");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)], "Light acccumulation");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::Result)], 0);
 	glReadBuffer(GL_COLOR_ATTACHMENT0); // Colour attachment result 0 (i.e. the rendering result texture) will be blitted to the screen.
 	glDrawBuffer(GL_COLOR_ATTACHMENT0); // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the rendering result texture).
 	validate_fbo("Resolve");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)], "Resolve");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::Result)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
 	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
@@ -1000,7 +1120,7 @@ FBOs createFramebufferObjects(Textures const& textures)
 	validate_fbo("Final with depth");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)], "Cone wireframe");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0u);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, 0u);
 	return fbos;
 }
 
@@ -1076,6 +1196,8 @@ void fillGBufferShaderLocations(GLuint gbuffer_shader, GBufferShaderLocations& l
 	locations.has_specular_texture = glGetUniformLocation(gbuffer_shader, "has_specular_texture");
 	locations.has_normals_texture = glGetUniformLocation(gbuffer_shader, "has_normals_texture");
 	locations.has_opacity_texture = glGetUniformLocation(gbuffer_shader, "has_opacity_texture");
+	locations.lightmap_texture = glGetUniformLocation(gbuffer_shader, "lightmap_texture");
+	locations.has_lightmap = glGetUniformLocation(gbuffer_shader, "has_lightmap");
 
 	glUniformBlockBinding(gbuffer_shader, locations.ubo_CameraViewProjTransforms, toU(UBO::CameraViewProjTransforms));
 
@@ -1191,7 +1313,7 @@ loadCone()
 
 	glGenVertexArrays(1, &cone.vao);
 	assert(cone.vao != 0u);
-	glBindVertexArray(cone.vao);
+	utils::opengl::state::bindVertexArray(cone.vao);
 	{
 		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, cone.vao, "Cone VAO");
 
@@ -1206,7 +1328,7 @@ loadCone()
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
 	}
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(0u);
 
 	return cone;
 }
@@ -0,0 +1,414 @@
+#include "lightmap.hpp"
+
+#include "core/GLStateCache.hpp"
+#include "core/Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+	char const atlas_magic[4] = { 'L', 'M', 'A', 'P' };
+	// Bumped whenever `loadGeometry()` numbers vertices differently, e.g. 2
+	// when meshes started being reordered by `mesh_optimizer`.
+	std::uint32_t const atlas_version = 2u;
+
+	struct chart {
+		std::size_t mesh{0u};
+		std::vector<GLuint> vertices;    // vertices of the mesh projected by this chart
+		glm::vec3 normal{0.0f};          // area-weighted sum of the face normals
+		int u_axis{0}, v_axis{1};
+		glm::vec2 min{0.0f}, max{0.0f};  // projected bounds, in scene units
+		glm::ivec2 size{0};              // in texels, padding included
+		glm::ivec2 origin{0};            // lower-left texel in the atlas
+	};
+
+	// Disjoint sets over the triangles of a mesh.
+	class union_find {
+	public:
+		explicit union_find(std::size_t size) : parents(size)
+		{
+			std::iota(parents.begin(), parents.end(), std::size_t(0u));
+		}
+		std::size_t find(std::size_t i)
+		{
+			while (parents[i] != i) {
+				parents[i] = parents[parents[i]];
+				i = parents[i];
+			}
+			return i;
+		}
+		void merge(std::size_t a, std::size_t b)
+		{
+			a = find(a);
+			b = find(b);
+			if (a != b)
+				parents[std::max(a, b)] = std::min(a, b);
+		}
+	private:
+		std::vector<std::size_t> parents;
+	};
+
+	// 0 to 5 for +x, -x, +y, -y, +z, -z: the axis a normal is closest to.
+	int
+	dominantAxis(glm::vec3 const& n)
+	{
+		auto const a = glm::abs(n);
+		int const axis = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+		return 2 * axis + (n[axis] < 0.0f ? 1 : 0);
+	}
+
+	// An edge between two welded positions, seen from one axis.
+	struct edge_key {
+		std::array<std::int64_t, 6> positions;
+		int axis;
+
+		bool operator==(edge_key const& other) const
+		{
+			return axis == other.axis && positions == other.positions;
+		}
+	};
+
+	struct edge_key_hash {
+		std::size_t operator()(edge_key const& key) const
+		{
+			std::size_t hash = std::hash<int>()(key.axis);
+			for (auto const p : key.positions)
+				hash = hash * 1000003u ^ std::hash<std::int64_t>()(p);
+			return hash;
+		}
+	};
+
+	edge_key
+	makeEdgeKey(glm::vec3 const& a, glm::vec3 const& b, float weld_distance, int axis)
+	{
+		std::array<std::int64_t, 3> qa, qb;
+		for (int i = 0; i < 3; ++i) {
+			qa[i] = static_cast<std::int64_t>(std::llround(a[i] / weld_distance));
+			qb[i] = static_cast<std::int64_t>(std::llround(b[i] / weld_distance));
+		}
+		if (qb < qa)
+			std::swap(qa, qb);
+
+		edge_key key;
+		std::copy(qa.begin(), qa.end(), key.positions.begin());
+		std::copy(qb.begin(), qb.end(), key.positions.begin() + 3);
+		key.axis = axis;
+		return key;
+	}
+
+	void
+	buildCharts(bonobo::mesh_geometry const& mesh, std::size_t mesh_index, float weld_distance, std::vector<chart>& charts)
+	{
+		auto const triangles_nb = mesh.indices.size() / 3u;
+		std::vector<glm::vec3> face_normals(triangles_nb);
+		std::vector<int> face_axes(triangles_nb);
+		for (std::size_t t = 0u; t < triangles_nb; ++t) {
+			auto const& a = mesh.vertices[mesh.indices[3u * t + 0u]];
+			auto const& b = mesh.vertices[mesh.indices[3u * t + 1u]];
+			auto const& c = mesh.vertices[mesh.indices[3u * t + 2u]];
+			face_normals[t] = glm::cross(b - a, c - a);
+			face_axes[t] = dominantAxis(face_normals[t]);
+		}
+
+		// A vertex has a single texcoord, so all triangles using it have to
+		// be in the same chart; separate vertices at the same position are
+		// only stitched when both sides face the same way.
+		union_find sets(triangles_nb);
+		std::vector<std::size_t> vertex_owners(mesh.vertices.size(), triangles_nb);
+		std::unordered_map<edge_key, std::size_t, edge_key_hash> edges;
+		edges.reserve(3u * triangles_nb);
+		for (std::size_t t = 0u; t < triangles_nb; ++t) {
+			for (std::size_t i = 0u; i < 3u; ++i) {
+				auto const vertex = mesh.indices[3u * t + i];
+				if (vertex_owners[vertex] == triangles_nb)
+					vertex_owners[vertex] = t;
+				else
+					sets.merge(vertex_owners[vertex], t);
+
+				auto const next = mesh.indices[3u * t + (i + 1u) % 3u];
+				auto const key = makeEdgeKey(mesh.vertices[vertex], mesh.vertices[next], weld_distance, face_axes[t]);
+				auto const inserted = edges.emplace(key, t);
+				if (!inserted.second)
+					sets.merge(inserted.first->second, t);
+			}
+		}
+
+		std::vector<std::size_t> chart_of_root(triangles_nb, std::numeric_limits<std::size_t>::max());
+		auto const first_chart = charts.size();
+		for (std::size_t t = 0u; t < triangles_nb; ++t) {
+			auto const root = sets.find(t);
+			if (chart_of_root[root] == std::numeric_limits<std::size_t>::max()) {
+				chart_of_root[root] = charts.size();
+				charts.emplace_back();
+				charts.back().mesh = mesh_index;
+			}
+			charts[chart_of_root[root]].normal += face_normals[t];
+		}
+
+		for (auto c = first_chart; c < charts.size(); ++c) {
+			int const axis = dominantAxis(charts[c].normal) / 2;
+			charts[c].u_axis = (axis + 1) % 3;
+			charts[c].v_axis = (axis + 2) % 3;
+			charts[c].min = glm::vec2(std::numeric_limits<float>::max());
+			charts[c].max = glm::vec2(std::numeric_limits<float>::lowest());
+		}
+
+		// Triangles sharing a vertex cannot be split into separate charts,
+		// so a chart whose triangles face different ways folds onto itself
+		// when projected.
+		std::size_t folded_nb = 0u;
+		for (std::size_t t = 0u; t < triangles_nb; ++t)
+			if (face_axes[t] != dominantAxis(charts[chart_of_root[sets.find(t)]].normal))
+				++folded_nb;
+		if (folded_nb > 0u)
+			LogWarning("Mesh \"%s\" shares vertices between %zu triangles and others facing different axes: their lightmap texcoords may overlap", mesh.name.c_str(), folded_nb);
+		for (std::size_t v = 0u; v < mesh.vertices.size(); ++v) {
+			if (vertex_owners[v] == triangles_nb)
+				continue;
+			auto& owner = charts[chart_of_root[sets.find(vertex_owners[v])]];
+			owner.vertices.push_back(static_cast<GLuint>(v));
+			auto const uv = glm::vec2(mesh.vertices[v][owner.u_axis], mesh.vertices[v][owner.v_axis]);
+			owner.min = glm::min(owner.min, uv);
+			owner.max = glm::max(owner.max, uv);
+		}
+	}
+
+	// Shelf packing: charts are laid out left to right in rows as high as
+	// their first, and thus highest, chart.
+	bool
+	packCharts(std::vector<chart>& charts, std::vector<std::size_t> const& order,
+	           float density, std::uint32_t width, std::uint32_t height, std::uint32_t padding)
+	{
+		int x = 0, y = 0, row_height = 0;
+		for (auto const c : order) {
+			auto& current = charts[c];
+			auto const extent = (current.max - current.min) * density;
+			current.size = glm::ivec2(std::max(1, static_cast<int>(std::ceil(extent.x))),
+			                          std::max(1, static_cast<int>(std::ceil(extent.y))))
+			             + glm::ivec2(2 * static_cast<int>(padding));
+			if (current.size.x > static_cast<int>(width))
+				return false;
+			if (x + current.size.x > static_cast<int>(width)) {
+				y += row_height;
+				x = 0;
+				row_height = 0;
+			}
+			current.origin = glm::ivec2(x, y);
+			x += current.size.x;
+			row_height = std::max(row_height, current.size.y);
+			if (y + row_height > static_cast<int>(height))
+				return false;
+		}
+		return true;
+	}
+}
+
+lightmap::atlas
+lightmap::generateAtlas(std::vector<bonobo::mesh_geometry> const& meshes,
+                        std::uint32_t width, std::uint32_t height,
+                        std::uint32_t padding)
+{
+	atlas result;
+	result.width = width;
+	result.height = height;
+	result.texcoords.resize(meshes.size());
+
+	glm::vec3 scene_min(std::numeric_limits<float>::max()), scene_max(std::numeric_limits<float>::lowest());
+	for (auto const& mesh : meshes) {
+		for (auto const& vertex : mesh.vertices) {
+			scene_min = glm::min(scene_min, vertex);
+			scene_max = glm::max(scene_max, vertex);
+		}
+	}
+	float const weld_distance = std::max(1e-5f * glm::length(scene_max - scene_min), std::numeric_limits<float>::min());
+
+	std::vector<chart> charts;
+	for (std::size_t m = 0u; m < meshes.size(); ++m) {
+		if (meshes[m].vertices_per_face != 3u) {
+			LogWarning("Mesh \"%s\" is not made of triangles: it gets no lightmap texcoords", meshes[m].name.c_str());
+			continue;
+		}
+		buildCharts(meshes[m], m, weld_distance, charts);
+	}
+	if (charts.empty()) {
+		LogError("No triangles to lay out in the lightmap");
+		result.texcoords.clear();
+		return result;
+	}
+
+	// Start from the density at which the charts' bounds would cover the
+	// lightmap, and lower it until they fit alongside their padding.
+	double total_area = 0.0;
+	for (auto const& current : charts) {
+		auto const extent = current.max - current.min;
+		total_area += static_cast<double>(extent.x) * static_cast<double>(extent.y);
+	}
+	float density = total_area > 0.0 ? static_cast<float>(std::sqrt(static_cast<double>(width) * height / total_area))
+	                                 : 1.0f / weld_distance;
+
+	std::vector<std::size_t> order(charts.size());
+	std::iota(order.begin(), order.end(), std::size_t(0u));
+	std::sort(order.begin(), order.end(), [&charts](std::size_t a, std::size_t b){
+		return charts[a].max.y - charts[a].min.y > charts[b].max.y - charts[b].min.y;
+	});
+
+	bool packed = false;
+	for (int attempt = 0; attempt < 64 && !packed; ++attempt) {
+		packed = packCharts(charts, order, density, width, height, padding);
+		if (!packed)
+			density *= 0.95f;
+	}
+	if (!packed) {
+		LogError("Failed to pack %zu charts in a %ux%u lightmap", charts.size(), width, height);
+		result.texcoords.clear();
+		return result;
+	}
+	LogInfo("Packed %zu charts in a %ux%u lightmap at %g texels per unit", charts.size(), width, height, density);
+
+	for (std::size_t m = 0u; m < meshes.size(); ++m)
+		result.texcoords[m].assign(meshes[m].vertices.size(), glm::vec2(0.0f));
+	for (auto const& current : charts) {
+		auto const& vertices = meshes[current.mesh].vertices;
+		auto& texcoords = result.texcoords[current.mesh];
+		auto const offset = glm::vec2(current.origin) + glm::vec2(static_cast<float>(padding));
+		for (auto const v : current.vertices) {
+			auto const uv = glm::vec2(vertices[v][current.u_axis], vertices[v][current.v_axis]);
+			texcoords[v] = (offset + (uv - current.min) * density) / glm::vec2(width, height);
+		}
+	}
+
+	return result;
+}
+
+bool
+lightmap::writeAtlas(std::string const& filename, atlas const& atlas)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		LogError("Failed to open \"%s\" for writing", filename.c_str());
+		return false;
+	}
+
+	auto const write = [&file](void const* data, std::size_t size){
+		file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+	};
+	std::uint32_t const meshes_nb = static_cast<std::uint32_t>(atlas.texcoords.size());
+	write(atlas_magic, sizeof(atlas_magic));
+	write(&atlas_version, sizeof(atlas_version));
+	write(&atlas.width, sizeof(atlas.width));
+	write(&atlas.height, sizeof(atlas.height));
+	write(&meshes_nb, sizeof(meshes_nb));
+	for (auto const& texcoords : atlas.texcoords) {
+		std::uint32_t const vertices_nb = static_cast<std::uint32_t>(texcoords.size());
+		write(&vertices_nb, sizeof(vertices_nb));
+		write(texcoords.data(), texcoords.size() * sizeof(glm::vec2));
+	}
+
+	if (!file) {
+		LogError("Failed to write the lightmap texcoords to \"%s\"", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool
+lightmap::readAtlas(std::string const& filename, atlas& atlas)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	auto const read = [&file](void* data, std::size_t size){
+		return static_cast<bool>(file.read(static_cast<char*>(data), static_cast<std::streamsize>(size)));
+	};
+	char magic[sizeof(atlas_magic)];
+	std::uint32_t version = 0u, meshes_nb = 0u;
+	if (!read(magic, sizeof(magic)) || std::memcmp(magic, atlas_magic, sizeof(magic)) != 0
+	 || !read(&version, sizeof(version)) || version != atlas_version
+	 || !read(&atlas.width, sizeof(atlas.width)) || !read(&atlas.height, sizeof(atlas.height))
+	 || !read(&meshes_nb, sizeof(meshes_nb))) {
+		LogError("\"%s\" is not a lightmap texcoords file", filename.c_str());
+		return false;
+	}
+
+	atlas.texcoords.resize(meshes_nb);
+	for (auto& texcoords : atlas.texcoords) {
+		std::uint32_t vertices_nb = 0u;
+		if (!read(&vertices_nb, sizeof(vertices_nb)))
+			break;
+		texcoords.resize(vertices_nb);
+		if (!read(texcoords.data(), texcoords.size() * sizeof(glm::vec2)))
+			break;
+	}
+	if (!file) {
+		LogError("\"%s\" is truncated", filename.c_str());
+		atlas.texcoords.clear();
+		return false;
+	}
+	return true;
+}
+
+std::vector<GLuint>
+lightmap::attachTexcoords(std::vector<bonobo::mesh_data> const& meshes, atlas const& atlas)
+{
+	std::vector<GLuint> buffers(meshes.size(), 0u);
+	if (meshes.size() != atlas.texcoords.size()) {
+		LogWarning("The lightmap has texcoords for %zu meshes but the scene has %zu: it is out of date",
+		           atlas.texcoords.size(), meshes.size());
+		return buffers;
+	}
+
+	// Meshes sharing a Vertex Array Object, see `bonobo::loadObjects()`,
+	// share a buffer too, in which each mesh starts at its base vertex.
+	std::unordered_map<GLuint, GLsizei> vertices_nb_per_vao;
+	std::vector<bool> is_mesh_valid(meshes.size(), false);
+	for (std::size_t i = 0u; i < meshes.size(); ++i) {
+		auto const& texcoords = atlas.texcoords[i];
+		if (texcoords.empty() || texcoords.size() != static_cast<std::size_t>(meshes[i].vertices_nb)) {
+			LogWarning("Mesh \"%s\" has no matching lightmap texcoords", meshes[i].name.c_str());
+			continue;
+		}
+		is_mesh_valid[i] = true;
+		auto& vertices_nb = vertices_nb_per_vao[meshes[i].vao];
+		vertices_nb = std::max(vertices_nb, meshes[i].base_vertex + meshes[i].vertices_nb);
+	}
+
+	std::unordered_map<GLuint, GLuint> buffer_per_vao;
+	for (auto const& vao_and_vertices_nb : vertices_nb_per_vao) {
+		GLuint buffer = 0u;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		std::vector<glm::vec2> const zeros(static_cast<std::size_t>(vao_and_vertices_nb.second), glm::vec2(0.0f));
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(zeros.size() * sizeof(glm::vec2)), zeros.data(), GL_STATIC_DRAW);
+
+		utils::opengl::state::bindVertexArray(vao_and_vertices_nb.first);
+		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::lightmap_texcoords));
+		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::lightmap_texcoords), 2, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+		utils::opengl::state::bindVertexArray(0u);
+
+		buffer_per_vao.emplace(vao_and_vertices_nb.first, buffer);
+	}
+
+	for (std::size_t i = 0u; i < meshes.size(); ++i) {
+		if (!is_mesh_valid[i])
+			continue;
+		auto const& texcoords = atlas.texcoords[i];
+		buffers[i] = buffer_per_vao[meshes[i].vao];
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+		glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(meshes[i].base_vertex) * static_cast<GLintptr>(sizeof(glm::vec2)),
+		                static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec2)), texcoords.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	return buffers;
+}
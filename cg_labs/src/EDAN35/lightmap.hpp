@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/helpers.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace lightmap
+{
+	//! \brief Second set of texture coordinates, laying out every
+	//!        triangle of a scene without overlap in a single texture.
+	struct atlas {
+		std::uint32_t width{0u};                        //!< width of the lightmap, in texels
+		std::uint32_t height{0u};                       //!< height of the lightmap, in texels
+		std::vector<std::vector<glm::vec2>> texcoords;  //!< per mesh, one texcoord in [0, 1]² per vertex
+	};
+
+	//! \brief Generate the lightmap texcoords of a scene.
+	//!
+	//! Triangles are grouped into charts: triangles sharing a vertex, or
+	//! an edge while facing the same axis, end up in the same chart, which
+	//! is then projected along that axis. The charts are packed in rows,
+	//! with the largest texel density for which they all fit.
+	//!
+	//! Charts only stay free of overlap if triangles facing different axes
+	//! do not share vertices, i.e. if vertices are split at hard edges as
+	//! with flat-shaded meshes; curved surfaces sharing their vertices fold
+	//! onto themselves, and their meshes are reported with a warning.
+	//!
+	//! @param [in] meshes geometry of the scene, see `bonobo::loadGeometry()`
+	//! @param [in] width of the lightmap, in texels
+	//! @param [in] height of the lightmap, in texels
+	//! @param [in] padding number of texels kept empty around each chart,
+	//!             so that filtering does not bleed between charts
+	//! @return the texcoords of all meshes; meshes that are not made of
+	//!         triangles get an empty set
+	atlas generateAtlas(std::vector<bonobo::mesh_geometry> const& meshes,
+	                    std::uint32_t width, std::uint32_t height,
+	                    std::uint32_t padding = 2u);
+
+	//! \brief Write lightmap texcoords to a binary file.
+	//!
+	//! @return whether the file could be written
+	bool writeAtlas(std::string const& filename, atlas const& atlas);
+
+	//! \brief Read lightmap texcoords written by `writeAtlas()`.
+	//!
+	//! @return whether the file exists and is valid
+	bool readAtlas(std::string const& filename, atlas& atlas);
+
+	//! \brief Add the lightmap texcoords to the Vertex Arrays of meshes,
+	//!        at binding `bonobo::shader_bindings::lightmap_texcoords`.
+	//!
+	//! The meshes need to come from `bonobo::loadObjects()` on the file the
+	//! atlas was generated from; meshes whose vertex count does not match
+	//! are skipped.
+	//!
+	//! Meshes loaded into shared buffers get a single shared buffer of
+	//! texcoords as well.
+	//!
+	//! @return per mesh, the OpenGL name of the buffer holding its
+	//!         texcoords, to be deleted along with the meshes; 0 for
+	//!         skipped meshes
+	std::vector<GLuint> attachTexcoords(std::vector<bonobo::mesh_data> const& meshes, atlas const& atlas);
+}
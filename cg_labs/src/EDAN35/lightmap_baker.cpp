@@ -0,0 +1,330 @@
+// Offline ambient occlusion baker for Sponza.
+//
+// Lays out a lightmap atlas over the scene, finds the surface point behind
+// each texel, and traces cosine-weighted occlusion rays from them against
+// the lab 1 BVH on all cores. Writes the texcoords and an AO texture that
+// assignment 2 picks up when filling the G-buffer.
+
+#include "lightmap.hpp"
+
+#include "config.hpp"
+#include "core/helpers.hpp"
+#include "core/Log.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "stb_image_write.h"
+#include "swScene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct bake_settings {
+		std::uint32_t resolution{2048u};  // width and height of the lightmap
+		std::uint32_t padding{2u};        // empty texels around each chart
+		std::uint32_t samples{64u};       // occlusion rays per texel
+		float distance{0.0f};             // farthest occluder considered; 0 for 5% of the scene diagonal
+		std::size_t slice{1u << 14};      // texels traced per batched query
+	};
+
+	// Surface point behind a texel.
+	struct texel_sample {
+		glm::vec3 position;
+		glm::vec3 normal; // geometric normal, on the same side as the shading normal
+	};
+
+	sw::Vec3
+	toSw(glm::vec3 const& v)
+	{
+		return sw::Vec3(v.x, v.y, v.z);
+	}
+
+	float
+	radicalInverse(std::uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f;
+	}
+
+	// Per-texel offset decorrelating the Hammersley points of neighbours.
+	float
+	hashToUnit(std::uint32_t x)
+	{
+		x ^= x >> 16u;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15u;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16u;
+		return static_cast<float>(x >> 8u) / static_cast<float>(1u << 24u);
+	}
+
+	// Finds, for every texel covered by a triangle, the point it maps to.
+	void
+	rasterizeTexels(std::vector<bonobo::mesh_geometry> const& meshes, lightmap::atlas const& atlas,
+	                std::vector<texel_sample>& samples, std::vector<std::uint8_t>& covered)
+	{
+		auto const size = glm::vec2(atlas.width, atlas.height);
+		samples.assign(static_cast<std::size_t>(atlas.width) * atlas.height, texel_sample{});
+		covered.assign(samples.size(), 0u);
+
+		for (std::size_t m = 0u; m < meshes.size(); ++m) {
+			auto const& mesh = meshes[m];
+			auto const& texcoords = atlas.texcoords[m];
+			if (mesh.vertices_per_face != 3u || texcoords.empty())
+				continue;
+
+			for (std::size_t i = 0u; i + 2u < mesh.indices.size(); i += 3u) {
+				GLuint const v[3] = { mesh.indices[i], mesh.indices[i + 1u], mesh.indices[i + 2u] };
+				glm::vec2 const uv[3] = { texcoords[v[0]] * size, texcoords[v[1]] * size, texcoords[v[2]] * size };
+				auto const cross2 = [](glm::vec2 const& a, glm::vec2 const& b){ return a.x * b.y - a.y * b.x; };
+				float const area = cross2(uv[1] - uv[0], uv[2] - uv[0]);
+				if (std::abs(area) < 1e-12f)
+					continue;
+
+				auto normal = glm::normalize(glm::cross(mesh.vertices[v[1]] - mesh.vertices[v[0]],
+				                                        mesh.vertices[v[2]] - mesh.vertices[v[0]]));
+				if (!mesh.normals.empty() && glm::dot(normal, mesh.normals[v[0]] + mesh.normals[v[1]] + mesh.normals[v[2]]) < 0.0f)
+					normal = -normal;
+
+				auto const lower = glm::max(glm::floor(glm::min(uv[0], glm::min(uv[1], uv[2]))), glm::vec2(0.0f));
+				auto const upper = glm::min(glm::ceil(glm::max(uv[0], glm::max(uv[1], uv[2]))), size);
+				for (int y = static_cast<int>(lower.y); y < static_cast<int>(upper.y); ++y) {
+					for (int x = static_cast<int>(lower.x); x < static_cast<int>(upper.x); ++x) {
+						auto const p = glm::vec2(x + 0.5f, y + 0.5f);
+						float const w0 = cross2(uv[2] - uv[1], p - uv[1]) / area;
+						float const w1 = cross2(uv[0] - uv[2], p - uv[2]) / area;
+						float const w2 = 1.0f - w0 - w1;
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+							continue;
+
+						auto const texel = static_cast<std::size_t>(y) * atlas.width + static_cast<std::size_t>(x);
+						samples[texel].position = w0 * mesh.vertices[v[0]] + w1 * mesh.vertices[v[1]] + w2 * mesh.vertices[v[2]];
+						samples[texel].normal = normal;
+						covered[texel] = 1u;
+					}
+				}
+			}
+		}
+	}
+
+	// Fills empty texels next to covered ones with the average of the
+	// latter, one ring per pass, so that bilinear filtering along chart
+	// borders does not fetch the empty background.
+	void
+	dilate(std::vector<float>& values, std::vector<std::uint8_t>& covered, std::uint32_t width, std::uint32_t height, std::uint32_t passes)
+	{
+		std::vector<float> next_values;
+		std::vector<std::uint8_t> next_covered;
+		for (std::uint32_t pass = 0u; pass < passes; ++pass) {
+			next_values = values;
+			next_covered = covered;
+			for (std::uint32_t y = 0u; y < height; ++y) {
+				for (std::uint32_t x = 0u; x < width; ++x) {
+					auto const texel = static_cast<std::size_t>(y) * width + x;
+					if (covered[texel])
+						continue;
+					float sum = 0.0f;
+					int count = 0;
+					for (int dy = -1; dy <= 1; ++dy) {
+						for (int dx = -1; dx <= 1; ++dx) {
+							int const nx = static_cast<int>(x) + dx, ny = static_cast<int>(y) + dy;
+							if (nx < 0 || ny < 0 || nx >= static_cast<int>(width) || ny >= static_cast<int>(height))
+								continue;
+							auto const neighbour = static_cast<std::size_t>(ny) * width + static_cast<std::size_t>(nx);
+							if (covered[neighbour]) {
+								sum += values[neighbour];
+								++count;
+							}
+						}
+					}
+					if (count > 0) {
+						next_values[texel] = sum / static_cast<float>(count);
+						next_covered[texel] = 1u;
+					}
+				}
+			}
+			values.swap(next_values);
+			covered.swap(next_covered);
+		}
+	}
+
+	bool
+	parseArguments(int argc, char* argv[], bake_settings& settings)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string const arg = argv[i];
+			if (i + 1 >= argc) {
+				LogError("Missing value for \"%s\"", arg.c_str());
+				return false;
+			}
+			char const* value = argv[++i];
+			if (arg == "--resolution")
+				settings.resolution = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+			else if (arg == "--padding")
+				settings.padding = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+			else if (arg == "--samples")
+				settings.samples = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+			else if (arg == "--distance")
+				settings.distance = std::strtof(value, nullptr);
+			else {
+				LogError("Unknown option \"%s\"; expected --resolution, --padding, --samples or --distance", arg.c_str());
+				return false;
+			}
+		}
+		if (settings.resolution == 0u || settings.samples == 0u || settings.distance < 0.0f) {
+			LogError("The resolution and sample count need to be positive, and the distance not negative");
+			return false;
+		}
+		return true;
+	}
+
+	bool
+	bake(bake_settings const& settings)
+	{
+		auto const start_time = std::chrono::high_resolution_clock::now();
+		auto const elapsed = [&start_time](){
+			return std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start_time).count();
+		};
+
+		auto const meshes = bonobo::loadGeometry(config::resources_path("sponza/sponza.obj"));
+		if (meshes.empty()) {
+			LogError("Failed to load the Sponza model");
+			return false;
+		}
+
+		auto const atlas = lightmap::generateAtlas(meshes, settings.resolution, settings.resolution, settings.padding);
+		if (atlas.texcoords.empty())
+			return false;
+
+		// Triangle soup for the tracer; the primitives point into `positions`,
+		// which is sized once so that it never moves.
+		std::size_t triangles_nb = 0u;
+		glm::vec3 lower(std::numeric_limits<float>::max()), upper(std::numeric_limits<float>::lowest());
+		for (auto const& mesh : meshes) {
+			if (mesh.vertices_per_face != 3u)
+				continue;
+			triangles_nb += mesh.indices.size() / 3u;
+			for (auto const& vertex : mesh.vertices) {
+				lower = glm::min(lower, vertex);
+				upper = glm::max(upper, vertex);
+			}
+		}
+		std::vector<sw::Vec3> positions;
+		positions.reserve(3u * triangles_nb);
+		sw::Scene scene;
+		for (auto const& mesh : meshes) {
+			if (mesh.vertices_per_face != 3u)
+				continue;
+			for (auto const index : mesh.indices)
+				positions.push_back(toSw(mesh.vertices[index]));
+		}
+		for (std::size_t t = 0u; t < triangles_nb; ++t)
+			scene.push(sw::Triangle(&positions[3u * t], sw::Material()));
+		scene.build(sw::AcceleratorType::BVH);
+
+		float const diagonal = glm::length(upper - lower);
+		float const distance = settings.distance > 0.0f ? settings.distance : 0.05f * diagonal;
+		float const bias = 1e-4f * diagonal;
+		LogInfo("Built the BVH over %zu triangles after %.2f s", triangles_nb, elapsed());
+
+		std::vector<texel_sample> texels;
+		std::vector<std::uint8_t> covered;
+		rasterizeTexels(meshes, atlas, texels, covered);
+		std::vector<std::uint32_t> covered_texels;
+		for (std::size_t i = 0u; i < covered.size(); ++i)
+			if (covered[i])
+				covered_texels.push_back(static_cast<std::uint32_t>(i));
+		LogInfo("%zu of %zu texels are covered (%.1f%%)", covered_texels.size(), covered.size(),
+		        100.0f * static_cast<float>(covered_texels.size()) / static_cast<float>(covered.size()));
+
+		// Batches of texels are turned into rays here, and traced on all
+		// cores by the scene, sorted as they point every which way.
+		std::vector<float> ambient(covered.size(), 1.0f);
+		std::vector<sw::Ray> rays;
+		std::vector<std::uint8_t> occluded;
+		for (std::size_t begin = 0u; begin < covered_texels.size(); begin += settings.slice) {
+			auto const end = std::min(begin + settings.slice, covered_texels.size());
+			rays.resize((end - begin) * settings.samples);
+			occluded.resize(rays.size());
+			for (std::size_t i = begin; i < end; ++i) {
+				auto const texel = covered_texels[i];
+				auto const& sample = texels[texel];
+				auto const& n = sample.normal;
+				float const sign = std::copysign(1.0f, n.z);
+				float const a = -1.0f / (sign + n.z);
+				float const b = n.x * n.y * a;
+				auto const tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+				auto const bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+				auto const origin = toSw(sample.position + bias * n);
+				float const rotation = hashToUnit(texel);
+				for (std::uint32_t s = 0u; s < settings.samples; ++s) {
+					float const u1 = (static_cast<float>(s) + 0.5f) / static_cast<float>(settings.samples);
+					float u2 = radicalInverse(s) + rotation;
+					u2 -= std::floor(u2);
+					float const r = std::sqrt(u1);
+					float const phi = glm::two_pi<float>() * u2;
+					auto const direction = r * std::cos(phi) * tangent + r * std::sin(phi) * bitangent + std::sqrt(1.0f - u1) * n;
+					rays[(i - begin) * settings.samples + s] = sw::Ray(origin, toSw(direction), 0.0f, distance);
+				}
+			}
+
+			scene.occluded(rays.data(), rays.size(), occluded.data(), sw::RayOrder::Incoherent);
+
+			for (std::size_t i = begin; i < end; ++i) {
+				std::uint32_t hits = 0u;
+				for (std::uint32_t s = 0u; s < settings.samples; ++s)
+					hits += occluded[(i - begin) * settings.samples + s];
+				ambient[covered_texels[i]] = 1.0f - static_cast<float>(hits) / static_cast<float>(settings.samples);
+			}
+			LogTrivia("Traced %zu of %zu texels after %.2f s", end, covered_texels.size(), elapsed());
+		}
+
+		dilate(ambient, covered, atlas.width, atlas.height, settings.padding + 1u);
+
+		std::vector<std::uint8_t> image(ambient.size());
+		for (std::size_t i = 0u; i < ambient.size(); ++i)
+			image[i] = static_cast<std::uint8_t>(glm::clamp(ambient[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+		// Rows go up with the texcoords, while images are stored top-down.
+		auto const texture_path = config::resources_path("sponza/sponza_ao.png");
+		stbi_flip_vertically_on_write(1);
+		if (!stbi_write_png(texture_path.c_str(), static_cast<int>(atlas.width), static_cast<int>(atlas.height), 1,
+		                    image.data(), static_cast<int>(atlas.width))) {
+			LogError("Failed to write \"%s\"", texture_path.c_str());
+			return false;
+		}
+		if (!lightmap::writeAtlas(config::resources_path("sponza/sponza.lightmap"), atlas))
+			return false;
+
+		LogInfo("Baked %u rays per texel in %.2f s, written to \"%s\"", settings.samples, elapsed(), texture_path.c_str());
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::setlocale(LC_ALL, "");
+
+	Log::Init();
+
+	bake_settings settings;
+	bool const success = parseArguments(argc, argv, settings) && bake(settings);
+
+	Log::Destroy();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
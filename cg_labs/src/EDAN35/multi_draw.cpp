@@ -0,0 +1,144 @@
+#include "multi_draw.hpp"
+
+#include "core/GLStateCache.hpp"
+#include "core/Log.h"
+
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+	// Layout expected by `glMultiDrawElementsIndirect()`.
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	bool isIndirectSupported()
+	{
+		return GLAD_GL_VERSION_4_3 != 0;
+	}
+}
+
+multi_draw::pass
+multi_draw::createPass(std::vector<bonobo::mesh_data> const& meshes,
+                       std::function<std::vector<GLuint> (std::size_t)> const& get_state)
+{
+	pass pass;
+	pass.ranges.resize(meshes.size());
+
+	using key = std::tuple<GLuint, GLenum, GLenum, std::vector<GLuint>>;
+	std::map<key, std::size_t> batch_indices;
+	for (std::size_t i = 0u; i < meshes.size(); ++i) {
+		auto const& mesh = meshes[i];
+		if (mesh.ibo == 0u || mesh.indices_nb == 0) {
+			LogWarning("Mesh \"%s\" is not indexed and will not be drawn by multi-draw passes.", mesh.name.c_str());
+			continue;
+		}
+
+		auto const inserted = batch_indices.emplace(key(mesh.vao, mesh.drawing_mode, mesh.index_type, get_state(i)), pass.batches.size());
+		if (inserted.second) {
+			batch new_batch;
+			new_batch.first_mesh = i;
+			new_batch.vao = mesh.vao;
+			new_batch.drawing_mode = mesh.drawing_mode;
+			new_batch.index_type = mesh.index_type;
+			pass.batches.push_back(std::move(new_batch));
+		}
+
+		pass.batches[inserted.first->second].meshes.push_back(i);
+		pass.ranges[i] = { mesh.indices_nb, mesh.first_index, mesh.base_vertex };
+	}
+
+	if (isIndirectSupported() && !pass.batches.empty()) {
+		// Each batch gets room for the commands of all its meshes, even
+		// though only the visible ones are written.
+		GLintptr indirect_size = 0;
+		for (auto& batch : pass.batches) {
+			batch.indirect_offset = indirect_size;
+			indirect_size += static_cast<GLintptr>(batch.meshes.size() * sizeof(DrawElementsIndirectCommand));
+		}
+		glGenBuffers(1, &pass.indirect_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pass.indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(indirect_size), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+		utils::opengl::debug::nameObject(GL_BUFFER, pass.indirect_buffer, "Indirect draw commands");
+	}
+
+	std::vector<std::uint32_t> all_meshes(meshes.size());
+	std::iota(all_meshes.begin(), all_meshes.end(), 0u);
+	setVisibleMeshes(pass, all_meshes);
+
+	return pass;
+}
+
+void
+multi_draw::draw(pass const& pass, batch const& batch)
+{
+	auto const draws_nb = static_cast<GLsizei>(batch.counts.size());
+	if (draws_nb == 0)
+		return;
+
+	utils::opengl::state::bindVertexArray(batch.vao);
+	if (pass.indirect_buffer != 0u) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pass.indirect_buffer);
+		glMultiDrawElementsIndirect(batch.drawing_mode, batch.index_type,
+		                            reinterpret_cast<GLvoid const*>(batch.indirect_offset), draws_nb, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+	} else {
+		glMultiDrawElementsBaseVertex(batch.drawing_mode, batch.counts.data(), batch.index_type,
+		                              batch.offsets.data(), draws_nb,
+		                              batch.base_vertices.data());
+	}
+}
+
+void
+multi_draw::setVisibleMeshes(pass& pass, std::vector<std::uint32_t> const& visible_meshes)
+{
+	std::vector<bool> is_visible(pass.ranges.size(), false);
+	for (auto const mesh : visible_meshes)
+		if (mesh < is_visible.size())
+			is_visible[mesh] = true;
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	for (auto& batch : pass.batches) {
+		batch.counts.clear();
+		batch.offsets.clear();
+		batch.base_vertices.clear();
+		for (auto const mesh : batch.meshes) {
+			if (!is_visible[mesh])
+				continue;
+			auto const& range = pass.ranges[mesh];
+			batch.counts.push_back(range.count);
+			batch.offsets.push_back(reinterpret_cast<GLvoid const*>(static_cast<std::uintptr_t>(range.first_index) * bonobo::getIndexSize(batch.index_type)));
+			batch.base_vertices.push_back(range.base_vertex);
+			commands.push_back({ static_cast<GLuint>(range.count), 1u, range.first_index, range.base_vertex, 0u });
+		}
+		// Keep the commands of the next batch at its offset.
+		commands.resize(static_cast<std::size_t>(batch.indirect_offset) / sizeof(DrawElementsIndirectCommand) + batch.meshes.size(),
+		                DrawElementsIndirectCommand{ 0u, 0u, 0u, 0, 0u });
+	}
+
+	if (pass.indirect_buffer == 0u)
+		return;
+
+	// Orphan the previous commands, which earlier draws may still read.
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pass.indirect_buffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)),
+	             commands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+}
+
+void
+multi_draw::destroyPass(pass& pass)
+{
+	glDeleteBuffers(1, &pass.indirect_buffer);
+	pass.indirect_buffer = 0u;
+	pass.batches.clear();
+	pass.ranges.clear();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/helpers.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+namespace multi_draw
+{
+	//! \brief Meshes sharing all their state, drawn with a single call.
+	//!
+	//! `counts`, `offsets` and `base_vertices` only cover the meshes
+	//! currently visible, see `setVisibleMeshes()`.
+	struct batch {
+		std::size_t first_mesh{0u};            //!< index of the first mesh of the batch, whose state all others share
+		GLuint vao{0u};                        //!< Vertex Array Object shared by all meshes of the batch
+		GLenum drawing_mode{GL_TRIANGLES};     //!< OpenGL drawing mode shared by all meshes of the batch
+		GLenum index_type{GL_UNSIGNED_INT};    //!< type of the indices shared by all meshes of the batch
+		std::vector<std::size_t> meshes;       //!< index of every mesh of the batch, visible or not
+		std::vector<GLsizei> counts;           //!< per visible mesh, number of indices
+		std::vector<GLvoid const*> offsets;    //!< per visible mesh, offset in bytes of its first index
+		std::vector<GLint> base_vertices;      //!< per visible mesh, offset of its first vertex
+		GLintptr indirect_offset{0};           //!< offset in bytes of the batch's commands in the indirect buffer
+	};
+
+	//! \brief Indices and vertices drawn for a mesh.
+	struct range {
+		GLsizei count{0};
+		GLuint first_index{0u};
+		GLint base_vertex{0};
+	};
+
+	//! \brief Batches covering all meshes drawn by a pass.
+	struct pass {
+		std::vector<batch> batches;
+		std::vector<range> ranges;             //!< per mesh given to `createPass()`, what is drawn for it
+		GLuint indirect_buffer{0u};            //!< draw commands of all batches, on OpenGL 4.3 and later
+	};
+
+	//! \brief Group meshes into batches.
+	//!
+	//! Meshes end up in the same batch if they share their Vertex Array
+	//! Object, drawing mode, index type and the state returned by
+	//! `get_state`; the
+	//! meshes need to be indexed, and are best loaded with shared
+	//! buffers, see `bonobo::loadObjects()`.
+	//!
+	//! @param [in] meshes to draw
+	//! @param [in] get_state function returning, for the index of a mesh,
+	//!             the values the pass binds or sets for that mesh, like
+	//!             its textures
+	pass createPass(std::vector<bonobo::mesh_data> const& meshes,
+	                std::function<std::vector<GLuint> (std::size_t)> const& get_state);
+
+	//! \brief Draw the visible meshes of a batch.
+	//!
+	//! With OpenGL 4.3 and later this is one `glMultiDrawElementsIndirect()`
+	//! reading from the pass' indirect buffer, and one
+	//! `glMultiDrawElementsBaseVertex()` otherwise; the Vertex Array Object
+	//! is bound if needed.
+	void draw(pass const& pass, batch const& batch);
+
+	//! \brief Only draw some of the meshes of a pass, until the next call.
+	//!
+	//! Batches left without any visible mesh have empty `counts`, and
+	//! drawing them does nothing; with OpenGL 4.3 and later, the indirect
+	//! buffer is filled again.
+	//!
+	//! @param [in] visible_meshes indices, into the meshes given to
+	//!             `createPass()`, of the meshes to draw, like the ones
+	//!             written by `FrustumCuller::cull()`
+	void setVisibleMeshes(pass& pass, std::vector<std::uint32_t> const& visible_meshes);
+
+	//! \brief Release the OpenGL objects of a pass.
+	void destroyPass(pass& pass);
+}
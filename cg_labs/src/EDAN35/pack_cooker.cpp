@@ -0,0 +1,57 @@
+// Offline cooker for object/scene files.
+//
+// Imports each file given on the command line with Assimp, or Sponza if
+// none is, and writes the pack `bonobo::loadObjects()` maps instead of
+// importing the file again, as long as the file and its images do not
+// change. Cook again after editing any of them.
+
+#include "config.hpp"
+#include "core/helpers.hpp"
+#include "core/Log.h"
+
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool
+	parseArguments(int argc, char* argv[], std::vector<std::string>& filenames)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string const arg = argv[i];
+			if (arg.compare(0, 2, "--") == 0) {
+				LogError("Unknown option \"%s\"; expected paths to object/scene files", arg.c_str());
+				return false;
+			}
+			filenames.push_back(arg);
+		}
+		if (filenames.empty())
+			filenames.push_back(config::resources_path("sponza/sponza.obj"));
+		return true;
+	}
+
+	bool
+	cook(std::vector<std::string> const& filenames)
+	{
+		bool success = true;
+		for (auto const& filename : filenames)
+			success &= bonobo::cookObjects(filename);
+		return success;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::setlocale(LC_ALL, "");
+
+	Log::Init();
+
+	std::vector<std::string> filenames;
+	bool const success = parseArguments(argc, argv, filenames) && cook(filenames);
+
+	Log::Destroy();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,5 +1,7 @@
 #include "parametric_shapes.hpp"
+#include "core/GLStateCache.hpp"
 #include "core/Log.h"
+#include "core/MeshOptimizer.hpp"
 
 #include <glm/glm.hpp>
 
@@ -78,8 +80,10 @@ parametric_shapes::createQuad(float const width, float const height,
 
 
 
+	data.bounds = bonobo::computeBounds(vertices.data(), vertices.size());
+
 	glGenVertexArrays(1, &data.vao);
-	glBindVertexArray(data.vao);
+	utils::opengl::state::bindVertexArray(data.vao);
 
 
 	auto const vertices_offset = 0u;
@@ -137,7 +141,7 @@ parametric_shapes::createQuad(float const width, float const height,
 
 	data.indices_nb = index_sets.size() * 3u;
 
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(0u);
 	glBindBuffer(GL_ARRAY_BUFFER, 0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
@@ -221,10 +225,21 @@ parametric_shapes::createSphere(float const radius,
 
 
 
+	// The rows above are far apart in the vertex cache; reorder the
+	// triangles around shared vertices, and the vertices to match.
+	std::vector<GLuint> remap;
+	auto const acmr = mesh_optimizer::optimize(reinterpret_cast<GLuint*>(index_sets.data()), index_sets.size() * 3u,
+	                                          vertices.data(), vertices.size(), remap);
+	for (auto* attribute : { &vertices, &normals, &texcoords, &tangents, &binormals })
+		*attribute = mesh_optimizer::remapVertices(attribute->data(), remap);
+	LogTrivia("Sphere triangles reordered for the vertex cache: ACMR %.3f → %.3f", acmr.acmr_before, acmr.acmr_after);
+
 	bonobo::mesh_data data;
+	data.bounds = bonobo::computeBounds(vertices.data(), vertices.size());
+
 	glGenVertexArrays(1, &data.vao);
 	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
+	utils::opengl::state::bindVertexArray(data.vao);
 
 	auto const vertices_offset = 0u;
 	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
@@ -277,7 +292,7 @@ parametric_shapes::createSphere(float const radius,
 
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(index_sets.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(index_sets.data()), GL_STATIC_DRAW);
 
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
 	return data;
@@ -355,10 +370,20 @@ parametric_shapes::createTorus(float const major_radius,
 		}
 	}
 
+	// Same reordering as for the sphere grid.
+	std::vector<GLuint> remap;
+	auto const acmr = mesh_optimizer::optimize(reinterpret_cast<GLuint*>(index_sets.data()), index_sets.size() * 3u,
+	                                          vertices.data(), vertices.size(), remap);
+	for (auto* attribute : { &vertices, &normals, &texcoords, &tangents, &binormals })
+		*attribute = mesh_optimizer::remapVertices(attribute->data(), remap);
+	LogTrivia("Torus triangles reordered for the vertex cache: ACMR %.3f → %.3f", acmr.acmr_before, acmr.acmr_after);
+
 	bonobo::mesh_data data;
+	data.bounds = bonobo::computeBounds(vertices.data(), vertices.size());
+
 	glGenVertexArrays(1, &data.vao);
 	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
+	utils::opengl::state::bindVertexArray(data.vao);
 
 	auto const vertices_offset = 0u;
 	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
@@ -409,7 +434,7 @@ parametric_shapes::createTorus(float const major_radius,
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(index_sets.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(index_sets.data()), GL_STATIC_DRAW);
 
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
 	return data;
@@ -497,9 +522,11 @@ parametric_shapes::createCircleRing(float const radius,
 	}
 
 	bonobo::mesh_data data;
+	data.bounds = bonobo::computeBounds(vertices.data(), vertices.size());
+
 	glGenVertexArrays(1, &data.vao);
 	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
+	utils::opengl::state::bindVertexArray(data.vao);
 
 	auto const vertices_offset = 0u;
 	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
@@ -550,7 +577,7 @@ parametric_shapes::createCircleRing(float const radius,
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(index_sets.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(index_sets.data()), GL_STATIC_DRAW);
 
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
 	return data;
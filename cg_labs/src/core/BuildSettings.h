@@ -27,7 +27,7 @@
 #define ENABLE_PROFILING				1
 
 /*
-*	Enables (1) or disables (0) GL render state inspection (found in GLStateInspection.h)
+*	Enables (1) or disables (0) GL render state inspection (found in GLStateCache.hpp)
 *	Turn off for maximum performance.
 */
 #define ENABLE_GL_STATE_INSPECTION		1
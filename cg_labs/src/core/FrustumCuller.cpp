@@ -0,0 +1,117 @@
+#include "FrustumCuller.hpp"
+
+#include <array>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define FRUSTUM_CULLER_USE_SSE 1
+#	include <xmmintrin.h>
+#else
+#	define FRUSTUM_CULLER_USE_SSE 0
+#endif
+
+namespace
+{
+	std::size_t const lanes_nb = 4u;
+
+	// Planes (a, b, c, d) such that a point p is inside when
+	// a * p.x + b * p.y + c * p.z + d >= 0; they are not normalised, which
+	// does not matter as only the sign of the distance is used.
+	using Planes = std::array<glm::vec4, 6>;
+
+	Planes extractPlanes(glm::mat4 const& view_projection)
+	{
+		// glm matrices are column-major: view_projection[column][row].
+		auto const row = [&view_projection](int i){
+			return glm::vec4(view_projection[0][i], view_projection[1][i],
+			                 view_projection[2][i], view_projection[3][i]);
+		};
+		auto const x = row(0);
+		auto const y = row(1);
+		auto const z = row(2);
+		auto const w = row(3);
+		return {{ w + x, w - x, w + y, w - y, w + z, w - z }};
+	}
+}
+
+void
+FrustumCuller::set_boxes(std::vector<bonobo::mesh_data> const& meshes, glm::mat4 const& world)
+{
+	_boxes_nb = meshes.size();
+	auto const padded_nb = (_boxes_nb + lanes_nb - 1u) / lanes_nb * lanes_nb;
+	for (auto* values : { &_centres_x, &_centres_y, &_centres_z, &_extents_x, &_extents_y, &_extents_z })
+		values->assign(padded_nb, 0.0f);
+
+	// The extents of the transformed box are the ones of the box weighed
+	// by the absolute values of the linear part of the transform.
+	auto const linear = glm::mat3(world);
+	auto const absolute_linear = glm::mat3(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+	for (std::size_t i = 0u; i < _boxes_nb; ++i) {
+		auto const& bounds = meshes[i].bounds;
+		auto const centre = glm::vec3(world * glm::vec4(0.5f * (bounds.min + bounds.max), 1.0f));
+		auto const extent = absolute_linear * (0.5f * (bounds.max - bounds.min));
+		_centres_x[i] = centre.x;
+		_centres_y[i] = centre.y;
+		_centres_z[i] = centre.z;
+		_extents_x[i] = extent.x;
+		_extents_y[i] = extent.y;
+		_extents_z[i] = extent.z;
+	}
+}
+
+FrustumCuller::Stats
+FrustumCuller::cull(glm::mat4 const& view_projection, std::vector<std::uint32_t>& visible) const
+{
+	visible.clear();
+
+	auto const planes = extractPlanes(view_projection);
+	for (std::size_t first = 0u; first < _boxes_nb; first += lanes_nb) {
+		unsigned int outside_mask = 0u; // bit i is set if box first + i is culled
+#if FRUSTUM_CULLER_USE_SSE
+		auto const centres_x = _mm_loadu_ps(_centres_x.data() + first);
+		auto const centres_y = _mm_loadu_ps(_centres_y.data() + first);
+		auto const centres_z = _mm_loadu_ps(_centres_z.data() + first);
+		auto const extents_x = _mm_loadu_ps(_extents_x.data() + first);
+		auto const extents_y = _mm_loadu_ps(_extents_y.data() + first);
+		auto const extents_z = _mm_loadu_ps(_extents_z.data() + first);
+		auto outside = _mm_setzero_ps();
+		for (auto const& plane : planes) {
+			auto distances = _mm_add_ps(_mm_mul_ps(centres_x, _mm_set1_ps(plane.x)),
+			                            _mm_mul_ps(centres_y, _mm_set1_ps(plane.y)));
+			distances = _mm_add_ps(distances, _mm_mul_ps(centres_z, _mm_set1_ps(plane.z)));
+			distances = _mm_add_ps(distances, _mm_set1_ps(plane.w));
+			auto radii = _mm_add_ps(_mm_mul_ps(extents_x, _mm_set1_ps(std::abs(plane.x))),
+			                        _mm_mul_ps(extents_y, _mm_set1_ps(std::abs(plane.y))));
+			radii = _mm_add_ps(radii, _mm_mul_ps(extents_z, _mm_set1_ps(std::abs(plane.z))));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distances, radii), _mm_setzero_ps()));
+		}
+		outside_mask = static_cast<unsigned int>(_mm_movemask_ps(outside));
+#else
+		for (std::size_t lane = 0u; lane < lanes_nb; ++lane) {
+			auto const i = first + lane;
+			for (auto const& plane : planes) {
+				auto const distance = plane.x * _centres_x[i] + plane.y * _centres_y[i] + plane.z * _centres_z[i] + plane.w;
+				auto const radius = std::abs(plane.x) * _extents_x[i] + std::abs(plane.y) * _extents_y[i] + std::abs(plane.z) * _extents_z[i];
+				if (distance + radius < 0.0f) {
+					outside_mask |= 1u << lane;
+					break;
+				}
+			}
+		}
+#endif
+		for (std::size_t lane = 0u; lane < lanes_nb && first + lane < _boxes_nb; ++lane)
+			if ((outside_mask & (1u << lane)) == 0u)
+				visible.push_back(static_cast<std::uint32_t>(first + lane));
+	}
+
+	Stats stats;
+	stats.tested = _boxes_nb;
+	stats.culled = _boxes_nb - visible.size();
+	return stats;
+}
+
+std::size_t
+FrustumCuller::size() const
+{
+	return _boxes_nb;
+}
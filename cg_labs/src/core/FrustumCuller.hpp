@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/helpers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \brief Tests the bounding boxes of meshes against view frustums, to
+//!        only draw the meshes a view can see.
+//!
+//! The world-space boxes are stored as separate arrays of centres and
+//! half-extents, so that four of them are tested against a plane at once
+//! with SSE; a scalar loop is used on other architectures. A box is culled
+//! as soon as it lies entirely on the outer side of one of the six planes
+//! of the frustum; boxes crossing a corner outside of the frustum are
+//! conservatively kept.
+class FrustumCuller
+{
+public:
+	//! \brief Counters of a call to `cull()`.
+	struct Stats {
+		std::size_t tested{ 0u };
+		std::size_t culled{ 0u };
+	};
+
+	//! \brief Replace the boxes to test by the ones of some meshes.
+	//!
+	//! @param [in] meshes whose `bounds` are used; the indices written by
+	//!             `cull()` refer to this vector
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space, shared by all meshes
+	void set_boxes(std::vector<bonobo::mesh_data> const& meshes,
+	               glm::mat4 const& world = glm::mat4(1.0f));
+
+	//! \brief Find the boxes at least partially inside a frustum.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to
+	//!             clip-space, of the camera or light whose frustum is tested
+	//! @param [out] visible indices, in increasing order, of the boxes
+	//!              that are not culled; previous content is dropped
+	//! @return how many boxes were tested and culled
+	Stats cull(glm::mat4 const& view_projection, std::vector<std::uint32_t>& visible) const;
+
+	//! \brief Return the number of boxes tested by `cull()`.
+	std::size_t size() const;
+
+private:
+	// Padded to a multiple of 4 boxes, the padding is never reported.
+	std::vector<float> _centres_x;
+	std::vector<float> _centres_y;
+	std::vector<float> _centres_z;
+	std::vector<float> _extents_x;
+	std::vector<float> _extents_y;
+	std::vector<float> _extents_z;
+	std::size_t _boxes_nb{ 0u };
+};
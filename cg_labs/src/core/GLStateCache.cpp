@@ -0,0 +1,211 @@
+#include "GLStateCache.hpp"
+
+#include "Log.h"
+
+#include <vector>
+
+
+namespace
+{
+	GLuint const unknown = ~0u;
+
+	struct TextureBinding {
+		GLenum target{ GL_NONE };
+		GLuint texture{ unknown };
+	};
+
+	struct Cache {
+		GLuint program{ unknown };
+		GLuint vao{ unknown };
+		GLuint draw_framebuffer{ unknown };
+		GLuint read_framebuffer{ unknown };
+		GLenum active_texture{ GL_NONE };
+		std::vector<TextureBinding> textures; // per texture unit
+		std::vector<GLuint> samplers;         // per texture unit
+	};
+
+	Cache cache;
+	utils::opengl::state::Stats current_frame_stats;
+	utils::opengl::state::Stats last_frame_stats;
+
+	bool count(bool issued)
+	{
+		if (issued)
+			++current_frame_stats.issued;
+		else
+			++current_frame_stats.elided;
+		return issued;
+	}
+
+#if ENABLE_GL_STATE_INSPECTION
+	GLenum getBindingQuery(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_1D:                   return GL_TEXTURE_BINDING_1D;
+		case GL_TEXTURE_1D_ARRAY:             return GL_TEXTURE_BINDING_1D_ARRAY;
+		case GL_TEXTURE_2D:                   return GL_TEXTURE_BINDING_2D;
+		case GL_TEXTURE_2D_ARRAY:             return GL_TEXTURE_BINDING_2D_ARRAY;
+		case GL_TEXTURE_2D_MULTISAMPLE:       return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+		case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY;
+		case GL_TEXTURE_3D:                   return GL_TEXTURE_BINDING_3D;
+		case GL_TEXTURE_BUFFER:               return GL_TEXTURE_BINDING_BUFFER;
+		case GL_TEXTURE_CUBE_MAP:             return GL_TEXTURE_BINDING_CUBE_MAP;
+		case GL_TEXTURE_CUBE_MAP_ARRAY:       return GL_TEXTURE_BINDING_CUBE_MAP_ARRAY;
+		case GL_TEXTURE_RECTANGLE:            return GL_TEXTURE_BINDING_RECTANGLE;
+		default:                              return GL_NONE;
+		}
+	}
+
+	bool check(char const* binding, GLuint cached, GLenum query)
+	{
+		if (cached == unknown)
+			return true;
+
+		GLint actual = 0;
+		glGetIntegerv(query, &actual);
+		if (static_cast<GLuint>(actual) == cached)
+			return true;
+
+		LogError("State cache out of sync: %s is %d but %u was expected.", binding, actual, cached);
+		return false;
+	}
+#endif
+}
+
+bool
+utils::opengl::state::useProgram(GLuint program)
+{
+	if (!count(cache.program != program))
+		return false;
+	glUseProgram(program);
+	cache.program = program;
+	return true;
+}
+
+bool
+utils::opengl::state::bindVertexArray(GLuint vao)
+{
+	if (!count(cache.vao != vao))
+		return false;
+	glBindVertexArray(vao);
+	cache.vao = vao;
+	return true;
+}
+
+bool
+utils::opengl::state::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool const draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+	bool const read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+	bool const changed = (draw && cache.draw_framebuffer != framebuffer)
+	                  || (read && cache.read_framebuffer != framebuffer);
+	if (!count(changed))
+		return false;
+	glBindFramebuffer(target, framebuffer);
+	if (draw)
+		cache.draw_framebuffer = framebuffer;
+	if (read)
+		cache.read_framebuffer = framebuffer;
+	return true;
+}
+
+bool
+utils::opengl::state::activeTexture(GLenum texture)
+{
+	if (!count(cache.active_texture != texture))
+		return false;
+	glActiveTexture(texture);
+	cache.active_texture = texture;
+	return true;
+}
+
+bool
+utils::opengl::state::bindTexture(GLenum target, GLuint texture)
+{
+	if (cache.active_texture == GL_NONE) {
+		// The active unit is unknown, so its binding can not be either.
+		count(true);
+		glBindTexture(target, texture);
+		return true;
+	}
+
+	auto const unit = static_cast<std::size_t>(cache.active_texture - GL_TEXTURE0);
+	if (cache.textures.size() <= unit)
+		cache.textures.resize(unit + 1u);
+	auto& binding = cache.textures[unit];
+	if (!count(binding.target != target || binding.texture != texture))
+		return false;
+	glBindTexture(target, texture);
+	binding.target = target;
+	binding.texture = texture;
+	return true;
+}
+
+bool
+utils::opengl::state::bindSampler(GLuint unit, GLuint sampler)
+{
+	if (cache.samplers.size() <= unit)
+		cache.samplers.resize(unit + 1u, unknown);
+	if (!count(cache.samplers[unit] != sampler))
+		return false;
+	glBindSampler(unit, sampler);
+	cache.samplers[unit] = sampler;
+	return true;
+}
+
+void
+utils::opengl::state::invalidate()
+{
+	cache = Cache();
+}
+
+bool
+utils::opengl::state::validate()
+{
+#if ENABLE_GL_STATE_INSPECTION
+	bool valid = true;
+	valid &= check("the current program", cache.program, GL_CURRENT_PROGRAM);
+	valid &= check("the vertex array", cache.vao, GL_VERTEX_ARRAY_BINDING);
+	valid &= check("the draw framebuffer", cache.draw_framebuffer, GL_DRAW_FRAMEBUFFER_BINDING);
+	valid &= check("the read framebuffer", cache.read_framebuffer, GL_READ_FRAMEBUFFER_BINDING);
+	if (cache.active_texture == GL_NONE)
+		return valid;
+	valid &= check("the active texture unit", cache.active_texture, GL_ACTIVE_TEXTURE);
+
+	// Querying per-unit bindings requires switching units; the active
+	// one is restored afterwards.
+	for (std::size_t unit = 0u; unit < cache.textures.size() || unit < cache.samplers.size(); ++unit) {
+		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+		if (unit < cache.textures.size() && cache.textures[unit].target != GL_NONE) {
+			auto const query = getBindingQuery(cache.textures[unit].target);
+			if (query != GL_NONE)
+				valid &= check("a texture binding", cache.textures[unit].texture, query);
+		}
+		if (unit < cache.samplers.size())
+			valid &= check("a sampler binding", cache.samplers[unit], GL_SAMPLER_BINDING);
+	}
+	glActiveTexture(cache.active_texture);
+
+	return valid;
+#else
+	return true;
+#endif
+}
+
+void
+utils::opengl::state::endFrame()
+{
+#if ENABLE_GL_STATE_INSPECTION && !defined(NDEBUG)
+	if (!validate())
+		invalidate();
+#endif
+	last_frame_stats = current_frame_stats;
+	current_frame_stats = Stats();
+}
+
+utils::opengl::state::Stats const&
+utils::opengl::state::getFrameStats()
+{
+	return last_frame_stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+
+namespace utils
+{
+
+namespace opengl
+{
+
+//! \brief Drop-in replacements for the OpenGL binding calls, which keep a
+//!        shadow copy of the bindings and skip calls that would not change
+//!        them.
+//!
+//! The shadow copy is only right as long as every binding goes through
+//! these functions; code changing bindings behind their back, or deleting
+//! bound objects, has to call `invalidate()` afterwards. Dear ImGui's
+//! renderer restores what it changes, so it does not need to.
+//!
+//! Every function returns whether the call was forwarded to OpenGL.
+namespace state
+{
+
+//! \brief Counters of forwarded and skipped calls.
+struct Stats {
+	std::size_t issued{ 0u };
+	std::size_t elided{ 0u };
+};
+
+bool useProgram(GLuint program);
+bool bindVertexArray(GLuint vao);
+
+//! \brief Bind a framebuffer; `GL_FRAMEBUFFER` binds both the draw and
+//!        the read framebuffers, like `glBindFramebuffer()`.
+bool bindFramebuffer(GLenum target, GLuint framebuffer);
+
+//! \brief Select the texture unit used by `bindTexture()`; takes
+//!        `GL_TEXTURE0 + i` like `glActiveTexture()`.
+bool activeTexture(GLenum texture);
+
+//! \brief Bind a texture to the active texture unit.
+//!
+//! Only the last target bound on each unit is remembered, so alternating
+//! targets on a unit is never skipped.
+bool bindTexture(GLenum target, GLuint texture);
+
+bool bindSampler(GLuint unit, GLuint sampler);
+
+//! \brief Forget the shadow copy, so that the next call of each kind is
+//!        forwarded whatever its arguments.
+void invalidate();
+
+//! \brief Compare the shadow copy against the actual OpenGL state, and
+//!        log every binding that differs.
+//!
+//! It stalls the pipeline, and is only compiled in when
+//! `ENABLE_GL_STATE_INSPECTION` is set; it always succeeds otherwise.
+//!
+//! @return whether the shadow copy matches
+bool validate();
+
+//! \brief Close the counters of the current frame, see `getFrameStats()`.
+//!
+//! Debug builds with `ENABLE_GL_STATE_INSPECTION` also `validate()` the
+//! shadow copy. `WindowManager::RenderImGuiFrame()` calls it once per
+//! frame.
+void endFrame();
+
+//! \brief Return the counters of the last frame closed by `endFrame()`.
+Stats const& getFrameStats();
+
+} // end of namespace state
+
+} // end of namespace opengl
+
+} // end of namespace utils
@@ -0,0 +1,61 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(std::size_t workers_nb)
+{
+	if (workers_nb == 0u) {
+		auto const hardware_threads_nb = static_cast<std::size_t>(std::thread::hardware_concurrency());
+		workers_nb = std::max<std::size_t>(hardware_threads_nb, 2u) - 1u;
+	}
+
+	_workers.reserve(workers_nb);
+	for (std::size_t i = 0u; i < workers_nb; ++i)
+		_workers.emplace_back(&JobSystem::work, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_jobs.clear();
+	}
+	_job_queued.notify_all();
+
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+std::size_t
+JobSystem::workers_nb() const
+{
+	return _workers.size();
+}
+
+void
+JobSystem::enqueue(std::function<void ()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+	_job_queued.notify_one();
+}
+
+void
+JobSystem::work()
+{
+	for (;;) {
+		std::function<void ()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_job_queued.wait(lock, [this](){ return _stopping || !_jobs.empty(); });
+			if (_stopping)
+				return;
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+		job();
+	}
+}
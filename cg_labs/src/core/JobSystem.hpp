@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//! \brief Pool of worker threads running jobs in submission order.
+//!
+//! Jobs run without an OpenGL context and must not call OpenGL, nor log:
+//! the logger is not thread-safe. They should not wait on the result of
+//! other jobs either, as all workers could end up waiting.
+class JobSystem
+{
+public:
+	//! \brief Start the worker threads.
+	//!
+	//! @param [in] workers_nb number of worker threads; 0 picks one less
+	//!             than the number of hardware threads, and at least one
+	explicit JobSystem(std::size_t workers_nb = 0u);
+
+	//! \brief Wait for the running jobs, and drop the queued ones.
+	~JobSystem();
+
+	JobSystem(JobSystem const&) = delete;
+	JobSystem& operator=(JobSystem const&) = delete;
+
+	//! \brief Queue a job.
+	//!
+	//! @param [in] job function taking no argument
+	//! @return the future result of `job`; it holds a `std::future_error`
+	//!         if the job was dropped before running
+	template<typename F, typename R = decltype(std::declval<F&>()())>
+	std::future<R> submit(F&& job)
+	{
+		auto task = std::make_shared<std::packaged_task<R ()>>(std::forward<F>(job));
+		auto future = task->get_future();
+		enqueue([task](){ (*task)(); });
+		return future;
+	}
+
+	//! \brief Return the number of worker threads.
+	std::size_t workers_nb() const;
+
+private:
+	void enqueue(std::function<void ()> job);
+	void work();
+
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void ()>> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _job_queued;
+	bool _stopping{ false };
+};
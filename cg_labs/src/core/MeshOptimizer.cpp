@@ -0,0 +1,272 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+	// FIFO post-transform cache; a vertex is cached if it was one of the
+	// last `size` vertices to miss.
+	class VertexCache
+	{
+	public:
+		VertexCache(std::size_t vertices_nb, std::size_t size) : _inserted_at(vertices_nb, 0u), _size(size) {}
+
+		// Returns whether the vertex was transformed.
+		bool fetch(GLuint vertex)
+		{
+			auto& inserted_at = _inserted_at[vertex];
+			if (inserted_at != 0u && _misses_nb - inserted_at < _size)
+				return false;
+			inserted_at = ++_misses_nb;
+			return true;
+		}
+
+		void flush()
+		{
+			_misses_nb += _size;
+		}
+
+	private:
+		std::vector<std::size_t> _inserted_at; // 1-based miss count at insertion, 0 if never
+		std::size_t _misses_nb{ 0u };
+		std::size_t _size;
+	};
+
+	// Next vertex to fan around once all candidates are dead ends: the
+	// last vertex emitted that still has triangles left, or the next one
+	// in order.
+	long skipDeadEnd(std::vector<GLuint>& dead_ends, std::vector<std::uint32_t> const& live_triangles_nb,
+	                 std::size_t& cursor)
+	{
+		while (!dead_ends.empty()) {
+			auto const vertex = dead_ends.back();
+			dead_ends.pop_back();
+			if (live_triangles_nb[vertex] > 0u)
+				return static_cast<long>(vertex);
+		}
+		for (; cursor < live_triangles_nb.size(); ++cursor)
+			if (live_triangles_nb[cursor] > 0u)
+				return static_cast<long>(cursor);
+		return -1;
+	}
+}
+
+float
+mesh_optimizer::computeACMR(GLuint const* indices, std::size_t indices_nb, std::size_t vertices_nb, std::size_t cache_size)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return 0.0f;
+
+	VertexCache cache(vertices_nb, cache_size);
+	std::size_t misses_nb = 0u;
+	for (std::size_t i = 0u; i < triangles_nb * 3u; ++i)
+		misses_nb += cache.fetch(indices[i]) ? 1u : 0u;
+	return static_cast<float>(misses_nb) / static_cast<float>(triangles_nb);
+}
+
+std::vector<std::size_t>
+mesh_optimizer::optimizeVertexCache(GLuint* indices, std::size_t indices_nb, std::size_t vertices_nb, std::size_t cache_size)
+{
+	std::vector<std::size_t> clusters;
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return clusters;
+
+	// Triangles using each vertex, stored one vertex after the other.
+	std::vector<std::uint32_t> live_triangles_nb(vertices_nb, 0u);
+	for (std::size_t i = 0u; i < triangles_nb * 3u; ++i)
+		++live_triangles_nb[indices[i]];
+	std::vector<std::size_t> first_adjacent(vertices_nb + 1u, 0u);
+	for (std::size_t v = 0u; v < vertices_nb; ++v)
+		first_adjacent[v + 1u] = first_adjacent[v] + live_triangles_nb[v];
+	std::vector<std::uint32_t> adjacent_triangles(first_adjacent.back());
+	{
+		auto next = first_adjacent;
+		for (std::size_t t = 0u; t < triangles_nb; ++t)
+			for (std::size_t c = 0u; c < 3u; ++c)
+				adjacent_triangles[next[indices[3u * t + c]]++] = static_cast<std::uint32_t>(t);
+	}
+
+	// Time advances with each cache miss; a vertex is cached while less
+	// than `cache_size` misses happened since it was transformed.
+	std::vector<std::size_t> timestamps(vertices_nb, 0u);
+	std::vector<bool> is_emitted(triangles_nb, false);
+	std::vector<GLuint> dead_ends;
+	std::vector<GLuint> candidates;
+	std::vector<GLuint> output;
+	output.reserve(triangles_nb * 3u);
+	auto time = cache_size + 1u;
+	std::size_t cursor = 0u;
+
+	clusters.push_back(0u);
+	auto fanning = static_cast<long>(indices[0]);
+	while (fanning >= 0) {
+		candidates.clear();
+		auto const vertex = static_cast<std::size_t>(fanning);
+		for (auto a = first_adjacent[vertex]; a < first_adjacent[vertex + 1u]; ++a) {
+			auto const t = adjacent_triangles[a];
+			if (is_emitted[t])
+				continue;
+			for (std::size_t c = 0u; c < 3u; ++c) {
+				auto const v = indices[3u * t + c];
+				output.push_back(v);
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				--live_triangles_nb[v];
+				if (time - timestamps[v] > cache_size)
+					timestamps[v] = time++;
+			}
+			is_emitted[t] = true;
+		}
+
+		// Prefer the candidate that entered the cache first, as long as
+		// fanning around it keeps it in the cache; any candidate with
+		// triangles left beats none.
+		long next = -1;
+		long next_priority = -1;
+		for (auto const v : candidates) {
+			if (live_triangles_nb[v] == 0u)
+				continue;
+			long priority = 0;
+			if (time - timestamps[v] + 2u * live_triangles_nb[v] <= cache_size)
+				priority = static_cast<long>(time - timestamps[v]);
+			if (priority > next_priority) {
+				next = static_cast<long>(v);
+				next_priority = priority;
+			}
+		}
+		if (next < 0) {
+			next = skipDeadEnd(dead_ends, live_triangles_nb, cursor);
+			if (next >= 0 && time - timestamps[static_cast<std::size_t>(next)] > cache_size)
+				clusters.push_back(output.size() / 3u);
+		}
+		fanning = next;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+	return clusters;
+}
+
+void
+mesh_optimizer::optimizeOverdraw(GLuint* indices, std::size_t indices_nb, glm::vec3 const* vertices, std::size_t vertices_nb,
+                                 std::vector<std::size_t> const& clusters, float threshold, std::size_t cache_size)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb < 2u || clusters.empty())
+		return;
+
+	// Split clusters where restarting the cache costs little.
+	auto const target_acmr = threshold * computeACMR(indices, indices_nb, vertices_nb, cache_size);
+	std::vector<std::size_t> starts;
+	VertexCache cache(vertices_nb, cache_size);
+	for (std::size_t c = 0u; c < clusters.size(); ++c) {
+		auto const end = c + 1u < clusters.size() ? clusters[c + 1u] : triangles_nb;
+		starts.push_back(clusters[c]);
+		cache.flush();
+		std::size_t misses_nb = 0u, cluster_triangles_nb = 0u;
+		for (auto t = clusters[c]; t < end; ++t) {
+			for (std::size_t i = 0u; i < 3u; ++i)
+				misses_nb += cache.fetch(indices[3u * t + i]) ? 1u : 0u;
+			++cluster_triangles_nb;
+			if (t + 1u < end && static_cast<float>(misses_nb) <= target_acmr * static_cast<float>(cluster_triangles_nb)) {
+				starts.push_back(t + 1u);
+				cache.flush();
+				misses_nb = 0u;
+				cluster_triangles_nb = 0u;
+			}
+		}
+	}
+
+	// Clusters are sorted on the alignment of their mean normal with the
+	// direction from the centroid of the mesh to theirs.
+	struct Cluster {
+		std::size_t start;
+		std::size_t end;
+		glm::vec3 centroid{ 0.0f };  // weighed by area
+		glm::vec3 normal{ 0.0f };    // sum of normals weighed by area
+		float area{ 0.0f };
+		float sort_key{ 0.0f };
+	};
+	std::vector<Cluster> sorted_clusters(starts.size());
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	for (std::size_t c = 0u; c < starts.size(); ++c) {
+		auto& cluster = sorted_clusters[c];
+		cluster.start = starts[c];
+		cluster.end = c + 1u < starts.size() ? starts[c + 1u] : triangles_nb;
+		for (auto t = cluster.start; t < cluster.end; ++t) {
+			auto const& p0 = vertices[indices[3u * t + 0u]];
+			auto const& p1 = vertices[indices[3u * t + 1u]];
+			auto const& p2 = vertices[indices[3u * t + 2u]];
+			auto const normal = glm::cross(p1 - p0, p2 - p0);
+			auto const area = 0.5f * glm::length(normal);
+			cluster.centroid += area * (p0 + p1 + p2) / 3.0f;
+			cluster.normal += normal;
+			cluster.area += area;
+		}
+		mesh_centroid += cluster.centroid;
+		mesh_area += cluster.area;
+		if (cluster.area > 0.0f)
+			cluster.centroid /= cluster.area;
+	}
+	if (mesh_area <= 0.0f)
+		return;
+	mesh_centroid /= mesh_area;
+	for (auto& cluster : sorted_clusters) {
+		auto const normal_length = glm::length(cluster.normal);
+		if (normal_length > 0.0f)
+			cluster.sort_key = glm::dot(cluster.centroid - mesh_centroid, cluster.normal / normal_length);
+	}
+	std::stable_sort(sorted_clusters.begin(), sorted_clusters.end(), [](Cluster const& a, Cluster const& b){
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector<GLuint> output;
+	output.reserve(triangles_nb * 3u);
+	for (auto const& cluster : sorted_clusters)
+		output.insert(output.end(), indices + 3u * cluster.start, indices + 3u * cluster.end);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<GLuint>
+mesh_optimizer::optimizeVertexFetch(GLuint* indices, std::size_t indices_nb, std::size_t vertices_nb)
+{
+	auto const unassigned = std::numeric_limits<GLuint>::max();
+	std::vector<GLuint> remap(vertices_nb, unassigned);
+	GLuint next = 0u;
+	for (std::size_t i = 0u; i < indices_nb; ++i) {
+		auto& number = remap[indices[i]];
+		if (number == unassigned)
+			number = next++;
+		indices[i] = number;
+	}
+	for (auto& number : remap)
+		if (number == unassigned)
+			number = next++;
+	return remap;
+}
+
+mesh_optimizer::Stats
+mesh_optimizer::optimize(GLuint* indices, std::size_t indices_nb, glm::vec3 const* vertices, std::size_t vertices_nb,
+                         std::vector<GLuint>& remap)
+{
+	Stats stats;
+	stats.acmr_before = computeACMR(indices, indices_nb, vertices_nb);
+
+	// Small meshes, already cached as a whole, can come out slightly
+	// worse; their original order is kept then.
+	std::vector<GLuint> const original(indices, indices + indices_nb);
+	auto const clusters = optimizeVertexCache(indices, indices_nb, vertices_nb);
+	optimizeOverdraw(indices, indices_nb, vertices, vertices_nb, clusters);
+	stats.acmr_after = computeACMR(indices, indices_nb, vertices_nb);
+	if (stats.acmr_after > stats.acmr_before) {
+		std::copy(original.begin(), original.end(), indices);
+		stats.acmr_after = stats.acmr_before;
+	}
+
+	remap = optimizeVertexFetch(indices, indices_nb, vertices_nb);
+	return stats;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+//! \brief Reordering of indexed triangle lists, so that they are cheaper to
+//!        draw without changing what is drawn.
+//!
+//! The passes, run in order by `optimize()`, are:
+//!
+//! 1. `optimizeVertexCache()`: Tipsify [Sander et al. 2007], which orders
+//!    triangles in fans around vertices still in the post-transform cache;
+//! 2. `optimizeOverdraw()`: reorders the clusters of triangles between the
+//!    points where the cache had to be restarted anyway, so that clusters
+//!    facing away from the centre of the mesh, likely to hide the others,
+//!    come first and early depth tests reject more fragments;
+//! 3. `optimizeVertexFetch()`: renumbers vertices in the order triangles
+//!    first use them, so that vertex fetches walk through memory.
+//!
+//! The cache is modelled as a FIFO of `default_cache_size` vertices, and
+//! its efficiency given as the Average Cache Miss Ratio: vertices
+//! transformed per triangle, between 3 for no reuse and about 0.5.
+namespace mesh_optimizer
+{
+	//! \brief Number of vertices kept by the modelled post-transform cache.
+	std::size_t const default_cache_size = 16u;
+
+	//! \brief Average Cache Miss Ratio of a triangle list before and after
+	//!        `optimize()`.
+	struct Stats {
+		float acmr_before{ 0.0f };
+		float acmr_after{ 0.0f };
+	};
+
+	//! \brief Compute the Average Cache Miss Ratio of a triangle list.
+	//!
+	//! @param [in] indices three per triangle
+	//! @param [in] indices_nb number of indices in `indices`
+	//! @param [in] vertices_nb number of vertices referred to by `indices`
+	//! @param [in] cache_size number of vertices kept by the cache
+	//! @return transformed vertices per triangle, 0 if there are none
+	float computeACMR(GLuint const* indices, std::size_t indices_nb, std::size_t vertices_nb,
+	                  std::size_t cache_size = default_cache_size);
+
+	//! \brief Reorder triangles for the post-transform vertex cache, using
+	//!        Tipsify.
+	//!
+	//! @param [inout] indices three per triangle, reordered in place
+	//! @param [in] indices_nb number of indices in `indices`
+	//! @param [in] vertices_nb number of vertices referred to by `indices`
+	//! @param [in] cache_size number of vertices kept by the cache
+	//! @return index of the first triangle of each cluster, starting with 0;
+	//!         clusters start where the next vertex to fan around was no
+	//!         longer in the cache
+	std::vector<std::size_t> optimizeVertexCache(GLuint* indices, std::size_t indices_nb, std::size_t vertices_nb,
+	                                             std::size_t cache_size = default_cache_size);
+
+	//! \brief Reorder clusters of triangles to reduce overdraw.
+	//!
+	//! Clusters are first split further as soon as their own ACMR is
+	//! within `threshold` of the one of the whole list, then sorted by
+	//! how much they face away from the centre of the mesh.
+	//!
+	//! @param [inout] indices three per triangle, reordered in place
+	//! @param [in] indices_nb number of indices in `indices`
+	//! @param [in] vertices positions referred to by `indices`
+	//! @param [in] vertices_nb number of positions in `vertices`
+	//! @param [in] clusters as returned by `optimizeVertexCache()`
+	//! @param [in] threshold how much higher than the current one the
+	//!             ACMR is allowed to get, e.g. 1.05 for 5%
+	//! @param [in] cache_size number of vertices kept by the cache
+	void optimizeOverdraw(GLuint* indices, std::size_t indices_nb, glm::vec3 const* vertices, std::size_t vertices_nb,
+	                      std::vector<std::size_t> const& clusters, float threshold = 1.05f,
+	                      std::size_t cache_size = default_cache_size);
+
+	//! \brief Renumber vertices in the order the triangles first use them.
+	//!
+	//! Unused vertices are moved after all used ones, so that the number
+	//! of vertices does not change.
+	//!
+	//! @param [inout] indices rewritten with the new numbers
+	//! @param [in] indices_nb number of indices in `indices`
+	//! @param [in] vertices_nb number of vertices referred to by `indices`
+	//! @return the new number of each vertex, to pass to `remapVertices()`
+	std::vector<GLuint> optimizeVertexFetch(GLuint* indices, std::size_t indices_nb, std::size_t vertices_nb);
+
+	//! \brief Reorder per-vertex values after `optimizeVertexFetch()`.
+	//!
+	//! @param [in] values one per vertex, in the previous order
+	//! @param [in] remap new number of each vertex
+	//! @return the values in the new order
+	template<typename T>
+	std::vector<T> remapVertices(T const* values, std::vector<GLuint> const& remap)
+	{
+		std::vector<T> remapped(remap.size());
+		for (std::size_t i = 0u; i < remap.size(); ++i)
+			remapped[remap[i]] = values[i];
+		return remapped;
+	}
+
+	//! \brief Run all passes on a triangle list.
+	//!
+	//! @param [inout] indices three per triangle, reordered and renumbered
+	//!                in place
+	//! @param [in] indices_nb number of indices in `indices`
+	//! @param [in] vertices positions referred to by `indices`
+	//! @param [in] vertices_nb number of positions in `vertices`
+	//! @param [out] remap new number of each vertex, see `remapVertices()`
+	//! @return the ACMR before and after; if the passes would make it
+	//!         worse, the triangles keep their original order
+	Stats optimize(GLuint* indices, std::size_t indices_nb, glm::vec3 const* vertices, std::size_t vertices_nb,
+	               std::vector<GLuint>& remap);
+}
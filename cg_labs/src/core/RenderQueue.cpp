@@ -0,0 +1,168 @@
+#include "RenderQueue.hpp"
+
+#include "GLStateCache.hpp"
+#include "helpers.hpp"
+#include "node.hpp"
+#include "opengl.hpp"
+#include "UniformRing.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+void
+RenderQueue::submit(Node const& node, glm::mat4 const& view_projection, glm::mat4 const& world,
+                    GLuint program, std::function<void (GLuint)> const& set_uniforms,
+                    unsigned int pass)
+{
+	_owned_set_uniforms.emplace_back(set_uniforms);
+	submit(node, view_projection, world, program, &_owned_set_uniforms.back(), pass);
+}
+
+void
+RenderQueue::submit(Node const& node, glm::mat4 const& view_projection, glm::mat4 const& world,
+                    GLuint program, std::function<void (GLuint)> const* set_uniforms,
+                    unsigned int pass)
+{
+	if (node._vao == 0u || program == 0u)
+		return;
+
+	std::uint32_t textures_hash = 0u;
+	for (auto const& texture : node._textures)
+		textures_hash = (textures_hash ^ std::get<1>(texture)) * 16777619u; // FNV-1a prime
+	auto const textures_key = static_cast<std::uint16_t>(textures_hash ^ (textures_hash >> 16));
+
+	auto const depth = (view_projection * world[3]).w;
+
+	_order.emplace_back(make_key(pass, program, textures_key, node._vao, depth),
+	                    static_cast<std::uint32_t>(_packets.size()));
+	_packets.push_back({ &node, program, set_uniforms, view_projection, world });
+}
+
+void
+RenderQueue::execute()
+{
+	_stats = Stats();
+	if (_packets.empty())
+		return;
+
+	utils::opengl::debug::beginDebugGroup("Execute render queue");
+
+	std::sort(_order.begin(), _order.end());
+
+	auto& ring = bonobo::getUniformRing();
+	std::vector<Node::UniformRanges> ranges(_order.size());
+
+	GLuint program = 0u;
+	std::function<void (GLuint)> const* set_uniforms = nullptr;
+	Node const* textures_node = nullptr; // node whose textures are bound
+	std::size_t batch_begin = 0u;
+	while (batch_begin < _order.size()) {
+		// The blocks of as many packets as fit in the current segment of
+		// the uniform ring are written first, then uploaded at once.
+		auto batch_end = batch_begin;
+		for (; batch_end < _order.size(); ++batch_end) {
+			auto const& packet = _packets[_order[batch_end].second];
+			auto const& locations = packet.node->get_uniform_locations(packet.program);
+			if (batch_end > batch_begin && !ring.fits(packet.node->get_uniform_ring_size(locations)))
+				break;
+			ranges[batch_end] = packet.node->write_object_uniforms(locations, packet.view_projection, packet.world);
+		}
+		ring.flush();
+
+		for (auto i = batch_begin; i < batch_end; ++i) {
+			auto const& packet = _packets[_order[i].second];
+			auto const& node = *packet.node;
+
+			if (packet.program != program) {
+				reset_texture_flags();
+				if (utils::opengl::state::useProgram(packet.program))
+					++_stats.program_changes;
+				program = packet.program;
+				set_uniforms = nullptr;
+				textures_node = nullptr;
+			}
+			if (packet.set_uniforms != set_uniforms) {
+				if (*packet.set_uniforms)
+					(*packet.set_uniforms)(program);
+				set_uniforms = packet.set_uniforms;
+			}
+
+			auto const& locations = node.get_uniform_locations(program);
+
+			if (textures_node == nullptr
+			    || (textures_node != &node && textures_node->_textures != node._textures)) {
+				reset_texture_flags();
+				for (size_t t = 0u; t < node._textures.size(); ++t) {
+					utils::opengl::state::activeTexture(GL_TEXTURE0 + static_cast<GLenum>(t));
+					if (utils::opengl::state::bindTexture(std::get<2>(node._textures[t]), std::get<1>(node._textures[t])))
+						++_stats.texture_changes;
+					glUniform1i(locations.textures[t].first, static_cast<GLint>(t));
+					glUniform1i(locations.textures[t].second, 1);
+					_enabled_texture_flags.push_back(locations.textures[t].second);
+				}
+				textures_node = &node;
+			}
+
+			node.set_object_uniforms(locations, ranges[i], packet.view_projection, packet.world);
+
+			if (utils::opengl::state::bindVertexArray(node._vao))
+				++_stats.vertex_array_changes;
+			node.draw_geometry();
+			++_stats.draws;
+		}
+		batch_begin = batch_end;
+	}
+
+	reset_texture_flags();
+
+	utils::opengl::debug::endDebugGroup();
+
+	clear();
+}
+
+void
+RenderQueue::clear()
+{
+	_packets.clear();
+	_order.clear();
+	_owned_set_uniforms.clear();
+}
+
+std::size_t
+RenderQueue::size() const
+{
+	return _packets.size();
+}
+
+RenderQueue::Stats const&
+RenderQueue::get_stats() const
+{
+	return _stats;
+}
+
+std::uint64_t
+RenderQueue::make_key(unsigned int pass, GLuint program, std::uint16_t textures, GLuint vao, float depth)
+{
+	assert(pass < 16u);
+
+	// The bits of a positive float sort like the float itself, so the
+	// upper half keeps the order with a relative precision of 2^-7.
+	std::uint32_t depth_bits = 0u;
+	depth = std::max(depth, 0.0f);
+	std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+	return (static_cast<std::uint64_t>(pass & 0xfu) << 60)
+	     | (static_cast<std::uint64_t>(program & 0xfffu) << 48)
+	     | (static_cast<std::uint64_t>(textures) << 32)
+	     | (static_cast<std::uint64_t>(vao & 0xffffu) << 16)
+	     | static_cast<std::uint64_t>(depth_bits >> 16);
+}
+
+void
+RenderQueue::reset_texture_flags()
+{
+	for (auto const location : _enabled_texture_flags)
+		glUniform1i(location, 0);
+	_enabled_texture_flags.clear();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class Node;
+
+//! \brief Collects the draws of a frame, then executes them sorted by
+//!        state so that consecutive draws only change what differs.
+//!
+//! Every submitted draw becomes a packet with a 64-bit sort key made of,
+//! from the most significant bits:
+//!
+//!     | pass (4) | program (12) | textures (16) | vertex array (16) | depth (16) |
+//!
+//! Sorting on that key groups the draws of a pass by program, then by set
+//! of textures and vertex array, and orders draws sharing all of those
+//! front to back. The program, textures and vertex array fields are only
+//! hashes of the real state: a collision costs a state change, never a
+//! wrong draw, as `execute()` compares the actual objects before binding.
+//!
+//! Bindings go through `utils::opengl::state`, so the state left by the
+//! previous packet, or by whatever ran before `execute()`, is never bound
+//! again; the counters only include the calls that reached OpenGL.
+//!
+//! The uniform blocks of the packets are written to the uniform ring
+//! ahead of their draws, a segment's worth at a time, so that the ring
+//! uploads them with a single call when it cannot map its buffer.
+class RenderQueue
+{
+public:
+	//! \brief Counters of the last call to `execute()`.
+	struct Stats {
+		std::size_t draws{ 0u };
+		std::size_t program_changes{ 0u };
+		std::size_t texture_changes{ 0u };
+		std::size_t vertex_array_changes{ 0u };
+
+		std::size_t state_changes() const { return program_changes + texture_changes + vertex_array_changes; }
+	};
+
+	//! \brief Add a draw of a node to the queue.
+	//!
+	//! See `Node::submit()` to draw a node with its own program.
+	//!
+	//! @param [in] node node whose geometry, textures and material
+	//!             constants are drawn; it has to outlive `execute()`
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] world Matrix transforming from model-space to world-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms; it is called whenever the program or the
+	//!             function differ from the previous packet, and should
+	//!             not change texture bindings
+	//! @param [in] pass index of the pass, in [0, 15]; passes are drawn
+	//!             in increasing order
+	void submit(Node const& node, glm::mat4 const& view_projection, glm::mat4 const& world,
+	            GLuint program, std::function<void (GLuint)> const& set_uniforms,
+	            unsigned int pass = 0u);
+
+	//! \brief Sort and draw all packets, then empty the queue.
+	void execute();
+
+	//! \brief Drop all packets without drawing them.
+	void clear();
+
+	//! \brief Return the number of packets waiting to be drawn.
+	std::size_t size() const;
+
+	//! \brief Return the counters of the last call to `execute()`.
+	Stats const& get_stats() const;
+
+	//! \brief Build a sort key; the depth is the clip-space w, i.e. the
+	//!        distance along the view direction.
+	static std::uint64_t make_key(unsigned int pass, GLuint program, std::uint16_t textures,
+	                              GLuint vao, float depth);
+
+private:
+	friend class Node;
+
+	struct Packet {
+		Node const* node;
+		GLuint program;
+		std::function<void (GLuint)> const* set_uniforms;
+		glm::mat4 view_projection;
+		glm::mat4 world;
+	};
+
+	void submit(Node const& node, glm::mat4 const& view_projection, glm::mat4 const& world,
+	            GLuint program, std::function<void (GLuint)> const* set_uniforms,
+	            unsigned int pass);
+	void reset_texture_flags();
+
+	std::vector<Packet> _packets;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> _order;   // sort key and packet index
+	std::deque<std::function<void (GLuint)>> _owned_set_uniforms;  // copies of functions not owned by a node
+	std::vector<GLint> _enabled_texture_flags;                      // "has_" uniforms set to 1 in the current program
+	Stats _stats;
+};
@@ -0,0 +1,448 @@
+#include "ScenePack.hpp"
+
+#include "core/Log.h"
+#include "core/various.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	char const pack_magic[4] = { 'B', 'P', 'A', 'K' };
+
+	enum AttributeFlags : std::uint32_t {
+		has_normals   = 1u << 0,
+		has_texcoords = 1u << 1,
+		has_tangents  = 1u << 2  // and binormals
+	};
+
+	// Size and modification time of a file; both are zero if it is missing,
+	// so that a file appearing later also makes the pack stale.
+	struct FileStamp {
+		std::uint64_t size{ 0u };
+		std::int64_t modification_time{ 0 };
+	};
+
+	FileStamp stampFile(std::string const& path)
+	{
+		FileStamp stamp;
+#if defined(_WIN32)
+		struct _stat64 status;
+		if (_wstat64(utils::widen(path).c_str(), &status) != 0)
+			return stamp;
+#else
+		struct stat status;
+		if (stat(path.c_str(), &status) != 0)
+			return stamp;
+#endif
+		stamp.size = static_cast<std::uint64_t>(status.st_size);
+		stamp.modification_time = static_cast<std::int64_t>(status.st_mtime);
+		return stamp;
+	}
+
+	std::string getFolder(std::string const& filename)
+	{
+		auto const end_of_basedir = filename.rfind("/");
+		return end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir + 1u) : "";
+	}
+
+	// Limits on the textures read back, well above what OpenGL accepts, so
+	// that sizes computed from them cannot overflow.
+	std::uint32_t const max_texture_size = 1u << 16;
+	std::uint32_t const max_levels_nb = 17u;
+
+	std::uint64_t getTexelsSize(std::uint32_t width, std::uint32_t height, std::uint32_t levels_nb)
+	{
+		std::uint64_t size = 0u;
+		for (std::uint32_t level = 0u; level < levels_nb; ++level) {
+			size += static_cast<std::uint64_t>(width) * static_cast<std::uint64_t>(height) * 4u;
+			width = width > 1u ? width / 2u : 1u;
+			height = height > 1u ? height / 2u : 1u;
+		}
+		return size;
+	}
+
+	// Reads a mapped pack front to back; once a read goes past the end,
+	// all following reads fail too.
+	class Cursor
+	{
+	public:
+		Cursor(unsigned char const* data, std::size_t size) : _data(data), _size(size) {}
+
+		bool failed() const { return _failed; }
+		void fail() { _failed = true; }
+		std::size_t remaining() const { return _failed ? 0u : _size - _offset; }
+
+		void const* read_array(std::uint64_t size)
+		{
+			if (_failed || size > _size - _offset) {
+				_failed = true;
+				return nullptr;
+			}
+			auto const array = _data + _offset;
+			_offset += static_cast<std::size_t>(size);
+			return array;
+		}
+
+		// Reads a number of items taking at least `item_size` bytes each,
+		// failing if that many would not fit in what is left.
+		std::uint32_t read_count(std::size_t item_size)
+		{
+			auto const count = read_value<std::uint32_t>();
+			if (count > remaining() / item_size) {
+				_failed = true;
+				return 0u;
+			}
+			return count;
+		}
+
+		template<typename T>
+		T read_value()
+		{
+			T value{};
+			if (auto const bytes = read_array(sizeof(T)))
+				std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		std::string read_string()
+		{
+			auto const length = read_value<std::uint32_t>();
+			auto const characters = static_cast<char const*>(read_array(length));
+			read_array((4u - length % 4u) % 4u);
+			return characters != nullptr ? std::string(characters, length) : std::string();
+		}
+
+	private:
+		unsigned char const* _data;
+		std::size_t _size;
+		std::size_t _offset{ 0u };
+		bool _failed{ false };
+	};
+}
+
+std::string
+ScenePack::get_filename(std::string const& source_filename)
+{
+	return source_filename + ".pack";
+}
+
+bool
+ScenePack::write(std::string const& filename,
+                 std::vector<std::string> const& dependencies,
+                 std::vector<Material> const& materials,
+                 std::vector<Mesh> const& meshes)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		LogError("Failed to open \"%s\" for writing", filename.c_str());
+		return false;
+	}
+
+	auto const write_array = [&file](void const* data, std::size_t size){
+		file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+	};
+	auto const write_u32 = [&write_array](std::size_t value){
+		auto const value_u32 = static_cast<std::uint32_t>(value);
+		write_array(&value_u32, sizeof(value_u32));
+	};
+	auto const write_string = [&write_array, &write_u32](std::string const& string){
+		char const padding[4] = {};
+		write_u32(string.size());
+		write_array(string.data(), string.size());
+		write_array(padding, (4u - string.size() % 4u) % 4u);
+	};
+	auto const write_vec3 = [&write_array](glm::vec3 const& value){
+		write_array(&value.x, sizeof(float));
+		write_array(&value.y, sizeof(float));
+		write_array(&value.z, sizeof(float));
+	};
+
+	write_array(pack_magic, sizeof(pack_magic));
+	write_u32(version);
+
+	auto const folder = getFolder(filename);
+	write_u32(dependencies.size());
+	for (auto const& dependency : dependencies) {
+		auto const stamp = stampFile(folder + dependency);
+		write_string(dependency);
+		write_array(&stamp.size, sizeof(stamp.size));
+		write_array(&stamp.modification_time, sizeof(stamp.modification_time));
+	}
+
+	write_u32(materials.size());
+	for (auto const& material : materials) {
+		auto const& constants = material.constants;
+		write_string(material.name);
+		write_vec3(constants.diffuse);
+		write_vec3(constants.specular);
+		write_vec3(constants.ambient);
+		write_vec3(constants.emissive);
+		write_array(&constants.shininess, sizeof(float));
+		write_array(&constants.indexOfRefraction, sizeof(float));
+		write_array(&constants.opacity, sizeof(float));
+
+		write_u32(material.textures.size());
+		for (auto const& texture : material.textures) {
+			write_string(texture.type_as_str);
+			write_string(texture.binding);
+			write_string(texture.path);
+			write_u32(texture.width);
+			write_u32(texture.height);
+			write_u32(texture.levels_nb);
+			write_array(texture.texels, static_cast<std::size_t>(getTexelsSize(texture.width, texture.height, texture.levels_nb)));
+		}
+	}
+
+	write_u32(meshes.size());
+	for (auto const& mesh : meshes) {
+		std::uint32_t attributes = 0u;
+		if (mesh.normals != nullptr)
+			attributes |= has_normals;
+		if (mesh.texcoords != nullptr)
+			attributes |= has_texcoords;
+		if (mesh.tangents != nullptr && mesh.binormals != nullptr)
+			attributes |= has_tangents;
+
+		write_string(mesh.name);
+		write_u32(mesh.material_id);
+		write_u32(mesh.vertices_per_face);
+		write_u32(mesh.vertices_nb);
+		write_u32(attributes);
+		write_vec3(mesh.bounds.min);
+		write_vec3(mesh.bounds.max);
+		write_vec3(mesh.bounds.centre);
+		write_array(&mesh.bounds.radius, sizeof(float));
+
+		auto const attribute_size = static_cast<std::size_t>(mesh.vertices_nb) * sizeof(glm::vec3);
+		write_array(mesh.vertices, attribute_size);
+		if (attributes & has_normals)
+			write_array(mesh.normals, attribute_size);
+		if (attributes & has_texcoords)
+			write_array(mesh.texcoords, attribute_size);
+		if (attributes & has_tangents) {
+			write_array(mesh.tangents, attribute_size);
+			write_array(mesh.binormals, attribute_size);
+		}
+		write_u32(mesh.indices_nb);
+		write_array(mesh.indices, static_cast<std::size_t>(mesh.indices_nb) * sizeof(std::uint32_t));
+	}
+
+	if (!file) {
+		LogError("Failed to write the pack \"%s\"", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+ScenePack::~ScenePack()
+{
+	close();
+}
+
+bool
+ScenePack::open(std::string const& filename, std::string& error)
+{
+	close();
+	error.clear();
+
+#if defined(_WIN32)
+	_file = ::CreateFileW(utils::widen(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE) {
+		_file = nullptr;
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (::GetFileSizeEx(_file, &file_size) == 0 || file_size.QuadPart == 0) {
+		error = "the pack is empty";
+		close();
+		return false;
+	}
+	_file_mapping = ::CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_file_mapping != nullptr)
+		_data = static_cast<unsigned char const*>(::MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_data == nullptr) {
+		error = "mapping it failed with error code " + std::to_string(::GetLastError());
+		close();
+		return false;
+	}
+	_size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+	int const file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		error = "the pack is empty";
+		::close(file);
+		return false;
+	}
+	auto const mapping = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file); // the mapping keeps the file alive
+	if (mapping == MAP_FAILED) {
+		error = std::string("mapping it failed: ") + std::strerror(errno);
+		return false;
+	}
+	_data = static_cast<unsigned char const*>(mapping);
+	_size = static_cast<std::size_t>(status.st_size);
+#endif
+
+	Cursor cursor(_data, _size);
+	auto const magic = cursor.read_array(sizeof(pack_magic));
+	if (magic == nullptr || std::memcmp(magic, pack_magic, sizeof(pack_magic)) != 0) {
+		error = "it is not a pack";
+		close();
+		return false;
+	}
+	auto const pack_version = cursor.read_value<std::uint32_t>();
+	if (pack_version != version) {
+		error = "it was cooked with version " + std::to_string(pack_version) + " instead of " + std::to_string(version);
+		close();
+		return false;
+	}
+
+	auto const folder = getFolder(filename);
+	auto const dependencies_nb = cursor.read_value<std::uint32_t>();
+	for (std::uint32_t i = 0u; i < dependencies_nb && !cursor.failed(); ++i) {
+		auto const path = cursor.read_string();
+		FileStamp cooked;
+		cooked.size = cursor.read_value<std::uint64_t>();
+		cooked.modification_time = cursor.read_value<std::int64_t>();
+		auto const current = stampFile(folder + path);
+		if (!cursor.failed() && (current.size != cooked.size || current.modification_time != cooked.modification_time)) {
+			error = "\"" + path + "\" changed since it was cooked";
+			close();
+			return false;
+		}
+	}
+
+	// Smallest size of each item in the file, with empty strings, no
+	// vertices and a single texel, used to reject counts that cannot be
+	// right before allocating anything for them.
+	std::size_t const min_material_size = 4u + 4u * sizeof(glm::vec3) + 3u * sizeof(float) + 4u;
+	std::size_t const min_texture_size = 3u * 4u + 3u * 4u + 4u;
+	std::size_t const min_mesh_size = 4u + 4u * 4u + 3u * sizeof(glm::vec3) + sizeof(float) + 4u;
+
+	auto const read_vec3 = [&cursor](){
+		glm::vec3 value;
+		value.x = cursor.read_value<float>();
+		value.y = cursor.read_value<float>();
+		value.z = cursor.read_value<float>();
+		return value;
+	};
+
+	_materials.resize(cursor.read_count(min_material_size));
+	for (auto& material : _materials) {
+		if (cursor.failed())
+			break;
+		auto& constants = material.constants;
+		material.name = cursor.read_string();
+		constants.diffuse = read_vec3();
+		constants.specular = read_vec3();
+		constants.ambient = read_vec3();
+		constants.emissive = read_vec3();
+		constants.shininess = cursor.read_value<float>();
+		constants.indexOfRefraction = cursor.read_value<float>();
+		constants.opacity = cursor.read_value<float>();
+
+		material.textures.resize(cursor.read_count(min_texture_size));
+		for (auto& texture : material.textures) {
+			texture.type_as_str = cursor.read_string();
+			texture.binding = cursor.read_string();
+			texture.path = cursor.read_string();
+			texture.width = cursor.read_value<std::uint32_t>();
+			texture.height = cursor.read_value<std::uint32_t>();
+			texture.levels_nb = cursor.read_value<std::uint32_t>();
+			if (cursor.failed() || texture.width == 0u || texture.width > max_texture_size
+			 || texture.height == 0u || texture.height > max_texture_size
+			 || texture.levels_nb == 0u || texture.levels_nb > max_levels_nb) {
+				cursor.fail();
+				break;
+			}
+			texture.texels = static_cast<unsigned char const*>(cursor.read_array(getTexelsSize(texture.width, texture.height, texture.levels_nb)));
+		}
+	}
+
+	_meshes.resize(cursor.read_count(min_mesh_size));
+	for (auto& mesh : _meshes) {
+		if (cursor.failed())
+			break;
+		mesh.name = cursor.read_string();
+		mesh.material_id = cursor.read_value<std::uint32_t>();
+		mesh.vertices_per_face = cursor.read_value<std::uint32_t>();
+		mesh.vertices_nb = cursor.read_value<std::uint32_t>();
+		auto const attributes = cursor.read_value<std::uint32_t>();
+		mesh.bounds.min = read_vec3();
+		mesh.bounds.max = read_vec3();
+		mesh.bounds.centre = read_vec3();
+		mesh.bounds.radius = cursor.read_value<float>();
+
+		if (mesh.vertices_per_face == 0u || mesh.vertices_per_face > 3u) {
+			cursor.fail();
+			break;
+		}
+
+		auto const attribute_size = static_cast<std::uint64_t>(mesh.vertices_nb) * sizeof(glm::vec3);
+		auto const read_attribute = [&cursor, attribute_size](bool is_present){
+			return is_present ? static_cast<glm::vec3 const*>(cursor.read_array(attribute_size)) : nullptr;
+		};
+		mesh.vertices = read_attribute(true);
+		mesh.normals = read_attribute(attributes & has_normals);
+		mesh.texcoords = read_attribute(attributes & has_texcoords);
+		mesh.tangents = read_attribute(attributes & has_tangents);
+		mesh.binormals = read_attribute(attributes & has_tangents);
+		mesh.indices_nb = cursor.read_value<std::uint32_t>();
+		mesh.indices = static_cast<std::uint32_t const*>(cursor.read_array(static_cast<std::uint64_t>(mesh.indices_nb) * sizeof(std::uint32_t)));
+	}
+
+	if (cursor.failed()) {
+		error = "it is truncated or corrupted";
+		close();
+		return false;
+	}
+
+	// Indices end up in index buffers as they are, where one past the
+	// vertices would have the GPU fetch out of bounds.
+	for (auto const& mesh : _meshes) {
+		auto const vertices_nb = mesh.vertices_nb;
+		if (std::any_of(mesh.indices, mesh.indices + mesh.indices_nb, [vertices_nb](std::uint32_t index){ return index >= vertices_nb; })) {
+			error = "mesh \"" + mesh.name + "\" has indices past its " + std::to_string(vertices_nb) + " vertices";
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+ScenePack::close()
+{
+	_materials.clear();
+	_meshes.clear();
+#if defined(_WIN32)
+	if (_data != nullptr)
+		::UnmapViewOfFile(_data);
+	if (_file_mapping != nullptr)
+		::CloseHandle(_file_mapping);
+	if (_file != nullptr)
+		::CloseHandle(_file);
+	_file_mapping = nullptr;
+	_file = nullptr;
+#else
+	if (_data != nullptr)
+		munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+	_data = nullptr;
+	_size = 0u;
+}
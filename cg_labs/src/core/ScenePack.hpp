@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core/helpers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Binary file holding an object/scene file cooked for
+//!        `bonobo::loadObjects()`, memory-mapped when read.
+//!
+//! A pack stores what uploading the scene needs and nothing else: the
+//! vertex attributes and indices of every supported mesh, their bounds,
+//! the material constants, and the complete mipmap hierarchy of every
+//! texture as RGBA8 texels. All arrays are 4-byte aligned in the file, so
+//! the meshes and textures returned by `open()` point straight into the
+//! mapping and can be handed to OpenGL as they are.
+//!
+//! The pack also records the size and modification time of the files it
+//! was cooked from, the object/scene file and its images; it is stale as
+//! soon as one of them differs. Packs are written in the byte order of the
+//! machine cooking them, and carry a version that is bumped whenever the
+//! layout changes.
+class ScenePack
+{
+public:
+	//! \brief Texture of a material, with all its mipmap levels.
+	struct Texture {
+		std::string type_as_str;                 //!< e.g. "diffuse"
+		std::string binding;                     //!< name of the sampler, e.g. "diffuse_texture"
+		std::string path;                        //!< of the source image, for logging
+		std::uint32_t width{ 0u };               //!< of the first level
+		std::uint32_t height{ 0u };              //!< of the first level
+		std::uint32_t levels_nb{ 0u };           //!< down to a 1×1 level
+		unsigned char const* texels{ nullptr };  //!< RGBA8 levels, largest first, without padding
+	};
+
+	//! \brief Constants and textures of a material.
+	struct Material {
+		std::string name;
+		bonobo::material_data constants;
+		std::vector<Texture> textures;
+	};
+
+	//! \brief Geometry of a mesh; absent attributes are null.
+	struct Mesh {
+		std::string name;
+		std::uint32_t material_id{ 0u };
+		std::uint32_t vertices_per_face{ 3u };   //!< 1 for points, 2 for lines, 3 for triangles
+		std::uint32_t vertices_nb{ 0u };
+		glm::vec3 const* vertices{ nullptr };
+		glm::vec3 const* normals{ nullptr };
+		glm::vec3 const* texcoords{ nullptr };
+		glm::vec3 const* tangents{ nullptr };    //!< set if and only if binormals are
+		glm::vec3 const* binormals{ nullptr };
+		std::uint32_t indices_nb{ 0u };
+		std::uint32_t const* indices{ nullptr };
+		bonobo::mesh_bounds bounds;
+	};
+
+	//! \brief Version of the layout written by `write()`; 2 holds meshes
+	//!        reordered by `mesh_optimizer`.
+	static std::uint32_t const version = 2u;
+
+	//! \brief Return where the pack of an object/scene file is stored,
+	//!        next to it.
+	static std::string get_filename(std::string const& source_filename);
+
+	//! \brief Write a pack.
+	//!
+	//! @param [in] filename where to write the pack
+	//! @param [in] dependencies paths, relative to the folder of the pack,
+	//!             of the files the pack is cooked from; they are stamped
+	//!             with their current size and modification time
+	//! @param [in] materials every material of the scene, in order
+	//! @param [in] meshes the meshes `loadObjects()` should return
+	//! @return whether the whole pack was written
+	static bool write(std::string const& filename,
+	                  std::vector<std::string> const& dependencies,
+	                  std::vector<Material> const& materials,
+	                  std::vector<Mesh> const& meshes);
+
+	ScenePack() = default;
+	~ScenePack();
+	ScenePack(ScenePack const&) = delete;
+	ScenePack& operator=(ScenePack const&) = delete;
+
+	//! \brief Map a pack, and check that it is up to date.
+	//!
+	//! It does not log, so it can run in a job.
+	//!
+	//! @param [in] filename of the pack
+	//! @param [out] error why the pack cannot be used; left empty if
+	//!              there is no pack at all
+	//! @return whether the pack can be used
+	bool open(std::string const& filename, std::string& error);
+
+	//! \brief Materials of the scene, indexed by `Mesh::material_id`.
+	std::vector<Material> const& materials() const { return _materials; }
+
+	//! \brief Meshes of the scene, pointing into the mapping.
+	std::vector<Mesh> const& meshes() const { return _meshes; }
+
+	//! \brief Size in bytes of the mapped file.
+	std::size_t size() const { return _size; }
+
+private:
+	void close();
+
+	unsigned char const* _data{ nullptr };
+	std::size_t _size{ 0u };
+#if defined(_WIN32)
+	void* _file{ nullptr };
+	void* _file_mapping{ nullptr };
+#endif
+	std::vector<Material> _materials;
+	std::vector<Mesh> _meshes;
+};
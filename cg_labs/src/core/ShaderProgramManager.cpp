@@ -10,10 +10,20 @@
 
 #include <type_traits>
 
+std::unordered_map<GLuint, ProgramUniforms> ShaderProgramManager::uniforms_by_program;
+
+GLint
+ProgramUniforms::location(std::string const& name) const
+{
+	auto const it = locations.find(name);
+	return it != locations.end() ? it->second : -1;
+}
+
 ShaderProgramManager::~ShaderProgramManager()
 {
 	for (auto const& i : program_entries) {
 		if (i.first != 0u) {
+			uniforms_by_program.erase(i.first);
 			glDeleteProgram(i.first);
 			i.first = 0u;
 		}
@@ -55,8 +65,10 @@ bool ShaderProgramManager::ReloadAllPrograms()
 	bool encountered_failures = false;
 	for (std::size_t i = 0; i < program_entries.size(); ++i) {
 		auto& program = program_entries[i].first;
-		if (program != 0u)
+		if (program != 0u) {
+			uniforms_by_program.erase(program);
 			glDeleteProgram(program);
+		}
 		program = 0u;
 		ProcessProgram(i);
 		encountered_failures |= program == 0u;
@@ -79,6 +91,62 @@ ShaderProgramManager::SelectedProgram ShaderProgramManager::SelectProgram(std::s
 	return selection_result;
 }
 
+void ShaderProgramManager::RegisterProgram(GLuint const program)
+{
+	if (program != 0u)
+		ReflectUniforms(program);
+}
+
+void ShaderProgramManager::UnregisterProgram(GLuint const program)
+{
+	uniforms_by_program.erase(program);
+}
+
+ProgramUniforms const* ShaderProgramManager::GetUniforms(GLuint const program)
+{
+	auto const it = uniforms_by_program.find(program);
+	return it != uniforms_by_program.end() ? &it->second : nullptr;
+}
+
+GLint ShaderProgramManager::GetUniformLocation(GLuint const program, std::string const& name)
+{
+	auto const uniforms = GetUniforms(program);
+	auto const location = uniforms != nullptr ? uniforms->location(name) : -1;
+	return location >= 0 ? location : glGetUniformLocation(program, name.c_str());
+}
+
+void ShaderProgramManager::ReflectUniforms(GLuint const program)
+{
+	static std::uint64_t generation = 0u;
+
+	ProgramUniforms uniforms;
+	uniforms.generation = ++generation;
+
+	GLint uniforms_nb = 0, max_name_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniforms_nb);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+	std::vector<GLchar> name(static_cast<std::size_t>(max_name_length) + 1u);
+	for (GLint i = 0; i < uniforms_nb; ++i) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+		std::string const uniform_name(name.data(), static_cast<std::size_t>(length));
+
+		// Members of uniform blocks have no location.
+		GLint const location = glGetUniformLocation(program, uniform_name.c_str());
+		if (location < 0)
+			continue;
+
+		uniforms.locations.emplace(uniform_name, location);
+		auto const array_suffix = uniform_name.rfind("[0]");
+		if (array_suffix != std::string::npos && array_suffix + 3u == uniform_name.size())
+			uniforms.locations.emplace(uniform_name.substr(0u, array_suffix), location);
+	}
+
+	uniforms_by_program[program] = std::move(uniforms);
+}
+
 void ShaderProgramManager::ProcessProgram(std::size_t const program_index)
 {
 	auto& program_entry = program_entries[program_index];
@@ -108,6 +176,8 @@ void ShaderProgramManager::ProcessProgram(std::size_t const program_index)
 
 	program = utils::opengl::shader::generate_program(shaders);
 	utils::opengl::debug::nameObject(GL_PROGRAM, program, program_names[program_index]);
+	if (program != 0u)
+		ReflectUniforms(program);
 
 	for (auto& shader : shaders)
 		glDeleteShader(shader);
@@ -5,6 +5,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -19,6 +20,17 @@ enum class ShaderType : std::uint32_t {
 	compute = GL_COMPUTE_SHADER
 };
 
+//! \brief Locations of the active uniforms of a linked program, queried
+//!        once when the program is linked.
+struct ProgramUniforms {
+	std::uint64_t generation{0u};                      //!< unique per link, so that caches notice reloads
+	std::unordered_map<std::string, GLint> locations;  //!< by name; arrays are also listed without "[0]"
+
+	//! \brief Return the location of a uniform, or -1 if it is not in
+	//!        the table; see `ShaderProgramManager::GetUniformLocation()`.
+	GLint location(std::string const& name) const;
+};
+
 class ShaderProgramManager
 {
 public:
@@ -34,8 +46,30 @@ public:
 	bool ReloadAllPrograms();
 	SelectedProgram SelectProgram(std::string const& label, std::int32_t& program_index);
 
+	//! \brief Reflect the uniforms of a program linked outside of any
+	//!        manager, e.g. by `bonobo::createProgram()`, so that they are
+	//!        resolved once per link like those of managed programs.
+	//!
+	//! Call `UnregisterProgram()` before deleting it, and register it
+	//! again after relinking it.
+	static void RegisterProgram(GLuint program);
+	//! \brief Forget the uniforms of a program given to
+	//!        `RegisterProgram()`.
+	static void UnregisterProgram(GLuint program);
+
+	//! \brief Return the uniforms of a program created by any manager or
+	//!        registered, or nullptr if that program is unknown.
+	static ProgramUniforms const* GetUniforms(GLuint program);
+	//! \brief Return the location of a uniform from the table of its
+	//!        program, falling back to glGetUniformLocation() for unknown
+	//!        programs and for names not in the table, such as array
+	//!        elements past the first.
+	static GLint GetUniformLocation(GLuint program, std::string const& name);
+
 private:
 	void ProcessProgram(std::size_t program_index);
+	static void ReflectUniforms(GLuint program);
+	static std::unordered_map<GLuint, ProgramUniforms> uniforms_by_program;
 	using ProgramEntry = std::pair<GLuint&, ProgramData>;
 	std::vector<ProgramEntry> program_entries;
 	std::vector<char const*> program_names;
@@ -0,0 +1,142 @@
+#include "UniformRing.hpp"
+
+#include "Log.h"
+#include "opengl.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+
+namespace
+{
+	// glad only loads glBufferStorage() on OpenGL 4.4 contexts; the 4.1
+	// ones the labs create may still expose it as an extension.
+	PFNGLBUFFERSTORAGEPROC getBufferStorage()
+	{
+		if (GLAD_GL_VERSION_4_4)
+			return glBufferStorage;
+		if (glfwExtensionSupported("GL_ARB_buffer_storage") == GLFW_TRUE)
+			return reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+		return nullptr;
+	}
+}
+
+UniformRing::UniformRing(GLsizeiptr segment_size)
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+		_alignment = alignment;
+	_segment_size = get_aligned_size(segment_size);
+	GLsizeiptr const total_size = _segment_size * static_cast<GLsizeiptr>(segments_nb);
+
+	glGenBuffers(1, &_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+	auto const buffer_storage = getBufferStorage();
+	if (buffer_storage != nullptr) {
+		// Dynamic storage keeps `flush()` usable if mapping fails.
+		GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		buffer_storage(GL_UNIFORM_BUFFER, total_size, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+		_mapping = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, total_size, flags));
+		if (_mapping == nullptr)
+			LogWarning("Failed to map the uniform ring persistently; falling back to staging the writes.");
+	} else {
+		glBufferData(GL_UNIFORM_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+	}
+	if (_mapping == nullptr)
+		_staging.resize(static_cast<std::size_t>(total_size));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+	utils::opengl::debug::nameObject(GL_BUFFER, _buffer, "Uniform ring");
+}
+
+UniformRing::~UniformRing()
+{
+	for (auto& fence : _fences) {
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (_mapping != nullptr) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		_mapping = nullptr;
+	}
+	glDeleteBuffers(1, &_buffer);
+	_buffer = 0u;
+}
+
+GLintptr
+UniformRing::write(void const* data, GLsizeiptr size)
+{
+	if (size > _segment_size) {
+		LogError("%lld bytes do not fit in a uniform ring segment of %lld bytes.",
+		         static_cast<long long>(size), static_cast<long long>(_segment_size));
+		return -1;
+	}
+
+	reserve(size);
+
+	GLintptr const offset = _head;
+	_head += get_aligned_size(size);
+
+	auto const destination = _mapping != nullptr ? _mapping : _staging.data();
+	std::memcpy(destination + offset, data, static_cast<std::size_t>(size));
+
+	return offset;
+}
+
+void
+UniformRing::flush()
+{
+	if (_mapping == nullptr && _head > _flushed) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, _flushed, _head - _flushed, _staging.data() + _flushed);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+	}
+	_flushed = _head;
+}
+
+bool
+UniformRing::fits(GLsizeiptr size) const
+{
+	GLintptr const segment_end = static_cast<GLintptr>(_segment + 1u) * _segment_size;
+	return _head + size <= segment_end;
+}
+
+void
+UniformRing::reserve(GLsizeiptr size)
+{
+	if (!fits(size))
+		begin_segment((_segment + 1u) % segments_nb);
+}
+
+void
+UniformRing::begin_segment(std::size_t segment)
+{
+	// Data left unflushed would never reach the draws reading it.
+	flush();
+
+	// Everything drawn so far may read the segment being left.
+	if (_fences[_segment] != nullptr)
+		glDeleteSync(_fences[_segment]);
+	_fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	auto& fence = _fences[segment];
+	if (fence != nullptr) {
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		GLenum status = GL_TIMEOUT_EXPIRED;
+		while (status == GL_TIMEOUT_EXPIRED) {
+			status = glClientWaitSync(fence, flags, 1000000u); // 1 ms
+			flags = 0u;
+		}
+		if (status == GL_WAIT_FAILED)
+			LogError("Waiting on a uniform ring fence failed.");
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	_segment = segment;
+	_head = static_cast<GLintptr>(segment) * _segment_size;
+	_flushed = _head;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+//! \brief Uniform buffer written by the CPU as a ring, for data that changes
+//!        every draw, such as per-object transforms.
+//!
+//! Each `write()` copies its data into the next free range of the buffer,
+//! aligned so that it can be bound with `glBindBufferRange()`. The buffer is
+//! split into segments: when the ring moves on to a segment, a fence is
+//! inserted after the draws that read the previous one, and writing to a
+//! segment again waits on its fence, so data is never overwritten while the
+//! GPU may still read it.
+//!
+//! With buffer storage, from OpenGL 4.4 or GL_ARB_buffer_storage, the buffer
+//! is mapped persistently once and writes go straight into it. Otherwise
+//! they are staged in a CPU copy, and `flush()` uploads all of them since
+//! the previous flush with a single `glBufferSubData()`; writers should
+//! write the data of as many draws as `fits()` in the current segment,
+//! flush once, then issue those draws.
+class UniformRing
+{
+public:
+	//! \brief Allocate the buffer; needs a current OpenGL context.
+	//!
+	//! @param [in] segment_size size in bytes of each of the `segments_nb`
+	//!             segments; a single write cannot be larger
+	explicit UniformRing(GLsizeiptr segment_size = 1 << 20);
+	~UniformRing();
+	UniformRing(UniformRing const&) = delete;
+	UniformRing& operator=(UniformRing const&) = delete;
+
+	//! \brief Copy data into the next free range of the ring.
+	//!
+	//! @return the offset of that range in `buffer()`, or -1 if the data
+	//!         is larger than a segment
+	GLintptr write(void const* data, GLsizeiptr size);
+
+	//! \brief Upload the data written since the last flush; call it before
+	//!        issuing the draws reading it. Free with persistent mapping.
+	void flush();
+
+	//! \brief Return whether writes totalling `size` bytes, as given by
+	//!        `get_aligned_size()`, stay in the current segment.
+	bool fits(GLsizeiptr size) const;
+
+	//! \brief Move on to the next segment unless `size` bytes fit in the
+	//!        current one, so that the next writes end up in a single
+	//!        segment. Draws reading the current segment have to be issued
+	//!        already, as its fence is inserted then.
+	void reserve(GLsizeiptr size);
+
+	//! \brief Return how much of the ring a write of `size` bytes uses.
+	GLsizeiptr get_aligned_size(GLsizeiptr size) const { return (size + _alignment - 1) / _alignment * _alignment; }
+
+	//! \brief OpenGL name of the buffer the ranges are in.
+	GLuint buffer() const { return _buffer; }
+
+	static std::size_t const segments_nb = 3u;
+
+private:
+	void begin_segment(std::size_t segment);
+
+	GLuint _buffer{ 0u };
+	unsigned char* _mapping{ nullptr };   // persistent mapping, if supported
+	std::vector<unsigned char> _staging;  // CPU copy of the buffer otherwise
+	GLsizeiptr _segment_size{ 0 };
+	GLsizeiptr _alignment{ 256 };
+	GLintptr _head{ 0 };
+	GLintptr _flushed{ 0 };               // start of the data not uploaded yet
+	std::size_t _segment{ 0u };
+	std::array<GLsync, segments_nb> _fences{};
+};
@@ -1,5 +1,7 @@
 #include "WindowManager.hpp"
 
+#include "GLStateCache.hpp"
+#include "helpers.hpp"
 #include "Log.h"
 #include "opengl.hpp"
 
@@ -220,6 +222,8 @@ void WindowManager::DestroyWindow(GLFWwindow* const window)
 
 void WindowManager::NewImGuiFrame()
 {
+	bonobo::uploadLoadedTextures();
+
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
@@ -230,6 +234,8 @@ void WindowManager::RenderImGuiFrame(bool show_gui)
 	ImGui::Render();
 	if (show_gui)
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+	utils::opengl::state::endFrame();
 }
 
 void WindowManager::ToggleFullscreenStatusForWindow(GLFWwindow* const window) noexcept
@@ -1,21 +1,36 @@
 #include "config.hpp"
 #include "helpers.hpp"
 
+#include "core/GLStateCache.hpp"
+#include "core/JobSystem.hpp"
 #include "core/Log.h"
+#include "core/MeshOptimizer.hpp"
 #include "core/opengl.hpp"
+#include "core/ScenePack.hpp"
+#include "core/ShaderProgramManager.hpp"
+#include "core/UniformRing.hpp"
 #include "core/various.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <numeric>
+#include <utility>
 
 namespace
 {
@@ -34,9 +49,71 @@ namespace
 	} basis;
 
 	GLuint debug_texture_id{ 0u };
+	std::unique_ptr<UniformRing> uniform_ring;
+	std::unique_ptr<JobSystem> job_system;
+
+	// Texels of an image decoded by stb, with four channels each.
+	struct DecodedImage {
+		std::unique_ptr<unsigned char, void (*)(void*)> texels{ nullptr, stbi_image_free };
+		std::uint32_t width{ 0u };
+		std::uint32_t height{ 0u };
+	};
+
+	// Texture bound to a placeholder, whose image is being decoded.
+	struct PendingTexture {
+		GLuint texture;
+		bool generate_mipmap;
+		std::string filename;
+		std::future<DecodedImage> image;
+	};
+	std::vector<PendingTexture> pending_textures;
+	GLuint pixel_unpack_buffer{ 0u };
+
+	// Attribute stored in a vertex buffer, see `bonobo::vertex_format`.
+	struct VertexAttribute {
+		bonobo::shader_bindings binding;
+		GLint components_nb;
+		GLenum type;
+		GLboolean normalized;
+		std::size_t size;   // in bytes, per vertex
+		std::size_t offset; // of the attribute in a vertex if interleaved, of its block otherwise
+	};
+
+	// Where the attributes of the vertices of a buffer are stored.
+	struct VertexLayout {
+		std::vector<VertexAttribute> attributes;
+		bool interleaved{ false };
+		std::size_t vertex_size{ 0u };
+		std::size_t vertices_nb{ 0u };
+
+		std::size_t size() const { return vertex_size * vertices_nb; }
+		std::size_t address(VertexAttribute const& attribute, std::size_t vertex) const
+		{
+			return interleaved ? vertex * vertex_size + attribute.offset
+			                   : attribute.offset + vertex * attribute.size;
+		}
+	};
+
+	// Texels of an image followed by its whole mipmap hierarchy, as
+	// stored in packs.
+	struct MipmappedImage {
+		std::vector<unsigned char> texels;
+		std::uint32_t width{ 0u };
+		std::uint32_t height{ 0u };
+		std::uint32_t levels_nb{ 0u };
+	};
 
 	void setupBasisData();
 	void createDebugTexture();
+	DecodedImage decodeImage(std::string const& filename, bool flip);
+	GLuint createPlaceholderTexture(glm::vec4 const& colour);
+	void uploadImage(GLuint texture, DecodedImage const& image, bool generate_mipmap);
+	MipmappedImage buildMipmaps(DecodedImage const& image);
+	void uploadCookedTexture(GLuint texture, ScenePack::Texture const& cooked);
+	VertexLayout createVertexLayout(bonobo::vertex_format const& format, bool has_normals, bool has_texcoords, bool has_tangents, GLsizei vertices_nb);
+	void writeVertices(VertexLayout const& layout, ScenePack::Mesh const& mesh, std::size_t first_vertex, unsigned char* vertices);
+	void writeIndices(ScenePack::Mesh const& mesh, GLenum index_type, unsigned char* indices);
+	void enableVertexAttributes(VertexLayout const& layout);
 }
 
 namespace local
@@ -60,6 +137,11 @@ bonobo::init()
 {
 	setupBasisData();
 	createDebugTexture();
+	uniform_ring = std::make_unique<UniformRing>();
+
+	glGenBuffers(1, &pixel_unpack_buffer);
+	assert(pixel_unpack_buffer != 0u);
+	utils::opengl::debug::nameObject(GL_BUFFER, pixel_unpack_buffer, "Texture upload PBO");
 
 	glGenVertexArrays(1, &local::display_vao);
 	assert(local::display_vao != 0u);
@@ -74,280 +156,601 @@ bonobo::deinit()
 	glDeleteTextures(1, &debug_texture_id);
 	debug_texture_id = 0u;
 
+	uniform_ring.reset();
+
+	pending_textures.clear();
+	job_system.reset();
+	glDeleteBuffers(1, &pixel_unpack_buffer);
+	pixel_unpack_buffer = 0u;
+
+	ShaderProgramManager::UnregisterProgram(basis.shader);
 	glDeleteProgram(basis.shader);
 	glDeleteBuffers(1, &basis.ibo);
 	glDeleteBuffers(1, &basis.vbo);
 	glDeleteVertexArrays(1, &basis.vao);
 
+	ShaderProgramManager::UnregisterProgram(local::fullscreen_shader);
 	glDeleteProgram(local::fullscreen_shader);
 	glDeleteVertexArrays(1, &local::display_vao);
+
+	utils::opengl::state::invalidate();
+}
+
+// Post-processing steps shared by `loadObjects()` and `loadGeometry()`, so
+// that both number the vertices the same way.
+static unsigned int const assimp_import_flags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace;
+
+// Reorders the triangles of a mesh for the vertex cache and overdraw, and
+// returns the new number of each of its vertices, see `mesh_optimizer`;
+// points and lines keep their order. Used by both `loadObjects()` and
+// `loadGeometry()`.
+static std::vector<GLuint>
+optimizeMesh(aiMesh const& mesh, std::vector<GLuint>& indices, mesh_optimizer::Stats& stats)
+{
+	std::vector<GLuint> remap;
+	if (mesh.mFaces[0u].mNumIndices != 3u) {
+		remap.resize(mesh.mNumVertices);
+		std::iota(remap.begin(), remap.end(), 0u);
+		return remap;
+	}
+
+	stats = mesh_optimizer::optimize(indices.data(), indices.size(), reinterpret_cast<glm::vec3 const*>(mesh.mVertices),
+	                                 mesh.mNumVertices, remap);
+	return remap;
+}
+
+// Returns why a mesh cannot be loaded, or nullptr if it can be.
+static char const*
+getUnsupportedMeshReason(aiMesh const& mesh)
+{
+	if (!mesh.HasFaces())
+		return "has no faces";
+	if ((mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT | aiPrimitiveType_NGONEncodingFlag))    != 0u
+	 && (mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE | aiPrimitiveType_NGONEncodingFlag))     != 0u
+	 && (mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE | aiPrimitiveType_NGONEncodingFlag)) != 0u)
+		return "uses multiple primitive types";
+	if ((mesh.mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON))
+		return "uses polygons";
+	if (!mesh.HasPositions())
+		return "has no positions";
+	return nullptr;
 }
 
-static std::vector<std::uint8_t>
-getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
+// Logs why a mesh cannot be loaded, if that is the case.
+static bool
+isMeshSupported(aiMesh const& mesh)
 {
-	auto const channels_nb = 4u;
-	stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
-	unsigned char* image_data = stbi_load(filename.c_str(), reinterpret_cast<int*>(&width), reinterpret_cast<int*>(&height), nullptr, channels_nb);
-	if (image_data == nullptr) {
+	auto const reason = getUnsupportedMeshReason(mesh);
+	if (reason != nullptr)
+		LogError("Unsupported mesh \"%s\": %s", mesh.mName.C_Str(), reason);
+	return reason == nullptr;
+}
+
+// Decodes an image with stb, or logs why it could not and provides a small
+// empty one instead.
+static DecodedImage
+getTextureData(std::string const& filename, bool flip)
+{
+	auto image = decodeImage(filename, flip);
+	if (image.texels == nullptr) {
 		LogWarning("Couldn't load or decode image file %s", filename.c_str());
 
 		// Provide a small empty image instead in case of failure.
-		width = 16;
-		height = 16;
-		return std::vector<unsigned char>(width * height * channels_nb);
+		image.width = 16u;
+		image.height = 16u;
+		image.texels.reset(static_cast<unsigned char*>(std::calloc(image.width * image.height * 4u, 1u)));
 	}
-
-	std::vector<unsigned char> image(width * height * channels_nb);
-	std::memcpy(image.data(), image_data, image.size());
-	stbi_image_free(image_data);
-
 	return image;
 }
 
-std::vector<bonobo::mesh_data>
-bonobo::loadObjects(std::string const& filename)
-{
-	auto const scene_start_time = std::chrono::high_resolution_clock::now();
+// Everything loading an object/scene file requires that does not involve
+// OpenGL, so that it can be prepared by jobs; it is read either from the
+// pack of the file, or from the file itself with Assimp.
+struct bonobo::loaded_scene {
+	struct texture {
+		std::string type_as_str;             // e.g. "diffuse"
+		std::string binding;                 // name of the sampler, e.g. "diffuse_texture"
+		std::string path;
+		bool has_others{ false };            // whether the material has other textures of that type, that are discarded
+		std::future<DecodedImage> image;     // when decoded from `path`
+		ScenePack::Texture const* cooked{ nullptr }; // when read from the pack
+	};
+	struct material {
+		bool is_used{ false };
+		std::string name;
+		material_data constants;
+		std::vector<texture> textures;
+	};
+	struct mesh {
+		std::vector<GLuint> indices;
+		std::vector<glm::vec3> vertices;    // in the order given by `optimizeMesh()`
+		std::vector<glm::vec3> normals;     // empty if the mesh has none, and so on
+		std::vector<glm::vec3> texcoords;
+		std::vector<glm::vec3> tangents;
+		std::vector<glm::vec3> binormals;
+		mesh_bounds bounds;
+		mesh_optimizer::Stats acmr;         // left at 0 for points and lines
+	};
 
-	std::vector<bonobo::mesh_data> objects;
+	std::string filename;
+	std::chrono::high_resolution_clock::time_point start_time;
+	std::unique_ptr<ScenePack> pack;            // set if an up-to-date pack was found
+	std::string pack_error;                     // why the pack found was not used
+	std::shared_ptr<Assimp::Importer> importer; // owns `scene`; shared with the mesh jobs reading it
+	aiScene const* scene{ nullptr };            // null if Assimp failed, see `error`, or was not needed
+	std::string error;
+	std::vector<material> materials;            // one per material of the scene
+	std::vector<std::future<mesh>> meshes;      // one per mesh of `scene`, not valid for unsupported ones
+};
+
+// Reads an object/scene file, and queues the jobs decoding its textures and
+// building its index buffers; if `read_pack` is set and the file has an
+// up-to-date pack, the pack is mapped instead. It does not log, so it can
+// run in a job.
+static std::shared_ptr<bonobo::loaded_scene>
+prepareScene(std::string const& filename, bool read_pack)
+{
+	auto scene = std::make_shared<bonobo::loaded_scene>();
+	scene->filename = filename;
+	scene->start_time = std::chrono::high_resolution_clock::now();
+
+	if (read_pack) {
+		auto pack = std::make_unique<ScenePack>();
+		if (pack->open(ScenePack::get_filename(filename), scene->pack_error)) {
+			scene->materials.resize(pack->materials().size());
+			for (auto const& mesh : pack->meshes())
+				if (mesh.material_id < scene->materials.size())
+					scene->materials[mesh.material_id].is_used = true;
+			for (size_t i = 0; i < pack->materials().size(); ++i) {
+				auto const& cooked_material = pack->materials()[i];
+				auto& material = scene->materials[i];
+				material.name = cooked_material.name;
+				material.constants = cooked_material.constants;
+				for (auto const& cooked_texture : cooked_material.textures) {
+					bonobo::loaded_scene::texture texture;
+					texture.type_as_str = cooked_texture.type_as_str;
+					texture.binding = cooked_texture.binding;
+					texture.path = cooked_texture.path;
+					texture.cooked = &cooked_texture;
+					material.textures.push_back(std::move(texture));
+				}
+			}
+			scene->pack = std::move(pack);
+			return scene;
+		}
+	}
 
 	auto const end_of_basedir = filename.rfind("/");
 	auto const parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
-	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
+	scene->importer = std::make_shared<Assimp::Importer>();
+	auto const assimp_scene = scene->importer->ReadFile(filename, assimp_import_flags);
 	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
-		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), importer.GetErrorString());
-		return objects;
+		scene->error = scene->importer->GetErrorString();
+		return scene;
 	}
+	scene->scene = assimp_scene;
 
-	if (assimp_scene->mNumMeshes == 0u) {
-		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
-		return objects;
-	}
+	auto& jobs = bonobo::getJobSystem();
 
-	LogInfo("┭ Loading \"%s\"…", filename.c_str());
-
-	std::vector<bool> are_materials_used(assimp_scene->mNumMaterials, false);
+	// Textures are queued first, as decoding them takes the longest.
+	scene->materials.resize(assimp_scene->mNumMaterials);
 	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= assimp_scene->mNumMaterials)
-			LogError("Mesh \"%s\" has a material index of %u, but only %u materials are present.", assimp_object_mesh->mName.C_Str(), material_id, assimp_scene->mNumMaterials);
-		else
-			are_materials_used[material_id] = true;
+		auto const material_id = assimp_scene->mMeshes[j]->mMaterialIndex;
+		if (material_id < assimp_scene->mNumMaterials)
+			scene->materials[material_id].is_used = true;
 	}
-
-	auto const materials_start_time = std::chrono::high_resolution_clock::now();
-	std::vector<texture_bindings> materials_bindings(assimp_scene->mNumMaterials);
-	std::vector<material_data> material_constants(assimp_scene->mNumMaterials);
-	uint32_t texture_count = 0u;
 	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		if (!are_materials_used[i])
+		auto& material = scene->materials[i];
+		auto const assimp_material = assimp_scene->mMaterials[i];
+		material.name = assimp_material->GetName().C_Str();
+		if (!material.is_used)
 			continue;
 
-		auto const material_start_time = std::chrono::high_resolution_clock::now();
-		texture_bindings& bindings = materials_bindings[i];
-		material_data& constants = material_constants[i];
-		auto const material = assimp_scene->mMaterials[i];
-
-		auto const process_texture = [&bindings,&material,i,&parent_folder,&texture_count](aiTextureType type, std::string const& type_as_str, std::string const& name){
-			if (material->GetTextureCount(type)) {
-				auto const texture_start_time = std::chrono::high_resolution_clock::now();
-
-				if (material->GetTextureCount(type) > 1)
-					LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material->GetName().C_Str(), type_as_str.c_str());
-				aiString path;
-				material->GetTexture(type, 0, &path);
-				auto const id = bonobo::loadTexture2D(parent_folder + std::string(path.C_Str()));
-				if (id == 0u) {
-					LogWarning("Failed to load the %s texture for material \"%s\".", type_as_str.c_str(), material->GetName().C_Str());
-					return;
-				}
-				bindings.emplace(name, id);
-				++texture_count;
-
-				utils::opengl::debug::nameObject(GL_TEXTURE, id, std::string(material->GetName().C_Str()) + " " + type_as_str);
-
-				auto const texture_end_time = std::chrono::high_resolution_clock::now();
-				LogTrivia("│ %s Texture \"%s\" loaded in %.3f ms",
-				          bindings.size() == 1 ? "┌" : "├", path.C_Str(),
-				          std::chrono::duration<float, std::milli>(texture_end_time - texture_start_time).count());
-			}
+		auto const add_texture = [&](aiTextureType type, std::string const& type_as_str, std::string const& binding){
+			if (assimp_material->GetTextureCount(type) == 0u)
+				return;
+
+			aiString path;
+			assimp_material->GetTexture(type, 0, &path);
+			bonobo::loaded_scene::texture texture;
+			texture.type_as_str = type_as_str;
+			texture.binding = binding;
+			texture.path = parent_folder + std::string(path.C_Str());
+			texture.has_others = assimp_material->GetTextureCount(type) > 1u;
+			texture.image = jobs.submit([texture_path = texture.path](){
+				return decodeImage(texture_path, true);
+			});
+			material.textures.push_back(std::move(texture));
 		};
 
 		aiColor3D color;
+		auto& constants = material.constants;
 
-		material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
+		assimp_material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
 		constants.diffuse = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_SPECULAR, color);
+		assimp_material->Get(AI_MATKEY_COLOR_SPECULAR, color);
 		constants.specular = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_AMBIENT, color);
+		assimp_material->Get(AI_MATKEY_COLOR_AMBIENT, color);
 		constants.ambient = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_COLOR_EMISSIVE, color);
+		assimp_material->Get(AI_MATKEY_COLOR_EMISSIVE, color);
 		constants.emissive = glm::vec3(color.r, color.g, color.b);
-		material->Get(AI_MATKEY_SHININESS, constants.shininess);
-		material->Get(AI_MATKEY_REFRACTI, constants.indexOfRefraction);
-		material->Get(AI_MATKEY_OPACITY, constants.opacity);
+		assimp_material->Get(AI_MATKEY_SHININESS, constants.shininess);
+		assimp_material->Get(AI_MATKEY_REFRACTI, constants.indexOfRefraction);
+		assimp_material->Get(AI_MATKEY_OPACITY, constants.opacity);
+
+		add_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
+		add_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
+		add_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
+		add_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+	}
 
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+	scene->meshes.resize(assimp_scene->mNumMeshes);
+	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+		if (getUnsupportedMeshReason(*assimp_object_mesh) != nullptr)
+			continue;
 
-		auto const material_end_time = std::chrono::high_resolution_clock::now();
-		LogTrivia("│ %s Material \"%s\" loaded in %.3f ms",
-		          bindings.empty() ? "╺" : "┕", material->GetName().C_Str(),
-		          std::chrono::duration<float, std::milli>(material_end_time - material_start_time).count());
+		scene->meshes[j] = jobs.submit([importer = scene->importer, assimp_object_mesh](){
+			bonobo::loaded_scene::mesh mesh;
+
+			auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+			mesh.indices.resize(assimp_object_mesh->mNumFaces * num_vertices_per_face);
+			for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+				auto const& face = assimp_object_mesh->mFaces[i];
+				assert(face.mNumIndices == num_vertices_per_face);
+				std::copy_n(face.mIndices, num_vertices_per_face, mesh.indices.begin() + num_vertices_per_face * i);
+			}
+
+			auto const remap = optimizeMesh(*assimp_object_mesh, mesh.indices, mesh.acmr);
+			auto const remap_attribute = [&remap](aiVector3D const* values){
+				return values != nullptr ? mesh_optimizer::remapVertices(reinterpret_cast<glm::vec3 const*>(values), remap)
+				                         : std::vector<glm::vec3>();
+			};
+			mesh.vertices = remap_attribute(assimp_object_mesh->mVertices);
+			mesh.normals = remap_attribute(assimp_object_mesh->mNormals);
+			mesh.texcoords = remap_attribute(assimp_object_mesh->mTextureCoords[0u]);
+			if (assimp_object_mesh->HasTangentsAndBitangents()) {
+				mesh.tangents = remap_attribute(assimp_object_mesh->mTangents);
+				mesh.binormals = remap_attribute(assimp_object_mesh->mBitangents);
+			}
+
+			mesh.bounds = bonobo::computeBounds(mesh.vertices.data(), mesh.vertices.size());
+			return mesh;
+		});
 	}
-	auto const materials_end_time = std::chrono::high_resolution_clock::now();
 
-	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
-	objects.reserve(assimp_scene->mNumMeshes);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+	return scene;
+}
 
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+// Returns the supported meshes of a prepared scene, pointing either into
+// its pack, or into `prepared`, waiting for the latter to be filled by the
+// mesh jobs. In the second case, `acmr` is set to the Average Cache Miss
+// Ratio of all triangles before and after `optimizeMesh()`, and
+// `triangles_nb` to their number; packs only hold optimised meshes.
+static std::vector<ScenePack::Mesh>
+collectMeshes(bonobo::loaded_scene& scene, std::vector<bonobo::loaded_scene::mesh>& prepared,
+              mesh_optimizer::Stats& acmr, std::size_t& triangles_nb)
+{
+	acmr = mesh_optimizer::Stats();
+	triangles_nb = 0u;
 
-		if (!assimp_object_mesh->HasFaces()) {
-			LogError("Unsupported mesh \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT | aiPrimitiveType_NGONEncodingFlag))    != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE | aiPrimitiveType_NGONEncodingFlag))     != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE | aiPrimitiveType_NGONEncodingFlag)) != 0u) {
-			LogError("Unsupported mesh \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
-			LogError("Unsupported mesh \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if (!assimp_object_mesh->HasPositions()) {
-			LogError("Unsupported mesh \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
+	if (scene.pack != nullptr)
+		return scene.pack->meshes();
+
+	std::vector<ScenePack::Mesh> meshes;
+	auto const assimp_scene = scene.scene;
+	if (assimp_scene == nullptr)
+		return meshes;
+
+	prepared.reserve(assimp_scene->mNumMeshes);
+	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+		if (!scene.meshes[j].valid()) {
+			isMeshSupported(*assimp_object_mesh);
 			continue;
 		}
-
-		bonobo::mesh_data object;
-		if (assimp_object_mesh->mName.length != 0)
-		{
-			object.name = std::string(assimp_object_mesh->mName.C_Str());
+		auto const material_id = assimp_object_mesh->mMaterialIndex;
+		if (material_id >= assimp_scene->mNumMaterials)
+			LogError("Mesh \"%s\" has a material index of %u, but only %u materials are present.", assimp_object_mesh->mName.C_Str(), material_id, assimp_scene->mNumMaterials);
+		prepared.push_back(scene.meshes[j].get());
+
+		ScenePack::Mesh mesh;
+		mesh.name = assimp_object_mesh->mName.C_Str();
+		mesh.material_id = material_id;
+		mesh.vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+		auto const& prepared_mesh = prepared.back();
+		auto const attribute = [](std::vector<glm::vec3> const& values){
+			return values.empty() ? nullptr : values.data();
+		};
+		mesh.vertices_nb = static_cast<std::uint32_t>(prepared_mesh.vertices.size());
+		mesh.vertices = attribute(prepared_mesh.vertices);
+		mesh.normals = attribute(prepared_mesh.normals);
+		mesh.texcoords = attribute(prepared_mesh.texcoords);
+		mesh.tangents = attribute(prepared_mesh.tangents);
+		mesh.binormals = attribute(prepared_mesh.binormals);
+		mesh.indices_nb = static_cast<std::uint32_t>(prepared_mesh.indices.size());
+		mesh.indices = prepared_mesh.indices.data();
+		mesh.bounds = prepared_mesh.bounds;
+		meshes.push_back(std::move(mesh));
+
+		if (prepared_mesh.acmr.acmr_before > 0.0f) {
+			auto const mesh_triangles_nb = static_cast<float>(prepared_mesh.indices.size() / 3u);
+			acmr.acmr_before += prepared_mesh.acmr.acmr_before * mesh_triangles_nb;
+			acmr.acmr_after += prepared_mesh.acmr.acmr_after * mesh_triangles_nb;
+			triangles_nb += prepared_mesh.indices.size() / 3u;
 		}
+	}
+	if (triangles_nb > 0u) {
+		acmr.acmr_before /= static_cast<float>(triangles_nb);
+		acmr.acmr_after /= static_cast<float>(triangles_nb);
+	}
 
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
+	return meshes;
+}
 
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
+// Creates the OpenGL objects of a prepared scene, with vertices in the given
+// format; textures are either uploaded once decoded, or streamed in by
+// `uploadLoadedTextures()`. Cooked textures are always uploaded right away,
+// as they only need to be copied.
+static std::vector<bonobo::mesh_data>
+uploadScene(bonobo::loaded_scene& scene, bool share_buffers, bonobo::vertex_format const& format, bool stream_textures)
+{
+	std::vector<bonobo::mesh_data> objects;
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
+	auto const& filename = scene.filename;
+	if (!scene.pack_error.empty())
+		LogWarning("Ignoring the pack of \"%s\" as %s; run EDAN35_PackCooker to cook it again.", filename.c_str(), scene.pack_error.c_str());
 
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
+	if (scene.pack == nullptr && scene.scene == nullptr) {
+		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), scene.error.c_str());
+		return objects;
+	}
 
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	auto const meshes_nb = scene.pack != nullptr ? scene.pack->meshes().size() : static_cast<size_t>(scene.scene->mNumMeshes);
+	if (meshes_nb == 0u) {
+		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
+		return objects;
+	}
 
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	LogInfo("┭ Loading \"%s\"%s…", filename.c_str(), scene.pack != nullptr ? " from its pack" : "");
 
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
+	auto const materials_start_time = std::chrono::high_resolution_clock::now();
+	std::vector<bonobo::texture_bindings> materials_bindings(scene.materials.size());
+	std::vector<bonobo::material_data> material_constants(scene.materials.size());
+	uint32_t texture_count = 0u;
+	for (size_t i = 0; i < scene.materials.size(); ++i) {
+		auto& material = scene.materials[i];
+		if (!material.is_used)
+			continue;
 
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+		auto const material_start_time = std::chrono::high_resolution_clock::now();
+		bonobo::texture_bindings& bindings = materials_bindings[i];
+		material_constants[i] = material.constants;
+
+		for (auto& texture : material.textures) {
+			auto const texture_start_time = std::chrono::high_resolution_clock::now();
+
+			if (texture.has_others)
+				LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material.name.c_str(), texture.type_as_str.c_str());
+
+			GLuint id = 0u;
+			bool const is_queued = stream_textures && texture.cooked == nullptr;
+			if (texture.cooked != nullptr) {
+				glGenTextures(1, &id);
+				assert(id != 0u);
+				uploadCookedTexture(id, *texture.cooked);
+			} else if (is_queued) {
+				// A flat normal keeps the shading sensible until the
+				// normal map is loaded.
+				id = createPlaceholderTexture(texture.type_as_str == "normals" ? glm::vec4(0.5f, 0.5f, 1.0f, 1.0f) : glm::vec4(1.0f));
+				pending_textures.push_back({ id, true, texture.path, std::move(texture.image) });
+			} else {
+				auto const image = texture.image.get();
+				if (image.texels != nullptr) {
+					glGenTextures(1, &id);
+					assert(id != 0u);
+					uploadImage(id, image, true);
+				}
+			}
+			if (id == 0u) {
+				LogWarning("Failed to load the %s texture for material \"%s\".", texture.type_as_str.c_str(), material.name.c_str());
+				continue;
+			}
+			bindings.emplace(texture.binding, id);
+			++texture_count;
 
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
+			utils::opengl::debug::nameObject(GL_TEXTURE, id, material.name + " " + texture.type_as_str);
 
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+			auto const texture_end_time = std::chrono::high_resolution_clock::now();
+			LogTrivia("│ %s Texture \"%s\" %s in %.3f ms",
+			          bindings.size() == 1 ? "┌" : "├", texture.path.c_str(), is_queued ? "queued" : "loaded",
+			          std::chrono::duration<float, std::milli>(texture_end_time - texture_start_time).count());
 		}
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
+		auto const material_end_time = std::chrono::high_resolution_clock::now();
+		LogTrivia("│ %s Material \"%s\" loaded in %.3f ms",
+		          bindings.empty() ? "╺" : "┕", material.name.c_str(),
+		          std::chrono::duration<float, std::milli>(material_end_time - material_start_time).count());
+	}
+	auto const materials_end_time = std::chrono::high_resolution_clock::now();
 
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-		}
+	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
+	std::vector<bonobo::loaded_scene::mesh> prepared_meshes;
+	mesh_optimizer::Stats acmr;
+	std::size_t triangles_nb = 0u;
+	auto const meshes = collectMeshes(scene, prepared_meshes, acmr, triangles_nb);
+	if (triangles_nb > 0u)
+		LogInfo("│ Triangles reordered for the vertex cache and overdraw: ACMR %.3f → %.3f over %zu triangles",
+		        acmr.acmr_before, acmr.acmr_after, triangles_nb);
+	objects.reserve(meshes.size());
+
+	// The vertices and indices of a buffer are first laid out in memory,
+	// then uploaded at once.
+	auto const can_use_short_indices = [&format](ScenePack::Mesh const& mesh){
+		return format.short_indices && mesh.vertices_nb <= 65536u;
+	};
+	auto const create_buffers = [](VertexLayout const& layout, std::vector<unsigned char> const& vertices,
+	                               std::vector<unsigned char> const& indices, bonobo::mesh_data& object){
+		glGenVertexArrays(1, &object.vao);
+		assert(object.vao != 0u);
+		utils::opengl::state::bindVertexArray(object.vao);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		glGenBuffers(1, &object.bo);
+		assert(object.bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size()), vertices.data(), GL_STATIC_DRAW);
+		enableVertexAttributes(layout);
 
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face > 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face > 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
+		// Binding the index buffer changes the one of the bound Vertex
+		// Array Object, which is the one it belongs to.
 		glGenBuffers(1, &object.ibo);
 		assert(object.ibo != 0u);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
-
-		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, object.name + " VAO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.bo, object.name + " VBO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.ibo, object.name + " IBO");
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size()), indices.data(), GL_STATIC_DRAW);
 
-		glBindVertexArray(0u);
+		utils::opengl::state::bindVertexArray(0u);
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+	};
 
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id < materials_bindings.size()) {
-			object.bindings = materials_bindings[material_id];
-			object.material = material_constants[material_id];
+	// With shared buffers, all meshes are stored one after the other.
+	// Attributes that only some meshes have are zeroed for the others, so
+	// that all attributes of a vertex are found at the same index.
+	struct {
+		VertexLayout layout;
+		GLenum index_type{GL_UNSIGNED_INT};
+		std::vector<unsigned char> vertices;
+		std::vector<unsigned char> indices;
+		GLsizei next_vertex{0};
+		GLsizei next_index{0};
+	} shared;
+	if (share_buffers) {
+		GLsizei vertices_nb = 0;
+		GLsizei indices_nb = 0;
+		bool has_normals = false, has_texcoords = false, has_tangents = false, use_short_indices = true;
+		for (auto const& mesh : meshes) {
+			vertices_nb += static_cast<GLsizei>(mesh.vertices_nb);
+			indices_nb += static_cast<GLsizei>(mesh.indices_nb);
+			has_normals |= mesh.normals != nullptr;
+			has_texcoords |= mesh.texcoords != nullptr;
+			has_tangents |= mesh.tangents != nullptr;
+			use_short_indices &= can_use_short_indices(mesh);
+		}
+
+		shared.layout = createVertexLayout(format, has_normals, has_texcoords, has_tangents, vertices_nb);
+		shared.index_type = use_short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		shared.vertices.resize(shared.layout.size());
+		shared.indices.resize(static_cast<std::size_t>(indices_nb) * bonobo::getIndexSize(shared.index_type));
+	}
+
+	// Sizes of all vertex and index buffers, and what they would have been
+	// with the default format.
+	std::size_t vertices_size = 0u, indices_size = 0u;
+	std::size_t default_vertices_size = 0u, default_indices_size = 0u;
+	std::size_t vertices_nb = 0u;
+	for (size_t j = 0; j < meshes.size(); ++j) {
+		auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+
+		auto const& mesh = meshes[j];
+
+		bonobo::mesh_data object;
+		if (!mesh.name.empty())
+		{
+			object.name = mesh.name;
+		}
+
+		object.indices_nb = static_cast<GLsizei>(mesh.indices_nb);
+		object.vertices_nb = static_cast<GLsizei>(mesh.vertices_nb);
+		object.bounds = mesh.bounds;
+		if (share_buffers) {
+			object.base_vertex = shared.next_vertex;
+			object.first_index = static_cast<GLuint>(shared.next_index);
+			object.index_type = shared.index_type;
+
+			writeVertices(shared.layout, mesh, static_cast<std::size_t>(shared.next_vertex), shared.vertices.data());
+			writeIndices(mesh, shared.index_type, shared.indices.data() + static_cast<std::size_t>(shared.next_index) * bonobo::getIndexSize(shared.index_type));
+
+			shared.next_vertex += object.vertices_nb;
+			shared.next_index += object.indices_nb;
+		} else {
+			auto const layout = createVertexLayout(format, mesh.normals != nullptr, mesh.texcoords != nullptr,
+			                                       mesh.tangents != nullptr, object.vertices_nb);
+			object.index_type = can_use_short_indices(mesh) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+			std::vector<unsigned char> vertices(layout.size());
+			std::vector<unsigned char> indices(static_cast<std::size_t>(mesh.indices_nb) * bonobo::getIndexSize(object.index_type));
+			writeVertices(layout, mesh, 0u, vertices.data());
+			writeIndices(mesh, object.index_type, indices.data());
+			create_buffers(layout, vertices, indices, object);
+			vertices_size += vertices.size();
+			indices_size += indices.size();
+
+			utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, object.name + " VAO");
+			utils::opengl::debug::nameObject(GL_BUFFER, object.bo, object.name + " VBO");
+			utils::opengl::debug::nameObject(GL_BUFFER, object.ibo, object.name + " IBO");
+		}
+		if (mesh.material_id < materials_bindings.size()) {
+			object.bindings = materials_bindings[mesh.material_id];
+			object.material = material_constants[mesh.material_id];
 		}
 
+		// The default format has one float3 per attribute, binormals
+		// included, and 32-bit indices.
+		auto const default_attributes_nb = 1u + (mesh.normals != nullptr ? 1u : 0u) + (mesh.texcoords != nullptr ? 1u : 0u)
+		                                 + (mesh.tangents != nullptr ? 2u : 0u);
+		default_vertices_size += static_cast<std::size_t>(mesh.vertices_nb) * default_attributes_nb * sizeof(glm::vec3);
+		default_indices_size += static_cast<std::size_t>(mesh.indices_nb) * sizeof(GLuint);
+		vertices_nb += mesh.vertices_nb;
+
 		objects.push_back(object);
 
 		auto const mesh_end_time = std::chrono::high_resolution_clock::now();
 
-		std::string attributes = assimp_object_mesh->HasNormals() ? "normals" : "";
+		std::string attributes = mesh.normals != nullptr ? "normals" : "";
 		if (!attributes.empty())
 		  attributes += " | ";
-		if (assimp_object_mesh->HasTangentsAndBitangents())
+		if (mesh.tangents != nullptr)
 		  attributes += "tangents&bitangents";
 		if (!attributes.empty())
 		  attributes += " | ";
-		if (assimp_object_mesh->HasTextureCoords(0))
+		if (mesh.texcoords != nullptr)
 		  attributes += "texture coordinates";
 		LogTrivia("│ %s Mesh \"%s\" loaded with attributes [%s] in %.3f ms",
-		          (assimp_scene->mNumMeshes == 1u) ? "╶" : (j == 0 ? "┌" : (j == assimp_scene->mNumMeshes - 1 ? "└" : "├")),
-		          assimp_object_mesh->mName.C_Str(), attributes.c_str(),
+		          (meshes.size() == 1u) ? "╶" : (j == 0 ? "┌" : (j == meshes.size() - 1 ? "└" : "├")),
+		          mesh.name.c_str(), attributes.c_str(),
 		          std::chrono::duration<float, std::milli>(mesh_end_time - mesh_start_time).count());
 	}
+	if (share_buffers && !objects.empty()) {
+		bonobo::mesh_data buffers;
+		create_buffers(shared.layout, shared.vertices, shared.indices, buffers);
+		for (auto& object : objects) {
+			object.vao = buffers.vao;
+			object.bo = buffers.bo;
+			object.ibo = buffers.ibo;
+		}
+		vertices_size = shared.vertices.size();
+		indices_size = shared.indices.size();
+
+		auto const end_of_basedir = filename.rfind("/");
+		auto const scene_name = filename.substr(end_of_basedir != std::string::npos ? end_of_basedir + 1u : 0u);
+		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, buffers.vao, scene_name + " shared VAO");
+		utils::opengl::debug::nameObject(GL_BUFFER, buffers.bo, scene_name + " shared VBO");
+		utils::opengl::debug::nameObject(GL_BUFFER, buffers.ibo, scene_name + " shared IBO");
+	}
 	auto const meshes_end_time = std::chrono::high_resolution_clock::now();
 
+	// Every vertex drawn fetches all of its attributes, so the bytes per
+	// vertex are also the vertex fetch bandwidth per vertex.
+	auto const to_mebibytes = [](std::size_t size){ return static_cast<float>(size) / (1024.0f * 1024.0f); };
+	if (vertices_nb > 0u)
+		LogInfo("│ Vertex buffers take %.2f MiB, %.1f bytes per vertex, and index buffers %.2f MiB; %.2f MiB, %.1f bytes and %.2f MiB with the default format",
+		        to_mebibytes(vertices_size), static_cast<float>(vertices_size) / static_cast<float>(vertices_nb), to_mebibytes(indices_size),
+		        to_mebibytes(default_vertices_size), static_cast<float>(default_vertices_size) / static_cast<float>(vertices_nb), to_mebibytes(default_indices_size));
+
 	auto const scene_end_time = std::chrono::high_resolution_clock::now();
-	LogInfo("┕ Scene loaded in %.3f s: %u textures loaded in %.3f s and %zu meshes in %.3f s",
-	        std::chrono::duration<float>(scene_end_time - scene_start_time).count(),
-	        texture_count,
+	LogInfo("┕ Scene loaded in %.3f s: %u textures %s in %.3f s and %zu meshes in %.3f s",
+	        std::chrono::duration<float>(scene_end_time - scene.start_time).count(),
+	        texture_count, stream_textures && scene.pack == nullptr ? "queued" : "loaded",
 	        std::chrono::duration<float>(materials_end_time - materials_start_time).count(),
 	        objects.size(),
 	        std::chrono::duration<float>(meshes_end_time - meshes_start_time).count());
@@ -355,13 +758,211 @@ bonobo::loadObjects(std::string const& filename)
 	return objects;
 }
 
+std::vector<bonobo::mesh_data>
+bonobo::loadObjects(std::string const& filename, bool share_buffers, vertex_format const& format)
+{
+	auto const scene = prepareScene(filename, true);
+	return uploadScene(*scene, share_buffers, format, false);
+}
+
+bool
+bonobo::pending_objects::is_ready() const
+{
+	return _scene.valid() && _scene.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+std::vector<bonobo::mesh_data>
+bonobo::pending_objects::get()
+{
+	if (!_scene.valid()) {
+		LogError("The objects of this file have already been retrieved.");
+		return {};
+	}
+
+	auto const scene = _scene.get();
+	return uploadScene(*scene, _share_buffers, _format, true);
+}
+
+bonobo::pending_objects
+bonobo::loadObjectsAsync(std::string const& filename, bool share_buffers, vertex_format const& format)
+{
+	pending_objects pending;
+	pending._scene = getJobSystem().submit([filename](){ return prepareScene(filename, true); });
+	pending._share_buffers = share_buffers;
+	pending._format = format;
+	return pending;
+}
+
+bool
+bonobo::cookObjects(std::string const& filename)
+{
+	auto const start_time = std::chrono::high_resolution_clock::now();
+	auto const scene = prepareScene(filename, false);
+	if (scene->scene == nullptr) {
+		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), scene->error.c_str());
+		return false;
+	}
+
+	// Dependencies are relative to the folder of the pack, which is the
+	// one of the object/scene file and the start of all texture paths.
+	auto const end_of_basedir = filename.rfind("/");
+	auto const parent_folder_length = end_of_basedir != std::string::npos ? end_of_basedir + 1u : 0u;
+	std::vector<std::string> dependencies{ filename.substr(parent_folder_length) };
+
+	// The mipmap hierarchy of each texture is built by a job as soon as
+	// its image is decoded.
+	auto& jobs = getJobSystem();
+	std::vector<std::future<MipmappedImage>> mipmapping;
+	std::vector<std::pair<std::size_t, std::size_t>> mipmapped_textures; // material and texture indices
+	for (size_t i = 0; i < scene->materials.size(); ++i) {
+		auto& material = scene->materials[i];
+		for (size_t t = 0; t < material.textures.size(); ++t) {
+			auto& texture = material.textures[t];
+			dependencies.push_back(texture.path.substr(parent_folder_length));
+			if (texture.has_others)
+				LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material.name.c_str(), texture.type_as_str.c_str());
+
+			auto image = std::make_shared<DecodedImage>(texture.image.get());
+			if (image->texels == nullptr) {
+				LogWarning("Couldn't load or decode image file %s; it is left out of the pack.", texture.path.c_str());
+				continue;
+			}
+			mipmapping.push_back(jobs.submit([image](){ return buildMipmaps(*image); }));
+			mipmapped_textures.emplace_back(i, t);
+		}
+	}
+
+	std::vector<MipmappedImage> images(mipmapped_textures.size());
+	std::vector<ScenePack::Material> materials(scene->materials.size());
+	for (size_t i = 0; i < scene->materials.size(); ++i) {
+		materials[i].name = scene->materials[i].name;
+		materials[i].constants = scene->materials[i].constants;
+	}
+	for (size_t m = 0; m < mipmapped_textures.size(); ++m) {
+		images[m] = mipmapping[m].get();
+		auto const& texture = scene->materials[mipmapped_textures[m].first].textures[mipmapped_textures[m].second];
+		ScenePack::Texture cooked;
+		cooked.type_as_str = texture.type_as_str;
+		cooked.binding = texture.binding;
+		cooked.path = texture.path.substr(parent_folder_length);
+		cooked.width = images[m].width;
+		cooked.height = images[m].height;
+		cooked.levels_nb = images[m].levels_nb;
+		cooked.texels = images[m].texels.data();
+		materials[mipmapped_textures[m].first].textures.push_back(std::move(cooked));
+	}
+
+	std::vector<loaded_scene::mesh> prepared_meshes;
+	mesh_optimizer::Stats acmr;
+	std::size_t triangles_nb = 0u;
+	auto const meshes = collectMeshes(*scene, prepared_meshes, acmr, triangles_nb);
+	if (triangles_nb > 0u)
+		LogInfo("Reordered the %zu triangles of \"%s\" for the vertex cache and overdraw: ACMR %.3f → %.3f",
+		        triangles_nb, filename.c_str(), acmr.acmr_before, acmr.acmr_after);
+
+	auto const pack_filename = ScenePack::get_filename(filename);
+	if (!ScenePack::write(pack_filename, dependencies, materials, meshes))
+		return false;
+
+	auto const pack_size = static_cast<std::size_t>(std::ifstream(pack_filename, std::ios::binary | std::ios::ate).tellg());
+	LogInfo("Cooked %zu meshes and %zu textures of \"%s\" into \"%s\" (%.1f MiB) in %.2f s",
+	        meshes.size(), images.size(), filename.c_str(), pack_filename.c_str(),
+	        static_cast<float>(pack_size) / (1024.0f * 1024.0f),
+	        std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start_time).count());
+	return true;
+}
+
+std::vector<bonobo::mesh_geometry>
+bonobo::loadGeometry(std::string const& filename)
+{
+	std::vector<bonobo::mesh_geometry> meshes;
+
+	Assimp::Importer importer;
+	auto const assimp_scene = importer.ReadFile(filename, assimp_import_flags);
+	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
+		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), importer.GetErrorString());
+		return meshes;
+	}
+
+	meshes.reserve(assimp_scene->mNumMeshes);
+	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+		if (!isMeshSupported(*assimp_object_mesh))
+			continue;
+
+		bonobo::mesh_geometry mesh;
+		if (assimp_object_mesh->mName.length != 0)
+			mesh.name = std::string(assimp_object_mesh->mName.C_Str());
+
+		mesh.vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+		mesh.indices.reserve(assimp_object_mesh->mNumFaces * mesh.vertices_per_face);
+		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+			auto const& face = assimp_object_mesh->mFaces[i];
+			mesh.indices.insert(mesh.indices.end(), face.mIndices, face.mIndices + mesh.vertices_per_face);
+		}
+
+		mesh_optimizer::Stats acmr;
+		auto const remap = optimizeMesh(*assimp_object_mesh, mesh.indices, acmr);
+		mesh.vertices = mesh_optimizer::remapVertices(reinterpret_cast<glm::vec3 const*>(assimp_object_mesh->mVertices), remap);
+		if (assimp_object_mesh->HasNormals())
+			mesh.normals = mesh_optimizer::remapVertices(reinterpret_cast<glm::vec3 const*>(assimp_object_mesh->mNormals), remap);
+
+		meshes.push_back(std::move(mesh));
+	}
+
+	LogInfo("Loaded the geometry of %zu meshes from \"%s\"", meshes.size(), filename.c_str());
+	return meshes;
+}
+
+bonobo::mesh_bounds
+bonobo::computeBounds(glm::vec3 const* vertices, std::size_t vertices_nb)
+{
+	mesh_bounds bounds;
+	if (vertices_nb == 0u)
+		return bounds;
+
+	bounds.min = vertices[0u];
+	bounds.max = vertices[0u];
+	for (std::size_t i = 1u; i < vertices_nb; ++i) {
+		bounds.min = glm::min(bounds.min, vertices[i]);
+		bounds.max = glm::max(bounds.max, vertices[i]);
+	}
+
+	bounds.centre = 0.5f * (bounds.min + bounds.max);
+	float squared_radius = 0.0f;
+	for (std::size_t i = 0u; i < vertices_nb; ++i) {
+		auto const offset = vertices[i] - bounds.centre;
+		squared_radius = std::max(squared_radius, glm::dot(offset, offset));
+	}
+	bounds.radius = std::sqrt(squared_radius);
+
+	return bounds;
+}
+
+bonobo::vertex_format
+bonobo::vertex_format::compact()
+{
+	vertex_format format;
+	format.interleaved = true;
+	format.half_texcoords = true;
+	format.packed_normals = true;
+	format.short_indices = true;
+	return format;
+}
+
+std::size_t
+bonobo::getIndexSize(GLenum index_type)
+{
+	return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
 GLuint
 bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint internal_format, GLenum format, GLenum type, GLvoid const* data)
 {
 	GLuint texture = 0u;
 	glGenTextures(1, &texture);
 	assert(texture != 0u);
-	glBindTexture(target, texture);
+	utils::opengl::state::bindTexture(target, texture);
 	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	switch (target) {
@@ -372,11 +973,12 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 		glTexImage2D(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, format, type, data);
 		break;
 	default:
+		utils::opengl::state::bindTexture(target, 0u);
 		glDeleteTextures(1, &texture);
 		LogError("Non-handled texture target: %08x.\n", target);
 		return 0u;
 	}
-	glBindTexture(target, 0u);
+	utils::opengl::state::bindTexture(target, 0u);
 
 	return texture;
 }
@@ -384,22 +986,56 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 GLuint
 bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
 {
-	std::uint32_t width, height;
-	auto const data = getTextureData(filename, width, height, true);
-	if (data.empty())
-		return 0u;
+	auto const image = getTextureData(filename, true);
 
-	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	if (generate_mipmap)
-		glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0u);
+	GLuint texture = 0u;
+	glGenTextures(1, &texture);
+	assert(texture != 0u);
+	uploadImage(texture, image, generate_mipmap);
 
 	return texture;
 }
 
+GLuint
+bonobo::loadTexture2DAsync(std::string const& filename, bool generate_mipmap, glm::vec4 const& placeholder)
+{
+	auto const texture = createPlaceholderTexture(placeholder);
+	pending_textures.push_back({ texture, generate_mipmap, filename,
+	                             getJobSystem().submit([filename](){ return decodeImage(filename, true); }) });
+	return texture;
+}
+
+std::size_t
+bonobo::uploadLoadedTextures(bool wait)
+{
+	auto pending = pending_textures.begin();
+	while (pending != pending_textures.end()) {
+		if (!wait && pending->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++pending;
+			continue;
+		}
+
+		auto const image = pending->image.get();
+		if (image.texels == nullptr)
+			LogWarning("Couldn't load or decode image file %s; keeping its placeholder.", pending->filename.c_str());
+		else
+			uploadImage(pending->texture, image, pending->generate_mipmap);
+		pending = pending_textures.erase(pending);
+	}
+
+	return pending_textures.size();
+}
+
+void
+bonobo::deleteTexture(GLuint texture)
+{
+	// Whatever is still being decoded for it is dropped once done.
+	pending_textures.erase(std::remove_if(pending_textures.begin(), pending_textures.end(),
+	                                      [texture](PendingTexture const& pending){ return pending.texture == texture; }),
+	                       pending_textures.end());
+	glDeleteTextures(1, &texture);
+}
+
 GLuint
 bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
                            std::string const& posy, std::string const& negy,
@@ -419,7 +1055,7 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	// GL_TEXTURE_CUBE_MAP target to indicate we want a cube map. If you
 	// look at `bonobo::loadTexture2D()` just above, you will see that
 	// GL_TEXTURE_2D is used there, as we want a simple 2D-texture.
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	utils::opengl::state::bindTexture(GL_TEXTURE_CUBE_MAP, texture);
 
 	// Set the wrapping properties of the texture; you can have a look on
 	// http://docs.gl to learn more about them
@@ -435,14 +1071,8 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 
 	// We need to fill in the cube map using the images passed in as
 	// argument. The function `getTextureData()` uses stb to read in the
-	// image files and return a `std::vector<std::uint8_t>` containing all the
-	// texels.
-	std::uint32_t width, height;
-	auto data = getTextureData(negx, width, height, false);
-	if (data.empty()) {
-		glDeleteTextures(1, &texture);
-		return 0u;
-	}
+	// image files and return a `DecodedImage` holding all the texels.
+	auto const image = getTextureData(negx, false);
 	// With all the texels available on the CPU, we now want to push them
 	// to the GPU: this is done using `glTexImage2D()` (among others). You
 	// might have thought that the target used here would be the same as
@@ -455,12 +1085,12 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
 	             /* mipmap level, you'll see that in EDAN35 */0,
 	             /* how are the components internally stored */GL_RGBA,
-	             /* the width of the cube map's face */static_cast<GLsizei>(width),
-	             /* the height of the cube map's face */static_cast<GLsizei>(height),
+	             /* the width of the cube map's face */static_cast<GLsizei>(image.width),
+	             /* the height of the cube map's face */static_cast<GLsizei>(image.height),
 	             /* must always be 0 */0,
 	             /* the format of the pixel data: which components are available */GL_RGBA,
 	             /* the type of each component */GL_UNSIGNED_BYTE,
-	             /* the pointer to the actual data on the CPU */reinterpret_cast<GLvoid const*>(data.data()));
+	             /* the pointer to the actual data on the CPU */reinterpret_cast<GLvoid const*>(image.texels.get()));
 
 	//! \todo repeat now the texture filling for the 5 remaining faces
 
@@ -469,7 +1099,7 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 		// what it does
 		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+	utils::opengl::state::bindTexture(GL_TEXTURE_CUBE_MAP, 0u);
 
 	return texture;
 }
@@ -490,6 +1120,7 @@ bonobo::createProgram(std::string const& vert_shader_source_path, std::string co
 	GLuint program = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader });
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
+	ShaderProgramManager::RegisterProgram(program);
 	return program;
 }
 
@@ -506,20 +1137,18 @@ bonobo::displayTexture(glm::vec2 const& lower_left, glm::vec2 const& upper_right
 	                         - viewport_origin;
 
 	glViewport(viewport_origin.x, viewport_origin.y, viewport_size.x, viewport_size.y);
-	glUseProgram(local::fullscreen_shader);
-	glBindVertexArray(local::display_vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glBindSampler(0, sampler);
+	utils::opengl::state::useProgram(local::fullscreen_shader);
+	utils::opengl::state::bindVertexArray(local::display_vao);
+	utils::opengl::state::activeTexture(GL_TEXTURE0);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture);
+	utils::opengl::state::bindSampler(0, sampler);
 	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "tex"), 0);
 	glUniform4iv(glGetUniformLocation(local::fullscreen_shader, "swizzle"), 1, glm::value_ptr(swizzle));
 	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "linearise"), linearise);
 	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "near"), nearPlane);
 	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "far"), farPlane);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindSampler(0, 0u);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glUseProgram(0);
+	utils::opengl::state::bindSampler(0, 0u);
 }
 
 GLuint
@@ -535,12 +1164,12 @@ bonobo::createFBO(std::vector<GLuint> const& color_attachments, GLuint depth_att
 	GLuint fbo = 0u;
 	glGenFramebuffers(1, &fbo);
 	assert(fbo != 0u);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, fbo);
 	for (size_t i = 0; i < color_attachments.size(); ++i)
 		attach(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i), color_attachments[i]);
 	if (depth_attachment != 0u)
 		attach(GL_DEPTH_ATTACHMENT, depth_attachment);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	utils::opengl::state::bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	return fbo;
 }
@@ -558,9 +1187,8 @@ bonobo::createSampler(std::function<void (GLuint)> const& setup)
 void
 bonobo::drawFullscreen()
 {
-	glBindVertexArray(local::display_vao);
+	utils::opengl::state::bindVertexArray(local::display_vao);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindVertexArray(0u);
 }
 
 GLuint
@@ -569,21 +1197,35 @@ bonobo::getDebugTextureID()
 	return debug_texture_id;
 }
 
+UniformRing&
+bonobo::getUniformRing()
+{
+	if (uniform_ring == nullptr)
+		uniform_ring = std::make_unique<UniformRing>();
+	return *uniform_ring;
+}
+
+JobSystem&
+bonobo::getJobSystem()
+{
+	if (job_system == nullptr)
+		job_system = std::make_unique<JobSystem>();
+	return *job_system;
+}
+
 void
 bonobo::renderBasis(float thickness_scale, float length_scale, glm::mat4 const& view_projection, glm::mat4 const& world)
 {
 	if (basis.shader == 0u)
 		return;
 
-	glUseProgram(basis.shader);
-	glBindVertexArray(basis.vao);
+	utils::opengl::state::useProgram(basis.shader);
+	utils::opengl::state::bindVertexArray(basis.vao);
 	glUniformMatrix4fv(basis.shader_locations.world, 1, GL_FALSE, glm::value_ptr(world));
 	glUniformMatrix4fv(basis.shader_locations.view_proj, 1, GL_FALSE, glm::value_ptr(view_projection));
 	glUniform1f(basis.shader_locations.thickness_scale, thickness_scale);
 	glUniform1f(basis.shader_locations.length_scale, length_scale);
 	glDrawElementsInstanced(GL_TRIANGLES, basis.index_count, GL_UNSIGNED_INT, nullptr, 3);
-	glBindVertexArray(0u);
-	glUseProgram(0u);
 }
 
 bool
@@ -648,7 +1290,7 @@ namespace
 	{
 		glGenVertexArrays(1, &basis.vao);
 		assert(basis.vao != 0);
-		glBindVertexArray(basis.vao);
+		utils::opengl::state::bindVertexArray(basis.vao);
 
 		glGenBuffers(1, &basis.vbo);
 		assert(basis.vbo != 0);
@@ -711,7 +1353,7 @@ namespace
 
 		basis.index_count = static_cast<GLsizei>(indices.size() * 3);
 
-		glBindVertexArray(0u);
+		utils::opengl::state::bindVertexArray(0u);
 		glBindBuffer(GL_ARRAY_BUFFER, 0U);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0U);
 
@@ -749,12 +1391,242 @@ namespace
 		std::array<std::uint32_t, debug_texture_width* debug_texture_height> debug_texture_content;
 		debug_texture_content.fill(0xFFE935DAu);
 		glGenTextures(1, &debug_texture_id);
-		glBindTexture(GL_TEXTURE_2D, debug_texture_id);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, debug_texture_id);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, debug_texture_width, debug_texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, debug_texture_content.data());
-		glBindTexture(GL_TEXTURE_2D, 0u);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
 
 		utils::opengl::debug::nameObject(GL_TEXTURE, debug_texture_id, "Debug texture");
 	}
+
+	DecodedImage decodeImage(std::string const& filename, bool flip)
+	{
+		DecodedImage image;
+		int width = 0, height = 0;
+		stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+		image.texels.reset(stbi_load(filename.c_str(), &width, &height, nullptr, 4));
+		if (image.texels != nullptr) {
+			image.width = static_cast<std::uint32_t>(width);
+			image.height = static_cast<std::uint32_t>(height);
+		}
+		return image;
+	}
+
+	GLuint createPlaceholderTexture(glm::vec4 const& colour)
+	{
+		auto const scaled_colour = glm::clamp(colour, 0.0f, 1.0f) * 255.0f + 0.5f;
+		std::array<std::uint8_t, 4> const texel = {{
+			static_cast<std::uint8_t>(scaled_colour.r), static_cast<std::uint8_t>(scaled_colour.g),
+			static_cast<std::uint8_t>(scaled_colour.b), static_cast<std::uint8_t>(scaled_colour.a)
+		}};
+
+		// A single texel is also a complete mipmap hierarchy.
+		auto const texture = bonobo::createTexture(1u, 1u, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, texel.data());
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
+		return texture;
+	}
+
+	void uploadImage(GLuint texture, DecodedImage const& image, bool generate_mipmap)
+	{
+		auto const size = static_cast<GLsizeiptr>(image.width) * static_cast<GLsizeiptr>(image.height) * 4;
+
+		// The texels go through a pixel buffer object, so that the driver
+		// can copy them to the texture asynchronously; its previous
+		// content is orphaned rather than waited on.
+		GLvoid const* texels = nullptr; // offset in the pixel buffer object
+		void* mapping = nullptr;
+		if (pixel_unpack_buffer != 0u) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_unpack_buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (mapping != nullptr) {
+				std::memcpy(mapping, image.texels.get(), static_cast<std::size_t>(size));
+				if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+					mapping = nullptr;
+			}
+		}
+		if (mapping == nullptr) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+			texels = image.texels.get();
+		}
+
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(image.width), static_cast<GLsizei>(image.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (generate_mipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	}
+	MipmappedImage buildMipmaps(DecodedImage const& image)
+	{
+		MipmappedImage mipmapped;
+		mipmapped.width = image.width;
+		mipmapped.height = image.height;
+		mipmapped.levels_nb = 1u;
+		auto width = static_cast<std::size_t>(image.width);
+		auto height = static_cast<std::size_t>(image.height);
+		mipmapped.texels.assign(image.texels.get(), image.texels.get() + width * height * 4u);
+
+		// Each level averages 2×2 texels of the previous one, like
+		// `glGenerateMipmap()` does; the last row or column of odd-sized
+		// levels is clamped to.
+		std::size_t level_offset = 0u;
+		while (width > 1u || height > 1u) {
+			auto const next_width = std::max<std::size_t>(width / 2u, 1u);
+			auto const next_height = std::max<std::size_t>(height / 2u, 1u);
+			auto const next_level_offset = level_offset + width * height * 4u;
+			mipmapped.texels.resize(next_level_offset + next_width * next_height * 4u);
+			auto const level = mipmapped.texels.data() + level_offset;
+			auto const next_level = mipmapped.texels.data() + next_level_offset;
+			for (std::size_t y = 0u; y < next_height; ++y) {
+				auto const row0 = std::min(2u * y, height - 1u) * width;
+				auto const row1 = std::min(2u * y + 1u, height - 1u) * width;
+				for (std::size_t x = 0u; x < next_width; ++x) {
+					auto const column0 = std::min(2u * x, width - 1u);
+					auto const column1 = std::min(2u * x + 1u, width - 1u);
+					for (std::size_t c = 0u; c < 4u; ++c) {
+						auto const sum = level[(row0 + column0) * 4u + c] + level[(row0 + column1) * 4u + c]
+						               + level[(row1 + column0) * 4u + c] + level[(row1 + column1) * 4u + c];
+						next_level[(y * next_width + x) * 4u + c] = static_cast<unsigned char>((sum + 2u) / 4u);
+					}
+				}
+			}
+			level_offset = next_level_offset;
+			width = next_width;
+			height = next_height;
+			++mipmapped.levels_nb;
+		}
+
+		return mipmapped;
+	}
+
+	void uploadCookedTexture(GLuint texture, ScenePack::Texture const& cooked)
+	{
+		// The levels are read straight from the mapping of the pack.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture);
+		auto texels = cooked.texels;
+		auto width = cooked.width;
+		auto height = cooked.height;
+		for (std::uint32_t level = 0u; level < cooked.levels_nb; ++level) {
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+			texels += static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4u;
+			width = std::max(width / 2u, 1u);
+			height = std::max(height / 2u, 1u);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(cooked.levels_nb) - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, cooked.levels_nb > 1u ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
+	}
+	VertexLayout createVertexLayout(bonobo::vertex_format const& format, bool has_normals, bool has_texcoords, bool has_tangents, GLsizei vertices_nb)
+	{
+		VertexLayout layout;
+		layout.interleaved = format.interleaved;
+		layout.vertices_nb = static_cast<std::size_t>(vertices_nb);
+
+		auto const add = [&layout](bonobo::shader_bindings binding, GLint components_nb, GLenum type, GLboolean normalized, std::size_t size){
+			auto const offset = layout.interleaved ? layout.vertex_size : layout.vertex_size * layout.vertices_nb;
+			layout.attributes.push_back({ binding, components_nb, type, normalized, size, offset });
+			layout.vertex_size += size;
+		};
+		add(bonobo::shader_bindings::vertices, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+		if (has_normals) {
+			if (format.packed_normals)
+				add(bonobo::shader_bindings::normals, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(std::uint32_t));
+			else
+				add(bonobo::shader_bindings::normals, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+		}
+		if (has_texcoords) {
+			if (format.half_texcoords)
+				add(bonobo::shader_bindings::texcoords, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(std::uint32_t));
+			else
+				add(bonobo::shader_bindings::texcoords, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+		}
+		if (has_tangents) {
+			if (format.packed_normals) {
+				add(bonobo::shader_bindings::tangents, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(std::uint32_t));
+			} else {
+				add(bonobo::shader_bindings::tangents, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+				add(bonobo::shader_bindings::binormals, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+			}
+		}
+		return layout;
+	}
+
+	void writeVertices(VertexLayout const& layout, ScenePack::Mesh const& mesh, std::size_t first_vertex, unsigned char* vertices)
+	{
+		auto const get = [](glm::vec3 const* values, std::size_t i){
+			return values != nullptr ? values[i] : glm::vec3(0.0f);
+		};
+		for (auto const& attribute : layout.attributes) {
+			bool const is_packed = attribute.type == GL_INT_2_10_10_10_REV || attribute.type == GL_HALF_FLOAT;
+			for (std::size_t i = 0u; i < mesh.vertices_nb; ++i) {
+				auto const destination = vertices + layout.address(attribute, first_vertex + i);
+				glm::vec3 value(0.0f);
+				std::uint32_t packed = 0u;
+				switch (attribute.binding) {
+				case bonobo::shader_bindings::vertices:
+					value = mesh.vertices[i];
+					break;
+				case bonobo::shader_bindings::normals:
+					value = get(mesh.normals, i);
+					if (is_packed)
+						packed = glm::packSnorm3x10_1x2(glm::vec4(value, 0.0f));
+					break;
+				case bonobo::shader_bindings::texcoords:
+					value = get(mesh.texcoords, i);
+					if (is_packed)
+						packed = glm::packHalf2x16(glm::vec2(value));
+					break;
+				case bonobo::shader_bindings::tangents:
+					value = get(mesh.tangents, i);
+					if (is_packed) {
+						// Only the handedness of the tangent frame is kept
+						// from the binormal.
+						auto const handedness = glm::dot(glm::cross(get(mesh.normals, i), value), get(mesh.binormals, i)) < 0.0f ? -1.0f : 1.0f;
+						packed = glm::packSnorm3x10_1x2(glm::vec4(value, handedness));
+					}
+					break;
+				case bonobo::shader_bindings::binormals:
+					value = get(mesh.binormals, i);
+					break;
+				default:
+					break;
+				}
+				if (is_packed)
+					std::memcpy(destination, &packed, sizeof(packed));
+				else
+					std::memcpy(destination, glm::value_ptr(value), sizeof(value));
+			}
+		}
+	}
+
+	void writeIndices(ScenePack::Mesh const& mesh, GLenum index_type, unsigned char* indices)
+	{
+		if (index_type == GL_UNSIGNED_SHORT) {
+			for (std::size_t i = 0u; i < mesh.indices_nb; ++i) {
+				auto const index = static_cast<GLushort>(mesh.indices[i]);
+				std::memcpy(indices + i * sizeof(GLushort), &index, sizeof(GLushort));
+			}
+		} else {
+			std::memcpy(indices, mesh.indices, static_cast<std::size_t>(mesh.indices_nb) * sizeof(GLuint));
+		}
+	}
+
+	void enableVertexAttributes(VertexLayout const& layout)
+	{
+		auto const stride = layout.interleaved ? static_cast<GLsizei>(layout.vertex_size) : 0;
+		for (auto const& attribute : layout.attributes) {
+			glEnableVertexAttribArray(static_cast<unsigned int>(attribute.binding));
+			glVertexAttribPointer(static_cast<unsigned int>(attribute.binding), attribute.components_nb, attribute.type,
+			                      attribute.normalized, stride, reinterpret_cast<GLvoid const*>(attribute.offset));
+		}
+	}
 }
@@ -6,11 +6,17 @@
 
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
 
+#include <cstddef>
 #include <functional>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
+class JobSystem;
+class UniformRing;
+
 //! \brief Namespace containing a few helpers for the LUGG computer graphics labs.
 namespace bonobo
 {
@@ -21,7 +27,16 @@ namespace bonobo
 		normals,       //!< = 1, value of the binding point for normals
 		texcoords,     //!< = 2, value of the binding point for texcoords
 		tangents,      //!< = 3, value of the binding point for tangents
-		binormals      //!< = 4, value of the binding point for binormals
+		binormals,     //!< = 4, value of the binding point for binormals
+		lightmap_texcoords //!< = 5, value of the binding point for lightmap texcoords
+	};
+
+	//! \brief Uniform buffer binding points of the blocks filled by
+	//!        `Node::render()`; high enough not to clash with the ones
+	//!        assignments use for their own blocks.
+	enum class uniform_block_bindings : unsigned int {
+		object_transforms = 14u, //!< = 14, `ObjectTransforms` block: model and view-projection matrices
+		material_constants       //!< = 15, `MaterialConstants` block: `material_data` in std140 layout
 	};
 
 	//! \brief Association of a sampler name used in GLSL to a
@@ -38,6 +53,14 @@ namespace bonobo
 		float opacity{ 1.0f };
 	};
 
+	//! \brief Volumes enclosing all vertices of a mesh, in model-space.
+	struct mesh_bounds {
+		glm::vec3 min{ 0.0f };                   //!< lowest corner of the axis-aligned bounding box
+		glm::vec3 max{ 0.0f };                   //!< highest corner of the axis-aligned bounding box
+		glm::vec3 centre{ 0.0f };                //!< centre of the bounding sphere
+		float radius{ 0.0f };                    //!< radius of the bounding sphere
+	};
+
 	//! \brief Contains the data for a mesh in OpenGL.
 	struct mesh_data {
 		GLuint vao{0u};                          //!< OpenGL name of the Vertex Array Object
@@ -45,12 +68,58 @@ namespace bonobo
 		GLuint ibo{0u};                          //!< OpenGL name of the Buffer Object for indices
 		GLsizei vertices_nb{0};                  //!< number of vertices stored in bo
 		GLsizei indices_nb{0};                   //!< number of indices stored in ibo
+		GLuint first_index{0u};                  //!< offset, in indices, of the first index of this mesh in ibo
+		GLint base_vertex{0};                    //!< offset, in vertices, of the first vertex of this mesh in bo
 		texture_bindings bindings{};             //!< texture bindings for this mesh
 		material_data material{};                //!< constant values for the material of this mesh
 		GLenum drawing_mode{GL_TRIANGLES};       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
+		GLenum index_type{GL_UNSIGNED_INT};      //!< type of the indices in ibo, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+		mesh_bounds bounds{};                    //!< model-space bounds of the vertices, for culling
 		std::string name{"un-named mesh"};       //!< Name of the mesh; used for debugging purposes.
 	};
 
+	//! \brief CPU-side copy of the geometry of a mesh, for tools that
+	//!        process a scene without uploading it to OpenGL.
+	struct mesh_geometry {
+		std::vector<glm::vec3> vertices;         //!< positions, one per vertex
+		std::vector<glm::vec3> normals;          //!< empty if the mesh has no normals
+		std::vector<GLuint> indices;             //!< vertices_per_face indices per face
+		GLuint vertices_per_face{3u};            //!< 1 for points, 2 for lines, 3 for triangles
+		std::string name{"un-named mesh"};       //!< Name of the mesh; used for debugging purposes.
+	};
+
+	//! \brief Layout of the vertex and index buffers created by
+	//!        `loadObjects()`.
+	//!
+	//! The default one stores positions, normals, texcoords, tangents and
+	//! binormals as separate blocks of float3, 60 bytes per vertex, with
+	//! 32-bit indices; `compact()` brings that down to 24 bytes, in a
+	//! single stream, and 16-bit indices where they fit.
+	struct vertex_format {
+		//! Store the attributes of each vertex next to each other, rather
+		//! than one block per attribute.
+		bool interleaved{ false };
+
+		//! Store texcoords as two half-floats rather than three floats;
+		//! they keep 11 significant bits, so texcoords far from the origin
+		//! lose precision.
+		bool half_texcoords{ false };
+
+		//! Store normals and tangents as GL_INT_2_10_10_10_REV, and drop
+		//! the binormals: the sign of the w component of the tangent tells
+		//! their direction, and shaders rebuild them as
+		//! `cross(normal, tangent.xyz) * sign(tangent.w)`.
+		bool packed_normals{ false };
+
+		//! Use 16-bit indices when all vertices can be addressed with them;
+		//! with shared buffers, that is when no mesh has more than 65536
+		//! vertices.
+		bool short_indices{ false };
+
+		//! \brief Format enabling all options above.
+		static vertex_format compact();
+	};
+
 	enum class cull_mode_t : unsigned int {
 		disabled = 0u,
 		back_faces,
@@ -71,10 +140,109 @@ namespace bonobo
 
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
+	//! If the file was cooked by `cookObjects()` and neither it nor its
+	//! images changed since, its pack is memory-mapped and uploaded from
+	//! instead, skipping Assimp and the image decoding altogether.
+	//!
+	//! Triangles and vertices are reordered by `mesh_optimizer` on the
+	//! way, or when cooking, so they do not come in the order of the file.
+	//!
 	//! @param [in] filename of the object/scene file to load.
+	//! @param [in] share_buffers whether all objects should be stored in
+	//!             a single vertex buffer and a single index buffer, with
+	//!             a single Vertex Array Object; each object then covers
+	//!             the range given by its `first_index` and `base_vertex`,
+	//!             so that objects can be drawn with the `*BaseVertex()`
+	//!             and multi-draw calls without changing any binding. The
+	//!             OpenGL objects must then only be deleted once.
+	//! @param [in] format layout of the vertex and index buffers; the
+	//!             shaders drawing the objects have to match it
 	//! @return a vector of filled in `mesh_data` structures, one per
 	//!         object found in the input file
-	std::vector<mesh_data> loadObjects(std::string const& filename);
+	std::vector<mesh_data> loadObjects(std::string const& filename,
+	                                   bool share_buffers = false,
+	                                   vertex_format const& format = vertex_format());
+
+	//! \brief Content of an object/scene file read by a job, waiting for
+	//!        its OpenGL objects to be created.
+	struct loaded_scene;
+
+	//! \brief Object/scene file being loaded in the background, see
+	//!        `loadObjectsAsync()`.
+	class pending_objects {
+	public:
+		//! \brief Return whether the file has been read, so that `get()`
+		//!        does not wait on it.
+		bool is_ready() const;
+
+		//! \brief Wait for the file to be read, then create the OpenGL
+		//!        objects of its meshes.
+		//!
+		//! Call it once, from the thread owning the OpenGL context. The
+		//! textures are bound to placeholders until they are decoded and
+		//! uploaded by `uploadLoadedTextures()`, like with
+		//! `loadTexture2DAsync()`.
+		//!
+		//! @return the same meshes as `loadObjects()`
+		std::vector<mesh_data> get();
+
+	private:
+		friend pending_objects loadObjectsAsync(std::string const& filename, bool share_buffers,
+		                                        vertex_format const& format);
+
+		std::future<std::shared_ptr<loaded_scene>> _scene;
+		bool _share_buffers{ false };
+		vertex_format _format;
+	};
+
+	//! \brief Start loading an object/scene file in the background.
+	//!
+	//! Parsing the file, building the index buffers and decoding the
+	//! textures run as jobs of `getJobSystem()`, while the caller carries
+	//! on creating its window resources; see `loadObjects()` for the
+	//! parameters.
+	pending_objects loadObjectsAsync(std::string const& filename,
+	                                 bool share_buffers = false,
+	                                 vertex_format const& format = vertex_format());
+
+	//! \brief Cook an object/scene file into the pack `loadObjects()`
+	//!        reads instead of it, see `ScenePack`.
+	//!
+	//! The pack is written next to the file; it holds the vertex and index
+	//! buffers, bounds and material constants of the objects, and the
+	//! complete mipmap hierarchies of their textures. No OpenGL context is
+	//! needed.
+	//!
+	//! @param [in] filename of the object/scene file to cook.
+	//! @return whether the pack was written
+	bool cookObjects(std::string const& filename);
+
+	//! \brief Load the geometry of an object/scene file into CPU memory,
+	//!        without creating any OpenGL objects or loading textures.
+	//!
+	//! The meshes come in the same order, and with the same vertex
+	//! numbering, as the ones returned by `loadObjects()` for the same
+	//! file, so per-vertex data computed from them can be attached to the
+	//! latter.
+	//!
+	//! @param [in] filename of the object/scene file to load.
+	//! @return a vector of filled in `mesh_geometry` structures, one per
+	//!         object found in the input file
+	std::vector<mesh_geometry> loadGeometry(std::string const& filename);
+
+	//! \brief Compute the bounding box and sphere of a set of vertices.
+	//!
+	//! The sphere is centred on the box, so it is not the smallest one,
+	//! but it is never larger than the sphere enclosing the box.
+	//!
+	//! @param [in] vertices positions to enclose
+	//! @param [in] vertices_nb number of positions in `vertices`
+	//! @return the bounds, all zeros if there are no vertices
+	mesh_bounds computeBounds(glm::vec3 const* vertices, std::size_t vertices_nb);
+
+	//! \brief Return the size in bytes of an index of type `index_type`,
+	//!        to turn the `first_index` of a `mesh_data` into an offset.
+	std::size_t getIndexSize(GLenum index_type);
 
 	//! \brief Creates an OpenGL texture without any content nor parameters.
 	//!
@@ -103,6 +271,41 @@ namespace bonobo
 	GLuint loadTexture2D(std::string const& filename,
 	                     bool generate_mipmap = true);
 
+	//! \brief Start loading an image into an OpenGL 2D-texture in the
+	//!        background.
+	//!
+	//! The texture is created right away with a single placeholder texel,
+	//! so it can be bound at once; the image is decoded by a job of
+	//! `getJobSystem()`, and uploaded through a pixel buffer object by the
+	//! next `uploadLoadedTextures()` after that.
+	//!
+	//! @param [in] filename of the image.
+	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @param [in] placeholder colour of the texture until it is loaded
+	//! @return the name of the OpenGL 2D-texture
+	GLuint loadTexture2DAsync(std::string const& filename,
+	                          bool generate_mipmap = true,
+	                          glm::vec4 const& placeholder = glm::vec4(1.0f));
+
+	//! \brief Upload the textures decoded since the last call, see
+	//!        `loadTexture2DAsync()`; `WindowManager::NewImGuiFrame()`
+	//!        calls it every frame.
+	//!
+	//! @param [in] wait whether to wait for all textures being decoded
+	//! @return the number of textures still being decoded
+	std::size_t uploadLoadedTextures(bool wait = false);
+
+	//! \brief Delete a texture, dropping its pending upload if it comes
+	//!        from `loadTexture2DAsync()` or `loadObjectsAsync()` and is
+	//!        still being decoded.
+	//!
+	//! Textures still being loaded must be deleted through this function
+	//! rather than `glDeleteTextures()`, otherwise their image would later
+	//! be uploaded to whatever texture reuses their name.
+	//!
+	//! @param [in] texture the name of the texture to delete
+	void deleteTexture(GLuint texture);
+
 	//! \brief Load six images into an OpenGL cubemap-texture.
 	//!
 	//! @param [in] posx path to the texture on the left of the cubemap
@@ -121,6 +324,10 @@ namespace bonobo
 	//! \brief Create an OpenGL program consisting of a vertex and a
 	//!        fragment shader.
 	//!
+	//! Its uniforms are reflected by
+	//! `ShaderProgramManager::RegisterProgram()`; call
+	//! `ShaderProgramManager::UnregisterProgram()` before deleting it.
+	//!
 	//! @param [in] vert_shader_source_path of the vertex shader source
 	//!             code, relative to the `shaders/` folder
 	//! @param [in] frag_shader_source_path of the fragment shader source
@@ -179,6 +386,14 @@ namespace bonobo
 	//! \brief Retrieve the ID of a small placeholder texture.
 	GLuint getDebugTextureID();
 
+	//! \brief Retrieve the ring buffer per-draw uniform blocks are written
+	//!        to; it is created by `init()` and released by `deinit()`.
+	UniformRing& getUniformRing();
+
+	//! \brief Retrieve the job system assets are loaded with; it is
+	//!        created by `init()` and released by `deinit()`.
+	JobSystem& getJobSystem();
+
 	//! \brief Render a right-hand orthonormal basis.
 	//!
 	//! @param [in] thickness_scale By how much to scale the thickness of the axes
@@ -1,12 +1,42 @@
 #include "node.hpp"
 #include "helpers.hpp"
 
+#include "core/GLStateCache.hpp"
 #include "core/Log.h"
 #include "core/opengl.hpp"
+#include "core/RenderQueue.hpp"
+#include "core/ShaderProgramManager.hpp"
+#include "core/UniformRing.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	// std140 mirrors of the blocks declared by the shaders.
+	struct ObjectTransforms {
+		glm::mat4 vertex_model_to_world;
+		glm::mat4 normal_model_to_world;
+		glm::mat4 vertex_world_to_clip;
+	};
+	static_assert(sizeof(ObjectTransforms) == 192, "ObjectTransforms does not match its std140 layout");
+
+	struct MaterialConstants {
+		glm::vec3 diffuse;
+		float shininess;
+		glm::vec3 specular;
+		float index_of_refraction;
+		glm::vec3 ambient;
+		float opacity;
+		glm::vec3 emissive;
+		float padding;
+	};
+	static_assert(sizeof(MaterialConstants) == 64, "MaterialConstants does not match its std140 layout");
+}
+
 void
 Node::render(glm::mat4 const& view_projection, glm::mat4 const& parent_transform) const
 {
@@ -22,52 +52,159 @@ Node::render(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint pr
 
 	utils::opengl::debug::beginDebugGroup(_name);
 
-	glUseProgram(program);
-
-	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+	utils::opengl::state::useProgram(program);
 
 	set_uniforms(program);
 
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(view_projection));
+	auto const& locations = get_uniform_locations(program);
 
 	for (size_t i = 0u; i < _textures.size(); ++i) {
 		auto const& texture = _textures[i];
-		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 1);
+		utils::opengl::state::activeTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+		utils::opengl::state::bindTexture(std::get<2>(texture), std::get<1>(texture));
+		glUniform1i(locations.textures[i].first, static_cast<GLint>(i));
+		glUniform1i(locations.textures[i].second, 1);
 	}
 
-	glUniform3fv(glGetUniformLocation(program, "diffuse_colour"), 1, glm::value_ptr(_constants.diffuse));
-	glUniform3fv(glGetUniformLocation(program, "specular_colour"), 1, glm::value_ptr(_constants.specular));
-	glUniform3fv(glGetUniformLocation(program, "ambient_colour"), 1, glm::value_ptr(_constants.ambient));
-	glUniform3fv(glGetUniformLocation(program, "emissive_colour"), 1, glm::value_ptr(_constants.emissive));
-	glUniform1f(glGetUniformLocation(program, "shininess_value"), _constants.shininess);
-	glUniform1f(glGetUniformLocation(program, "index_of_refraction_value"), _constants.indexOfRefraction);
-	glUniform1f(glGetUniformLocation(program, "opacity_value"), _constants.opacity);
+	auto const ranges = write_object_uniforms(locations, view_projection, world);
+	bonobo::getUniformRing().flush();
+	set_object_uniforms(locations, ranges, view_projection, world);
 
-	glBindVertexArray(_vao);
-	if (_has_indices)
-		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-	else
-		glDrawArrays(_drawing_mode, 0, _vertices_nb);
-	glBindVertexArray(0u);
+	utils::opengl::state::bindVertexArray(_vao);
+	draw_geometry();
+
+	// The bindings are left as they are, for the next draw to skip them
+	// if it uses the same; the texture flags are program state though,
+	// and would leak into the next node drawn with this program.
+	for (size_t i = 0u; i < _textures.size(); ++i)
+		glUniform1i(locations.textures[i].second, 0);
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+void
+Node::submit(RenderQueue& queue, glm::mat4 const& view_projection, glm::mat4 const& parent_transform, unsigned int pass) const
+{
+	if (_program != nullptr)
+		queue.submit(*this, view_projection, parent_transform * _transform.GetMatrix(), *_program, &_set_uniforms, pass);
+}
+
+GLsizeiptr
+Node::get_uniform_ring_size(UniformLocations const& locations) const
+{
+	auto const& ring = bonobo::getUniformRing();
+	GLsizeiptr size = 0;
+	if (locations.object_transforms_block != GL_INVALID_INDEX)
+		size += ring.get_aligned_size(sizeof(ObjectTransforms));
+	if (locations.material_constants_block != GL_INVALID_INDEX)
+		size += ring.get_aligned_size(sizeof(MaterialConstants));
+	return size;
+}
 
-	for (auto const& texture : _textures) {
-		glBindTexture(std::get<2>(texture), 0);
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), 0);
+Node::UniformRanges
+Node::write_object_uniforms(UniformLocations const& locations, glm::mat4 const& view_projection, glm::mat4 const& world) const
+{
+	UniformRanges ranges;
+	auto& ring = bonobo::getUniformRing();
+	ring.reserve(get_uniform_ring_size(locations));
 
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 0);
+	if (locations.object_transforms_block != GL_INVALID_INDEX) {
+		ObjectTransforms const transforms{ world, glm::transpose(glm::inverse(world)), view_projection };
+		ranges.object_transforms = ring.write(&transforms, sizeof(transforms));
+	}
+	if (locations.material_constants_block != GL_INVALID_INDEX) {
+		MaterialConstants const constants{ _constants.diffuse, _constants.shininess,
+		                                   _constants.specular, _constants.indexOfRefraction,
+		                                   _constants.ambient, _constants.opacity,
+		                                   _constants.emissive, 0.0f };
+		ranges.material_constants = ring.write(&constants, sizeof(constants));
 	}
 
-	glUseProgram(0u);
+	return ranges;
+}
 
-	utils::opengl::debug::endDebugGroup();
+void
+Node::set_object_uniforms(UniformLocations const& locations, UniformRanges const& ranges,
+                          glm::mat4 const& view_projection, glm::mat4 const& world) const
+{
+	auto const& ring = bonobo::getUniformRing();
+
+	if (locations.object_transforms_block != GL_INVALID_INDEX) {
+		if (ranges.object_transforms >= 0)
+			glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(bonobo::uniform_block_bindings::object_transforms),
+			                  ring.buffer(), ranges.object_transforms, sizeof(ObjectTransforms));
+	} else {
+		auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+		glUniformMatrix4fv(locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(world));
+		glUniformMatrix4fv(locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+		glUniformMatrix4fv(locations.vertex_world_to_clip, 1, GL_FALSE, glm::value_ptr(view_projection));
+	}
+
+	if (locations.material_constants_block != GL_INVALID_INDEX) {
+		if (ranges.material_constants >= 0)
+			glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(bonobo::uniform_block_bindings::material_constants),
+			                  ring.buffer(), ranges.material_constants, sizeof(MaterialConstants));
+	} else {
+		glUniform3fv(locations.diffuse_colour, 1, glm::value_ptr(_constants.diffuse));
+		glUniform3fv(locations.specular_colour, 1, glm::value_ptr(_constants.specular));
+		glUniform3fv(locations.ambient_colour, 1, glm::value_ptr(_constants.ambient));
+		glUniform3fv(locations.emissive_colour, 1, glm::value_ptr(_constants.emissive));
+		glUniform1f(locations.shininess_value, _constants.shininess);
+		glUniform1f(locations.index_of_refraction_value, _constants.indexOfRefraction);
+		glUniform1f(locations.opacity_value, _constants.opacity);
+	}
+}
+
+void
+Node::draw_geometry() const
+{
+	if (_has_indices)
+		glDrawElementsBaseVertex(_drawing_mode, _indices_nb, _index_type,
+		                         reinterpret_cast<GLvoid const*>(static_cast<std::uintptr_t>(_first_index) * bonobo::getIndexSize(_index_type)),
+		                         _base_vertex);
+	else
+		glDrawArrays(_drawing_mode, _base_vertex, _vertices_nb);
+}
+
+Node::UniformLocations const&
+Node::get_uniform_locations(GLuint program) const
+{
+	// Programs unknown to the managers could be relinked, or deleted and
+	// their name reused, without notice, so their entry is never trusted.
+	auto const uniforms = ShaderProgramManager::GetUniforms(program);
+	auto it = std::find_if(_uniform_locations.begin(), _uniform_locations.end(),
+	                       [program](UniformLocations const& entry){ return entry.program == program; });
+	if (it != _uniform_locations.end() && uniforms != nullptr && it->generation == uniforms->generation)
+		return *it;
+	if (it == _uniform_locations.end())
+		it = _uniform_locations.emplace(_uniform_locations.end());
+
+	auto const location = [program](std::string const& name){
+		return ShaderProgramManager::GetUniformLocation(program, name);
+	};
+	it->program = program;
+	it->generation = uniforms != nullptr ? uniforms->generation : 0u;
+	it->object_transforms_block = glGetUniformBlockIndex(program, "ObjectTransforms");
+	if (it->object_transforms_block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, it->object_transforms_block, static_cast<GLuint>(bonobo::uniform_block_bindings::object_transforms));
+	it->material_constants_block = glGetUniformBlockIndex(program, "MaterialConstants");
+	if (it->material_constants_block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, it->material_constants_block, static_cast<GLuint>(bonobo::uniform_block_bindings::material_constants));
+	it->vertex_model_to_world = location("vertex_model_to_world");
+	it->normal_model_to_world = location("normal_model_to_world");
+	it->vertex_world_to_clip = location("vertex_world_to_clip");
+	it->diffuse_colour = location("diffuse_colour");
+	it->specular_colour = location("specular_colour");
+	it->ambient_colour = location("ambient_colour");
+	it->emissive_colour = location("emissive_colour");
+	it->shininess_value = location("shininess_value");
+	it->index_of_refraction_value = location("index_of_refraction_value");
+	it->opacity_value = location("opacity_value");
+	it->textures.clear();
+	for (auto const& texture : _textures)
+		it->textures.emplace_back(location(std::get<0>(texture)), location("has_" + std::get<0>(texture)));
+
+	return *it;
 }
 
 void
@@ -76,7 +213,10 @@ Node::set_geometry(bonobo::mesh_data const& shape)
 	_vao = shape.vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_first_index = shape.first_index;
+	_base_vertex = shape.base_vertex;
 	_drawing_mode = shape.drawing_mode;
+	_index_type = shape.index_type;
 	_has_indices = shape.ibo != 0u;
 	_name = std::string("Render ") + shape.name;
 
@@ -145,6 +285,7 @@ Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 	}
 
 	_textures.emplace_back(name, tex_id, type);
+	_uniform_locations.clear();
 }
 
 void
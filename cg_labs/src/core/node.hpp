@@ -7,11 +7,15 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+class RenderQueue;
+
 //! \brief Represents a node of a scene graph
 class Node
 {
@@ -41,6 +45,23 @@ public:
 	            GLuint program,
 	            std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){}) const;
 
+	//! \brief Add a draw of this node to a render queue, instead of
+	//!        rendering it right away.
+	//!
+	//! Draws submitted to the same queue are sorted by program, textures
+	//! and geometry when the queue is executed, so that nodes sharing
+	//! state do not rebind it; see `RenderQueue`.
+	//!
+	//! @param [in] queue queue the draw is added to; this node has to
+	//!             outlive the queue's next `execute()`
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] parent_transform Matrix transforming from parent-space to
+	//!             world-space
+	//! @param [in] pass index of the pass to draw this node in, in [0, 15]
+	void submit(RenderQueue& queue, glm::mat4 const& view_projection,
+	            glm::mat4 const& parent_transform = glm::mat4(1.0f),
+	            unsigned int pass = 0u) const;
+
 	//! \brief Set the geometry of this node.
 	//!
 	//! It will overwrite any constants provided by an earlier call to
@@ -131,11 +152,66 @@ public:
 	TRSTransformf& get_transform();
 
 private:
+	friend class RenderQueue;
+
+	// Locations of the uniforms set by `render()` in one program, resolved
+	// on the first draw with that program and again once it is relinked;
+	// programs unknown to `ShaderProgramManager`, neither created by a
+	// manager nor registered, are resolved on every draw, as their
+	// relinks cannot be noticed.
+	// Programs declaring the `ObjectTransforms` and `MaterialConstants`
+	// blocks get those from the uniform ring instead of the plain uniforms.
+	struct UniformLocations {
+		GLuint program{ 0u };
+		std::uint64_t generation{ 0u };
+		GLuint object_transforms_block{ GL_INVALID_INDEX };
+		GLuint material_constants_block{ GL_INVALID_INDEX };
+		GLint vertex_model_to_world{ -1 };
+		GLint normal_model_to_world{ -1 };
+		GLint vertex_world_to_clip{ -1 };
+		GLint diffuse_colour{ -1 };
+		GLint specular_colour{ -1 };
+		GLint ambient_colour{ -1 };
+		GLint emissive_colour{ -1 };
+		GLint shininess_value{ -1 };
+		GLint index_of_refraction_value{ -1 };
+		GLint opacity_value{ -1 };
+		std::vector<std::pair<GLint, GLint>> textures; // sampler and "has_" flag, in the order of _textures
+	};
+	UniformLocations const& get_uniform_locations(GLuint program) const;
+
+	// Ranges of the uniform ring holding the blocks of a draw, -1 for the
+	// blocks the program does not declare.
+	struct UniformRanges {
+		GLintptr object_transforms{ -1 };
+		GLintptr material_constants{ -1 };
+	};
+
+	// Return how much of the uniform ring the blocks of a draw take.
+	GLsizeiptr get_uniform_ring_size(UniformLocations const& locations) const;
+
+	// Write the blocks of a draw into a single segment of the uniform
+	// ring; it has to be flushed before the draw is issued.
+	UniformRanges write_object_uniforms(UniformLocations const& locations,
+	                                    glm::mat4 const& view_projection, glm::mat4 const& world) const;
+
+	// Set the transforms and material constants of a draw, binding the
+	// ranges written by `write_object_uniforms()` or setting the plain
+	// uniforms; the program has to be in use.
+	void set_object_uniforms(UniformLocations const& locations, UniformRanges const& ranges,
+	                         glm::mat4 const& view_projection, glm::mat4 const& world) const;
+
+	// Issue the draw call; the vertex array has to be bound.
+	void draw_geometry() const;
+
 	// Geometry data
 	GLuint _vao{ 0u };
 	GLsizei _vertices_nb{ 0u };
 	GLsizei _indices_nb{ 0u };
+	GLuint _first_index{ 0u };
+	GLint _base_vertex{ 0 };
 	GLenum _drawing_mode{ GL_TRIANGLES };
+	GLenum _index_type{ GL_UNSIGNED_INT };
 	bool _has_indices{ false };
 
 	// Program data
@@ -146,6 +222,9 @@ private:
 	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
 	bonobo::material_data _constants;
 
+	// One entry per program this node was rendered with
+	mutable std::vector<UniformLocations> _uniform_locations;
+
 	// Transformation data
 	TRSTransformf _transform;
 
@@ -1,3 +1,4 @@
+#include "GLStateCache.hpp"
 #include "Log.h"
 #include "opengl.hpp"
 #include "various.hpp"
@@ -290,7 +291,7 @@ init(std::string const& vs_path, std::string const& fs_path, size_t width, size_
 
 	glGenVertexArrays(1, &vao_id);
 	assert(vao_id != 0u);
-	glBindVertexArray(vao_id);
+	utils::opengl::state::bindVertexArray(vao_id);
 
 	glGenBuffers(1, &vbo_id);
 	assert(vbo_id != 0u);
@@ -316,12 +317,12 @@ init(std::string const& vs_path, std::string const& fs_path, size_t width, size_
 	glVertexAttribPointer(static_cast<GLuint>(location), 2, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
 	glEnableVertexAttribArray(static_cast<GLuint>(location));
 
-	glUseProgram(program_id);
+	utils::opengl::state::useProgram(program_id);
 
-	glActiveTexture(GL_TEXTURE0);
+	utils::opengl::state::activeTexture(GL_TEXTURE0);
 	glGenTextures(1, &texture_id);
 	assert(texture_id != 0u);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	utils::opengl::state::bindTexture(GL_TEXTURE_2D, texture_id);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_FLOAT, nullptr);
@@ -335,7 +336,7 @@ deinit()
 	GLint param = 0;
 	glGetIntegerv(GL_TEXTURE_BINDING_2D, &param);
 	if (static_cast<GLuint>(param) == texture_id)
-		glBindTexture(GL_TEXTURE_2D, 0u);
+		utils::opengl::state::bindTexture(GL_TEXTURE_2D, 0u);
 	glDeleteTextures(1, &texture_id);
 	texture_id = 0u;
 
@@ -345,7 +346,7 @@ deinit()
 
 	glGetIntegerv(GL_CURRENT_PROGRAM, &param);
 	if (static_cast<GLuint>(param) == program_id)
-		glUseProgram(0u);
+		utils::opengl::state::useProgram(0u);
 	glDeleteProgram(program_id);
 	program_id = 0u;
 
@@ -357,7 +358,7 @@ deinit()
 
 	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &param);
 	if (static_cast<GLuint>(param) == vao_id)
-		glBindVertexArray(0u);
+		utils::opengl::state::bindVertexArray(0u);
 	glDeleteVertexArrays(1, &vao_id);
 	vao_id = 0u;
 }
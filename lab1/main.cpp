@@ -6,23 +6,31 @@
  *  Copyright (c) 2021 Michael Doggett
  */
 #define _USE_MATH_DEFINES
+#include <atomic>
 #include <cfloat>
+#include <chrono>
 #include <cmath>
 #include <ctime>
 #include <iostream>
 #include <random>
+#include <string>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
 #include "swCamera.h"
+#include "swEnvironmentMap.h"
+#include "swFilm.h"
+#include "swHeightfield.h"
 #include "swIntersection.h"
+#include "swMesh.h"
 #include "swMaterial.h"
+#include "swParallel.h"
+#include "swRasterizer.h"
 #include "swRay.h"
+#include "swRayBatch.h"
 #include "swScene.h"
 #include "swSphere.h"
+#include "swStats.h"
 #include "swVec3.h"
 
 using namespace sw;
@@ -36,9 +44,11 @@ inline float clamp(float x, float min, float max) {
 float uniform() {
     // Will be used to obtain a seed for the random number engine
     static std::random_device rd;
-    // Standard mersenne_twister_engine seeded with rd()
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    static const unsigned seed = rd();
+    // One mersenne_twister_engine per render thread, each on its own stream
+    static std::atomic<unsigned> streams(0);
+    thread_local std::mt19937 gen(seed + streams++);
+    thread_local std::uniform_real_distribution<float> dis(0.0f, 1.0f);
     return dis(gen);
 }
 
@@ -51,48 +61,287 @@ void writeColor(int index, Vec3 p, uint8_t *pixels) {
     }
 }
 
-Color traceRay(const Ray &r, Scene& scene, int depth) {
-    Color c, directColor, reflectedColor, refractedColor;
-    if (depth < 0) return c;
-    
-    Intersection hit, shadow;
-    if (!scene.intersect(r, hit)) return Color(0.0f, 0.0f, 0.0f); // Background color
-    
+int envSamples = 4;
+Vec3 lightPos(0.0f, 30.0f, -5.0f);
 
-    const Vec3 lightPos(0.0f, 30.0f, -5.0f);
+// Diffuse lighting from the environment map, importance sampled with its alias table.
+Color environmentLight(const Intersection &hit, Scene &scene) {
+    Color sum;
+    for (int s = 0; s < envSamples; ++s) {
+        float pdf;
+        const Vec3 wi = scene.environment.sample(uniform(), uniform(), uniform(), uniform(), pdf);
+        const float ndotL = hit.normal * wi;
+        if (ndotL <= 0.0f || pdf <= 0.0f) continue;
+
+        Intersection occluder;
+        const bool occluded = scene.intersect(Ray(hit.position, wi, 0.01f, FLT_MAX, hit.ray.time), occluder, true);
+        countRay(RayType::Shadow, occluded);
+        if (occluded) continue;
+        sum += (ndotL / pdf) * scene.environment.lookup(wi);
+    }
+    return mul(hit.material.color, sum) * (1.0f / (float(M_PI) * float(envSamples)));
+}
+
+Color shade(Intersection &hit, Scene &scene, int depth);
+
+Color traceRay(const Ray &r, Scene& scene, int depth, RayType type = RayType::Primary) {
+    if (depth < 0) return Color();
+
+    Intersection hit;
+    const bool found = scene.intersect(r, hit);
+    countRay(type, found);
+    if (!found) return scene.background(r.dir);
+    return shade(hit, scene, depth);
+}
+
+// Nearest hit of a camera ray whose primitive the rasterizer already found.
+bool findVisible(const Ray &r, const VisibilitySample &v, Scene &scene, Intersection &hit) {
+    bool found = false;
+    if (v.primitive != VisibilitySample::None) {
+        found = scene.getPrimitives()[v.primitive]->intersectElement(v.element, r, hit);
+        // Edge samples the exact test disagrees on are traced instead.
+        if (!found) found = scene.intersect(r, hit);
+    }
+    countRay(RayType::Primary, found);
+    return found;
+}
+
+Color traceVisible(const Ray &r, const VisibilitySample &v, Scene &scene, int depth) {
+    Intersection hit;
+    if (!findVisible(r, v, scene, hit)) return scene.background(r.dir);
+    return shade(hit, scene, depth);
+}
+
+// Point light as seen from the hit, given whether its shadow ray is blocked.
+Color pointLight(const Intersection &hit, bool occluded) {
     Vec3 lightDir = lightPos - hit.position;
     lightDir.normalize();
     float ndotL = clamp(hit.normal * lightDir, 0.0f , 1.0f);
-    
+    return occluded ? Color() : ndotL * hit.material.color;
+}
+
+// Point light unless shadowed, plus the environment light.
+Color directLight(Intersection &hit, Scene &scene) {
+    Intersection shadow;
     Ray shadowRay = hit.getShadowRay(lightPos);
-    
-
-    auto reflec = hit.material.reflectivity;
-    directColor = ndotL * hit.material.color;
-    
-    if (depth > 0 && hit.material.reflectivity > 0.0f) {
-        const Ray refr = hit.getReflectedRay();
-        reflectedColor = reflec * traceRay(refr, scene, depth - 1);
+    const bool occluded = scene.intersect(shadowRay, shadow, true);
+    countRay(RayType::Shadow, occluded);
+    Color directColor = pointLight(hit, occluded);
+
+    if (scene.environment.valid() && envSamples > 0)
+        directColor += environmentLight(hit, scene);
+    return directColor;
+}
+
+// Shading of a hit on a material of the given class (see MaterialTerm):
+// terms the class lacks are compiled out rather than tested per hit.
+template <unsigned Class> Color shadeKernel(Intersection &hit, Scene &scene, int depth) {
+    const float reflec = hit.material.reflectivity, trans = hit.material.transparency;
+    Color c;
+    if (Class & DirectTerm) c += (1.0f - reflec - trans) * directLight(hit, scene);
+    if ((Class & ReflectedTerm) && depth > 0)
+        c += reflec * traceRay(hit.getReflectedRay(), scene, depth - 1, RayType::Reflect);
+    if ((Class & RefractedTerm) && depth > 0)
+        c += trans * traceRay(hit.getRefractedRay(), scene, depth - 1, RayType::Refract);
+    return c;
+}
+
+typedef Color (*ShadeKernel)(Intersection &, Scene &, int);
+const ShadeKernel shadeKernels[NumMaterialClasses] = {shadeKernel<0>, shadeKernel<1>, shadeKernel<2>, shadeKernel<3>,
+                                                      shadeKernel<4>, shadeKernel<5>, shadeKernel<6>, shadeKernel<7>};
+
+Color shade(Intersection &hit, Scene &scene, int depth) {
+    return shadeKernels[hit.material.shadingClass()](hit, scene, depth);
+}
+
+enum class SecondaryRays { Recursive, Batched, Sorted };
+
+bool parseSecondaryMode(const std::string &name, SecondaryRays &mode) {
+    if (name == "recursive") {
+        mode = SecondaryRays::Recursive;
+    } else if (name == "batched") {
+        mode = SecondaryRays::Batched;
+    } else if (name == "sorted") {
+        mode = SecondaryRays::Sorted;
     } else {
-        reflectedColor = Color();
+        return false;
     }
-    
-    auto trans = hit.material.transparency;
-    if (depth > 0 && hit.material.transparency > 0.0f) {
-        const Ray refr = hit.getRefractedRay();
-        refractedColor = trans * traceRay(refr, scene, depth - 1);
-    } else {
-        refractedColor = Color();
+    return true;
+}
+
+// Where the color of a queued reflected or refracted ray goes.
+struct Bounce {
+    uint32_t sample;
+    float weight; // product of the reflectivities and transparencies on the way
+    RayType type;
+};
+
+// Shades the hits of one bounce of traceBatched. Hits are binned by material
+// class and each bin runs the kernel specialised for it: the shadow rays of
+// the bin are traced as one batch, and only the terms of the class are
+// computed and spawned, without testing the material of every hit.
+class BatchShader {
+  public:
+    BatchShader(Scene &s, std::vector<Color> &c) : scene(s), colors(c) {}
+
+    void add(const Intersection &hit, const Bounce &b) { bins[hit.material.shadingClass()].push_back(Pending{hit, b}); }
+    // Shades the hits added so far, whose reflected and refracted rays may
+    // bounce depth more times, and queues those rays in next.
+    void shade(int depth);
+
+  public:
+    RayBatch next;
+    std::vector<Bounce> nextBounces;
+
+  private:
+    struct Pending {
+        Intersection hit;
+        Bounce bounce;
+    };
+    template <unsigned Class> void shadeBin(std::vector<Pending> &bin, int depth);
+
+    Scene &scene;
+    std::vector<Color> &colors;
+    std::vector<Pending> bins[NumMaterialClasses];
+    std::vector<Ray> shadowRays;
+    std::vector<uint8_t> occluded;
+};
+
+template <unsigned Class> void BatchShader::shadeBin(std::vector<Pending> &bin, int depth) {
+    if (Class & DirectTerm) {
+        shadowRays.resize(bin.size());
+        occluded.resize(bin.size());
+        for (size_t i = 0; i < bin.size(); ++i) shadowRays[i] = bin[i].hit.getShadowRay(lightPos);
+        // Already on a render thread, so no workers of its own.
+        scene.occluded(shadowRays.data(), bin.size(), occluded.data(), RayOrder::Coherent, 1);
+
+        const bool environment = scene.environment.valid() && envSamples > 0;
+        for (size_t i = 0; i < bin.size(); ++i) {
+            Intersection &hit = bin[i].hit;
+            const Bounce &b = bin[i].bounce;
+            countRay(RayType::Shadow, occluded[i] != 0);
+            Color direct = pointLight(hit, occluded[i] != 0);
+            if (environment) direct += environmentLight(hit, scene);
+            const float weight = 1.0f - hit.material.reflectivity - hit.material.transparency;
+            colors[b.sample] += (b.weight * weight) * direct;
+        }
+    }
+    if ((Class & ReflectedTerm) && depth > 0) {
+        for (Pending &p : bin) {
+            next.push(p.hit.getReflectedRay(), static_cast<uint32_t>(nextBounces.size()));
+            nextBounces.push_back(Bounce{p.bounce.sample, p.bounce.weight * p.hit.material.reflectivity, RayType::Reflect});
+        }
+    }
+    if ((Class & RefractedTerm) && depth > 0) {
+        for (Pending &p : bin) {
+            next.push(p.hit.getRefractedRay(), static_cast<uint32_t>(nextBounces.size()));
+            nextBounces.push_back(Bounce{p.bounce.sample, p.bounce.weight * p.hit.material.transparency, RayType::Refract});
+        }
+    }
+    bin.clear();
+}
+
+void BatchShader::shade(int depth) {
+    typedef void (BatchShader::*BinKernel)(std::vector<Pending> &, int);
+    static const BinKernel kernels[NumMaterialClasses] = {
+        &BatchShader::shadeBin<0>, &BatchShader::shadeBin<1>, &BatchShader::shadeBin<2>, &BatchShader::shadeBin<3>,
+        &BatchShader::shadeBin<4>, &BatchShader::shadeBin<5>, &BatchShader::shadeBin<6>, &BatchShader::shadeBin<7>};
+    for (unsigned c = 0; c < NumMaterialClasses; ++c)
+        if (!bins[c].empty()) (this->*kernels[c])(bins[c], depth);
+}
+
+// Same result as tracing each camera ray with traceRay (or traceVisible when
+// visible is given), but breadth-first: the reflected and refracted rays of
+// all samples are collected and traced one bounce at a time as a batch,
+// reordered by direction octant and origin Morton code when sortRays is set.
+void traceBatched(const std::vector<Ray> &cameraRays, const VisibilitySample *visible, Scene &scene, int depth,
+                  bool sortRays, std::vector<Color> &colors) {
+    colors.assign(cameraRays.size(), Color());
+    BatchShader shader(scene, colors);
+    RayBatch batch;
+    std::vector<Bounce> bounces;
+
+    for (size_t k = 0; k < cameraRays.size(); ++k) {
+        Intersection hit;
+        bool found;
+        if (visible) {
+            found = findVisible(cameraRays[k], visible[k], scene, hit);
+        } else {
+            found = scene.intersect(cameraRays[k], hit);
+            countRay(RayType::Primary, found);
+        }
+        if (found)
+            shader.add(hit, Bounce{static_cast<uint32_t>(k), 1.0f, RayType::Primary});
+        else
+            colors[k] += scene.background(cameraRays[k].dir);
+    }
+    shader.shade(depth);
+
+    while (!shader.next.empty()) {
+        std::swap(batch, shader.next);
+        shader.next.clear();
+        bounces.swap(shader.nextBounces);
+        shader.nextBounces.clear();
+        --depth;
+        if (sortRays) batch.sort();
+        for (size_t k = 0; k < batch.size(); ++k) {
+            const Bounce b = bounces[batch.ids[k]];
+            Intersection hit;
+            const bool found = scene.intersect(batch.rays[k], hit);
+            countRay(b.type, found);
+            if (found)
+                shader.add(hit, b);
+            else
+                colors[b.sample] += b.weight * scene.background(batch.rays[k].dir);
+        }
+        shader.shade(depth);
     }
-    
-    if (scene.intersect(shadowRay, shadow))
-        directColor = Color();
-    
-    c = (1 - reflec - trans) * directColor + reflectedColor + refractedColor;
-    return c;
 }
 
-int main() {
+int main(int argc, char **argv) {
+    std::string envPath;
+    int terrainRes = 0;
+    std::string meshPath;
+    AcceleratorType accelType = AcceleratorType::BVH;
+    unsigned numThreads = hardwareThreads();
+    std::string statsName;
+    bool hybrid = false;
+    bool motion = false;
+    FilterType filterType = FilterType::Box;
+    SecondaryRays secondary = SecondaryRays::Recursive;
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        if (arg == "--env" && a + 1 < argc) {
+            envPath = argv[++a];
+        } else if (arg == "--env-samples" && a + 1 < argc) {
+            envSamples = std::stoi(argv[++a]);
+        } else if (arg == "--terrain" && a + 1 < argc) {
+            terrainRes = std::stoi(argv[++a]);
+        } else if (arg == "--mesh" && a + 1 < argc) {
+            meshPath = argv[++a];
+        } else if (arg == "--accel" && a + 1 < argc && parseAcceleratorType(argv[a + 1], accelType)) {
+            ++a;
+        } else if (arg == "--threads" && a + 1 < argc) {
+            numThreads = static_cast<unsigned>(std::max(std::stoi(argv[++a]), 1));
+        } else if (arg == "--stats" && a + 1 < argc) {
+            statsName = argv[++a];
+        } else if (arg == "--hybrid") {
+            hybrid = true;
+        } else if (arg == "--motion") {
+            motion = true;
+        } else if (arg == "--filter" && a + 1 < argc && parseFilterType(argv[a + 1], filterType)) {
+            ++a;
+        } else if (arg == "--secondary" && a + 1 < argc && parseSecondaryMode(argv[a + 1], secondary)) {
+            ++a;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--env map.hdr] [--env-samples n] [--terrain resolution] [--mesh file.swm]"
+                      << " [--accel list|bvh|qbvh4|qbvh8|grid|kdtree] [--threads n] [--stats name] [--hybrid] [--motion]"
+                      << " [--filter box|gaussian|mitchell|blackman-harris] [--secondary recursive|batched|sorted]\n";
+            return 1;
+        }
+    }
+
     const int imageWidth = 512;
     const int imageHeight = imageWidth;
     const int numChannels = 3;
@@ -108,11 +357,11 @@ int main() {
 
     // Setup scene
     Scene scene;
+    if (!envPath.empty() && !scene.environment.load(envPath)) return 1;
 
-    // Add three spheres with diffuse material
-    scene.push(Sphere(Vec3(-7.0f, 3.0f, -20.0f), 3.0f, greenDiffuse));
-    scene.push(Sphere(Vec3(0.0f, 3.0f, -20.0f), 3.0f, blueDiffuse));
-    scene.push(Sphere(Vec3(7.0f, 3.0f, -20.0f), 3.0f, redDiffuse));
+    // Camera placement for the Cornell box, the terrain moves it
+    Vec3 eye(0.0f, 10.0f, 30.0f);
+    Vec3 lookAt(0.0f, 10.0f, -5.0f);
 
     // Define vertices for Cornell box
     Vec3 vertices[] = {
@@ -128,84 +377,162 @@ int main() {
       Vec3(20.0f, 0.0f, 50.0f),   Vec3(20.0f, 0.0f, -50.0f),   Vec3(20.0f, 40.0f, -50.0f)   // Green wall 2
     };
 
-    // TODO: Uncomment to render floor triangles
-    scene.push(Triangle(&vertices[0], whiteDiffuse)); // Floor 1
-    scene.push(Triangle(&vertices[3], whiteDiffuse)); // Floor 2
+    if (!meshPath.empty()) {
+        // Mapped mesh file, framed from the front
+        Mesh mesh;
+        if (!mesh.open(meshPath, whiteDiffuse)) return 1;
+        std::cout << "Mapped " << mesh.triangleCount() << " triangles from " << meshPath << "\n";
+        const AABB box = mesh.bounds();
+        const float radius = 0.5f * std::sqrt(box.extent() * box.extent());
+        scene.push(std::move(mesh));
+
+        lookAt = box.centroid();
+        eye = lookAt + Vec3(0.0f, 0.3f * radius, 2.2f * radius);
+        lightPos = lookAt + Vec3(radius, 3.0f * radius, 2.0f * radius);
+    } else if (terrainRes > 1) {
+        // fBm terrain of the EDAN35 ray marching project, 2 km across
+        std::cout << "Generating " << terrainRes << "x" << terrainRes << " terrain... ";
+        Heightfield terrain(terrainRes, terrainRes, Vec3(-1000.0f, 0.0f, -1000.0f), 2000.0f / float(terrainRes - 1),
+                            greenDiffuse);
+        terrain.generateFbm();
+        scene.push(std::move(terrain));
+        std::cout << "Done\n";
+
+        lightPos = Vec3(1000.0f, 2000.0f, 500.0f);
+        eye = Vec3(0.0f, 150.0f, 0.0f);
+        lookAt = Vec3(0.0f, 60.0f, -400.0f);
+    } else {
+        // Add three spheres with diffuse material, rolling and bouncing while the shutter is open with --motion
+        const Vec3 roll = motion ? Vec3(4.0f, 0.0f, 0.0f) : Vec3(), bounce = motion ? Vec3(0.0f, 5.0f, 0.0f) : Vec3();
+        scene.push(Sphere(Vec3(-7.0f, 3.0f, -20.0f), Vec3(-7.0f, 3.0f, -20.0f) + bounce, 3.0f, greenDiffuse));
+        scene.push(Sphere(Vec3(0.0f, 3.0f, -20.0f), Vec3(0.0f, 3.0f, -20.0f) + roll, 3.0f, blueDiffuse));
+        scene.push(Sphere(Vec3(7.0f, 3.0f, -20.0f), 3.0f, redDiffuse));
 
-    // TODO: Uncomment to render Cornell box
-    scene.push(Triangle(&vertices[6], whiteDiffuse));  // Back wall 1
-    scene.push(Triangle(&vertices[9], whiteDiffuse));  // Back wall 2
-    scene.push(Triangle(&vertices[12], whiteDiffuse)); // Ceiling 1
-    scene.push(Triangle(&vertices[15], whiteDiffuse)); // Ceiling 2
-    scene.push(Triangle(&vertices[18], redDiffuse));   // Red wall 1
-    scene.push(Triangle(&vertices[21], redDiffuse));   // Red wall 2
-    scene.push(Triangle(&vertices[24], greenDiffuse)); // Green wall 1
-    scene.push(Triangle(&vertices[27], greenDiffuse)); // Green wall 2
+        // TODO: Uncomment to render floor triangles
+        scene.push(Triangle(&vertices[0], whiteDiffuse)); // Floor 1
+        scene.push(Triangle(&vertices[3], whiteDiffuse)); // Floor 2
 
-    // TODO: Uncomment to render reflective spheres
-    scene.push(Sphere(Vec3(7.0f, 3.0f, 0.0f), 3.0f, yellowReflective));
-    scene.push(Sphere(Vec3(9.0f, 10.0f, 0.0f), 3.0f, yellowReflective));
+        // TODO: Uncomment to render Cornell box
+        scene.push(Triangle(&vertices[6], whiteDiffuse));  // Back wall 1
+        scene.push(Triangle(&vertices[9], whiteDiffuse));  // Back wall 2
+        scene.push(Triangle(&vertices[12], whiteDiffuse)); // Ceiling 1
+        scene.push(Triangle(&vertices[15], whiteDiffuse)); // Ceiling 2
+        scene.push(Triangle(&vertices[18], redDiffuse));   // Red wall 1
+        scene.push(Triangle(&vertices[21], redDiffuse));   // Red wall 2
+        scene.push(Triangle(&vertices[24], greenDiffuse)); // Green wall 1
+        scene.push(Triangle(&vertices[27], greenDiffuse)); // Green wall 2
 
-    // TODO: Uncomment to render refractive spheres
-    scene.push(Sphere(Vec3(-7.0f, 3.0f, 0.0f), 3.0f, transparent));
-    scene.push(Sphere(Vec3(-9.0f, 10.0f, 0.0f), 3.0f, transparent));
+        // TODO: Uncomment to render reflective spheres
+        scene.push(Sphere(Vec3(7.0f, 3.0f, 0.0f), 3.0f, yellowReflective));
+        scene.push(Sphere(Vec3(9.0f, 10.0f, 0.0f), 3.0f, yellowReflective));
+
+        // TODO: Uncomment to render refractive spheres
+        scene.push(Sphere(Vec3(-7.0f, 3.0f, 0.0f), 3.0f, transparent));
+        scene.push(Sphere(Vec3(-9.0f, 10.0f, 0.0f), 3.0f, transparent));
+    }
+
+    std::cout << "Building " << acceleratorName(accelType) << " over " << scene.size() << " primitives... ";
+    auto buildStart = std::chrono::steady_clock::now();
+    scene.build(accelType);
+    const double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    std::cout << "Done in " << buildSeconds << "s, "
+              << scene.getAccelerator()->memoryUsage() / 1024 << " KiB\n";
 
     // Setup camera
-    Vec3 eye(0.0f, 10.0f, 30.0f);
-    Vec3 lookAt(0.0f, 10.0f, -5.0f);
     Vec3 up(0.0f, 1.0f, 0.0f);
     Camera camera(eye, lookAt, up, 52.0f, (float)imageWidth / (float)imageHeight);
     camera.setup(imageWidth, imageHeight);
 
-    // Ray trace pixels
+    // Ray trace pixels, one tile of tileSize x tileSize pixels at a time per thread
     int depth = 4;
-    std::cout << "Rendering... ";
-    clock_t start = clock();
+    std::cout << "Rendering with " << numThreads << " threads... ";
+    auto start = std::chrono::steady_clock::now();
 
     const int samples_per_side = 4;
     const int samples_per_pixel = samples_per_side * samples_per_side;
 
+    // Hybrid rendering rasterizes the primary visibility of all sub-samples
+    // first, only shading and secondary rays are traced.
+    Rasterizer rasterizer;
+    double rasterSeconds = 0.0;
+    if (hybrid) {
+        hybrid = rasterizer.render(scene.getPrimitives(), camera, samples_per_side, numThreads);
+        rasterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!hybrid) std::cerr << "Falling back to ray traced visibility\n";
+    }
+
+    // Samples are splatted into the film tile of the image tile being rendered
+    Film film(imageWidth, imageHeight, Filter(filterType), 16);
+
+    TileTimes tiles;
+    tiles.tileSize = film.tileSize;
+    tiles.columns = (imageWidth + tiles.tileSize - 1) / tiles.tileSize;
+    tiles.rows = (imageHeight + tiles.tileSize - 1) / tiles.tileSize;
+    tiles.seconds.assign(tiles.columns * tiles.rows, 0.0);
+    resetStats();
 
-    for (int j = 0; j < imageHeight; ++j) {
-        for (int i = 0; i < imageWidth; ++i) {
-
-            // Per Pixel Super Sampling
-            Color sum = Color(0.0f, 0.0f, 0.0f);
-            for (int m = 0; m < samples_per_side; ++m) {
-                float row_min = float(m)     / float(samples_per_side);
-                float row_max = float(m + 1) / float(samples_per_side);
-                for (int n = 0; n < samples_per_side; ++n) {
-                    
-                    float col_min = float(n)     / float(samples_per_side);
-                    float col_max = float(n + 1) / float(samples_per_side);
-                        
-                    // Get center of pixel coordinate
-                    //float cx = ((float)i) + 0.5f;
-                    //float cy = ((float)j) + 0.5f;
-                    
-                    const float rand_row = uniform();
-                    const float rand_col = uniform();
-                    
-                    const float x_offset = (1.0f - rand_col) * col_min + rand_col * col_max;
-                    const float y_offset = (1.0f - rand_row) * row_min + rand_row * row_max;
-                    
-                    const float cx = float(i) + x_offset;
-                    const float cy = float(j) + y_offset;
-
-                    // Get a ray and trace it
-                    const Ray ray      = camera.getRay(cx, cy);
-                    const Color sample = traceRay(ray, scene, depth);
-                    sum += sample;
+    parallelFor(0, tiles.columns * tiles.rows, [&](int tile) {
+        auto tileStart = std::chrono::steady_clock::now();
+        const int x0 = (tile % tiles.columns) * tiles.tileSize, y0 = (tile / tiles.columns) * tiles.tileSize;
+        const int x1 = std::min(x0 + tiles.tileSize, imageWidth), y1 = std::min(y0 + tiles.tileSize, imageHeight);
+        FilmTile &filmTile = film.tile(tile);
+        std::vector<float> positions;
+        std::vector<Ray> rays;
+        std::vector<VisibilitySample> visible;
+        for (int j = y0; j < y1; ++j) {
+            for (int i = x0; i < x1; ++i) {
 
+                // Per Pixel Super Sampling
+                for (int s = 0; hybrid && s < samples_per_pixel; ++s) {
+                    float x_offset, y_offset;
+                    rasterizer.samplePosition(i, j, s, x_offset, y_offset);
+                    const float cx = float(i) + x_offset, cy = float(j) + y_offset;
+                    positions.push_back(cx);
+                    positions.push_back(cy);
+                    rays.push_back(camera.getRay(cx, cy));
+                    visible.push_back(rasterizer.sample(i, j, s));
+                }
+                for (int m = 0; !hybrid && m < samples_per_side; ++m) {
+                    float row_min = float(m)     / float(samples_per_side);
+                    float row_max = float(m + 1) / float(samples_per_side);
+                    for (int n = 0; n < samples_per_side; ++n) {
+
+                        float col_min = float(n)     / float(samples_per_side);
+                        float col_max = float(n + 1) / float(samples_per_side);
+
+                        const float rand_row = uniform();
+                        const float rand_col = uniform();
+
+                        const float x_offset = (1.0f - rand_col) * col_min + rand_col * col_max;
+                        const float y_offset = (1.0f - rand_row) * row_min + rand_row * row_max;
+
+                        const float cx = float(i) + x_offset;
+                        const float cy = float(j) + y_offset;
+
+                        // Get a ray to trace, at a random time while the shutter is open
+                        positions.push_back(cx);
+                        positions.push_back(cy);
+                        rays.push_back(camera.getRay(cx, cy, motion ? uniform() : 0.0f));
+                    }
                 }
             }
-   
-            const float inv_scale = 1.0f / float(samples_per_pixel);
-            const Color pixel = sum * inv_scale;
-            
-            writeColor((j * imageWidth + i) * numChannels, pixel, pixels);
         }
-    }
+
+        std::vector<Color> colors(rays.size());
+        if (secondary == SecondaryRays::Recursive) {
+            for (size_t k = 0; k < rays.size(); ++k)
+                colors[k] = hybrid ? traceVisible(rays[k], visible[k], scene, depth) : traceRay(rays[k], scene, depth);
+        } else {
+            traceBatched(rays, hybrid ? visible.data() : nullptr, scene, depth, secondary == SecondaryRays::Sorted,
+                         colors);
+        }
+        for (size_t k = 0; k < rays.size(); ++k) filmTile.addSample(positions[2 * k], positions[2 * k + 1], colors[k]);
+        tiles.seconds[tile] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tileStart).count();
+    }, 1, numThreads);
+    film.resolve(numThreads);
+    for (int j = 0; j < imageHeight; ++j)
+        for (int i = 0; i < imageWidth; ++i) writeColor((j * imageWidth + i) * numChannels, film.pixel(i, j), pixels);
+    const double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     // Save image to file
     stbi_write_png("out.png", imageWidth, imageHeight, numChannels, pixels, imageWidth * numChannels);
@@ -214,5 +541,24 @@ int main() {
     delete[] pixels;
 
     std::cout << "Done\n";
-    std::cout << "Time: " << (float)(clock() - start) / CLOCKS_PER_SEC << " s" << std::endl;
+    if (hybrid) std::cout << "Rasterization: " << rasterSeconds << " s\n";
+    std::cout << "Time: " << renderSeconds << " s" << std::endl;
+
+    if (!statsName.empty()) {
+        StatsReport report;
+        report.width = imageWidth;
+        report.height = imageHeight;
+        report.samplesPerPixel = samples_per_pixel;
+        report.threads = static_cast<int>(numThreads);
+        report.accelerator = acceleratorName(accelType);
+        report.buildSeconds = buildSeconds;
+        report.renderSeconds = renderSeconds;
+        report.acceleratorBytes = scene.getAccelerator()->memoryUsage();
+        report.quality = scene.getAccelerator()->quality();
+        report.counters = collectStats();
+        report.tiles = tiles;
+        if (writeStatsJson(statsName + ".json", report) &&
+            writeTileHeatmap(statsName + ".png", tiles, imageWidth, imageHeight))
+            std::cout << "Wrote " << statsName << ".json and " << statsName << ".png\n";
+    }
 }
@@ -0,0 +1,84 @@
+// Converts the positions and faces of a Wavefront OBJ file into a .swm mesh
+// file with a prebuilt BVH, which raytracer --mesh maps without loading.
+// With --verify, checks the whole tree and every triangle of an existing
+// .swm file instead, which opening it for rendering does not.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "swMesh.h"
+
+using namespace sw;
+
+namespace {
+
+bool readObj(const std::string &path, std::vector<Vec3> &vertices, std::vector<uint32_t> &indices) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    std::vector<long> face;
+    for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        std::istringstream in(line);
+        std::string tag;
+        in >> tag;
+        if (tag == "v") {
+            float x, y, z;
+            in >> x >> y >> z;
+            vertices.push_back(Vec3(x, y, z));
+        } else if (tag == "f") {
+            // Only the position index of each v/vt/vn corner is used; polygons are fanned.
+            face.clear();
+            std::string corner;
+            while (in >> corner) {
+                long v = std::strtol(corner.c_str(), nullptr, 10);
+                v = v < 0 ? static_cast<long>(vertices.size()) + v : v - 1;
+                if (v < 0 || v >= static_cast<long>(vertices.size())) {
+                    std::cerr << path << ":" << lineNumber << ": invalid vertex " << corner << std::endl;
+                    return false;
+                }
+                face.push_back(v);
+            }
+            for (size_t k = 2; k < face.size(); ++k) {
+                indices.push_back(static_cast<uint32_t>(face[0]));
+                indices.push_back(static_cast<uint32_t>(face[k - 1]));
+                indices.push_back(static_cast<uint32_t>(face[k]));
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.obj output.swm\n"
+                  << "       " << argv[0] << " --verify file.swm\n";
+        return 1;
+    }
+    if (std::string(argv[1]) == "--verify") {
+        Mesh mesh;
+        if (!mesh.open(argv[2], Material(), true)) return 1;
+        std::cout << argv[2] << " is valid, with " << mesh.triangleCount() << " triangles\n";
+        return 0;
+    }
+
+    std::vector<Vec3> vertices;
+    std::vector<uint32_t> indices;
+    if (!readObj(argv[1], vertices, indices)) return 1;
+    std::cout << "Read " << vertices.size() << " vertices and " << indices.size() / 3 << " triangles\n";
+
+    auto start = std::chrono::steady_clock::now();
+    if (!writeMeshFile(argv[2], vertices, indices)) return 1;
+    std::cout << "Wrote " << argv[2] << " in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,555 @@
+// Ray tracing benchmark over fixed-seed scenes of 10 to 10^7 spheres,
+// triangle soups and meshes. For every scene and accelerator it measures the
+// build time, memory and the throughput of primary, shadow and incoherent
+// secondary rays, and writes the results as JSON so they can be compared
+// between commits. The sphere and triangle kernels are also timed on their
+// own at every SIMD width, and primary visibility is also rasterized.
+// Incoherent rays are traced a second time after sorting them by direction
+// and origin, and where the kernel lets us count them, the cache misses of
+// every ray kind are reported next to the throughput.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "swAccelerator.h"
+#include "swCamera.h"
+#include "swKernels.h"
+#include "swMemory.h"
+#include "swMesh.h"
+#include "swParallel.h"
+#include "swRasterizer.h"
+#include "swRayBatch.h"
+#include "swSphere.h"
+#include "swStats.h"
+#include "swTriangle.h"
+
+using namespace sw;
+
+namespace {
+
+enum class SceneKind { Spheres, Soup, Mesh };
+const SceneKind SceneKinds[] = {SceneKind::Spheres, SceneKind::Soup, SceneKind::Mesh};
+
+const char *sceneKindName(SceneKind kind) {
+    switch (kind) {
+    case SceneKind::Spheres: return "spheres";
+    case SceneKind::Soup: return "soup";
+    case SceneKind::Mesh: return "mesh";
+    }
+    return "unknown";
+}
+
+struct BenchScene {
+    std::vector<Vec3> vertices; // storage for the soup triangles
+    std::vector<std::shared_ptr<Primitive>> primitives;
+    size_t count{0};            // spheres or triangles
+    double prepareSeconds{0.0}; // building the mesh file, zero for the other kinds
+    size_t meshBytes{0};        // BVH nodes inside the mesh file
+    Vec3 eye, lookAt, lightPos;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Peak resident set size since the last reset. Linux can reset the peak
+// through clear_refs, elsewhere it is the peak of the whole process.
+void resetPeakMemory() {
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+size_t peakMemory() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+    return 0;
+#else
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Hardware cache misses of this process and the threads it starts while
+// counting, -1 where the counter cannot be opened (not Linux, no PMU in a
+// virtual machine, or perf_event_paranoid forbids it).
+class CacheMissCounter {
+  public:
+    CacheMissCounter() {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    ~CacheMissCounter() {
+#if defined(__linux__)
+        if (fd >= 0) close(fd);
+#endif
+    }
+    CacheMissCounter(const CacheMissCounter &) = delete;
+    CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+    long long stop() {
+#if defined(__linux__)
+        long long count = 0;
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+#else
+        return -1;
+#endif
+    }
+
+  private:
+    int fd{-1};
+};
+
+// All scenes fill about [-1, 1]^3 with primitives whose size shrinks as
+// their number grows, so every scale is seen from the same camera.
+void frame(BenchScene &scene, const Vec3 &eye) {
+    scene.eye = eye;
+    scene.lookAt = Vec3(0.0f, 0.0f, 0.0f);
+    scene.lightPos = Vec3(2.0f, 4.0f, 3.0f);
+}
+
+void makeSpheres(BenchScene &scene, size_t n) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> pos(-1.0f, 1.0f), size(0.5f, 1.0f);
+    const float radius = 0.5f / std::cbrt(static_cast<float>(n));
+    const Material m(Vec3(0.8f, 0.8f, 0.8f));
+    scene.primitives.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        scene.primitives.push_back(std::make_shared<Sphere>(Vec3(pos(rng), pos(rng), pos(rng)), radius * size(rng), m));
+    frame(scene, Vec3(0.0f, 0.5f, 3.0f));
+}
+
+// Independent, randomly oriented triangles.
+void makeSoup(BenchScene &scene, size_t n) {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> pos(-1.0f, 1.0f), offset(-1.0f, 1.0f);
+    const float size = 1.0f / std::cbrt(static_cast<float>(n));
+    const Material m(Vec3(0.8f, 0.8f, 0.8f));
+    scene.vertices.reserve(3 * n);
+    for (size_t i = 0; i < n; ++i) {
+        const Vec3 c(pos(rng), pos(rng), pos(rng));
+        for (int k = 0; k < 3; ++k)
+            scene.vertices.push_back(c + size * Vec3(offset(rng), offset(rng), offset(rng)));
+    }
+    scene.primitives.reserve(n);
+    for (size_t i = 0; i < n; ++i) scene.primitives.push_back(std::make_shared<Triangle>(&scene.vertices[3 * i], m));
+    frame(scene, Vec3(0.0f, 0.5f, 3.0f));
+}
+
+// Rolling terrain as one indexed mesh, written to a mesh file with its own
+// BVH and mapped back, the top-level accelerator only sees one primitive.
+bool makeMesh(BenchScene &scene, size_t n, const std::string &path) {
+    const int res = std::max(1, static_cast<int>(std::sqrt(n / 2.0)));
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+    std::vector<Vec3> vertices;
+    vertices.reserve(static_cast<size_t>(res + 1) * (res + 1));
+    const float cell = 2.0f / res;
+    for (int z = 0; z <= res; ++z)
+        for (int x = 0; x <= res; ++x) {
+            const float px = -1.0f + x * cell, pz = -1.0f + z * cell;
+            const float h = 0.3f * std::sin(4.0f * px) * std::cos(3.0f * pz) + jitter(rng) * cell;
+            vertices.push_back(Vec3(px, h, pz));
+        }
+    std::vector<uint32_t> indices;
+    indices.reserve(static_cast<size_t>(res) * res * 6);
+    for (int z = 0; z < res; ++z)
+        for (int x = 0; x < res; ++x) {
+            const uint32_t i00 = z * (res + 1) + x, i10 = i00 + 1, i01 = i00 + res + 1, i11 = i01 + 1;
+            const uint32_t quad[] = {i00, i11, i10, i00, i01, i11};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!writeMeshFile(path, vertices, indices)) return false;
+    scene.prepareSeconds = secondsSince(start);
+
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+    if (!mesh->open(path, Material(Vec3(0.8f, 0.8f, 0.8f)))) return false;
+    scene.count = mesh->triangleCount();
+    scene.meshBytes = mesh->nodeBytes();
+    scene.primitives.push_back(mesh);
+    frame(scene, Vec3(0.0f, 1.5f, 2.2f));
+    return true;
+}
+
+struct RayResult {
+    size_t rays{0}, hits{0};
+    double seconds{0.0};
+    long long cacheMisses{-1};
+    StatCounters counters;
+
+    double mraysPerSecond() const { return seconds > 0.0 ? rays * 1e-6 / seconds : 0.0; }
+};
+
+struct Result {
+    std::string scene, accelerator;
+    size_t primitives{0};
+    double buildSeconds{0.0};
+    size_t acceleratorBytes{0}, peakBytes{0};
+    RayResult primary, shadow, incoherent;
+    RayResult sorted;         // the incoherent rays again, sorted with a RayBatch first
+    double sortSeconds{0.0};  // building and sorting that batch, not part of sorted.seconds
+    RayResult raster; // the primary rays' visibility from the rasterizer, samples counted as rays
+};
+
+// Traces rays in parallel chunks and counts the hits.
+RayResult trace(const Accelerator &accel, const std::vector<Ray> &rays, bool any, std::vector<Intersection> *hits) {
+    RayResult result;
+    std::vector<char> hit(rays.size());
+    const int chunk = 256;
+    resetStats();
+    CacheMissCounter misses;
+    auto start = std::chrono::steady_clock::now();
+    parallelFor(0, static_cast<int>((rays.size() + chunk - 1) / chunk), [&](int c) {
+        Intersection isect;
+        const size_t end = std::min(rays.size(), static_cast<size_t>(c + 1) * chunk);
+        for (size_t i = static_cast<size_t>(c) * chunk; i < end; ++i) {
+            Intersection &target = hits ? (*hits)[i] : isect;
+            target = Intersection();
+            hit[i] = accel.intersect(rays[i], target, any);
+        }
+    });
+    result.seconds = secondsSince(start);
+    result.cacheMisses = misses.stop();
+    result.counters = collectStats();
+    result.rays = rays.size();
+    for (char h : hit) result.hits += h;
+    return result;
+}
+
+Result run(const BenchScene &scene, SceneKind kind, AcceleratorType type, int width, int height) {
+    Result result;
+    result.scene = sceneKindName(kind);
+    result.accelerator = acceleratorName(type);
+    result.primitives = scene.count;
+
+    std::unique_ptr<Accelerator> accel = createAccelerator(type);
+    auto start = std::chrono::steady_clock::now();
+    accel->build(scene.primitives);
+    result.buildSeconds = scene.prepareSeconds + secondsSince(start);
+    result.acceleratorBytes = accel->memoryUsage() + scene.meshBytes;
+
+    Camera camera(scene.eye, scene.lookAt, Vec3(0.0f, 1.0f, 0.0f), 52.0f, float(width) / float(height));
+    camera.setup(width, height);
+    std::vector<Ray> rays(static_cast<size_t>(width) * height);
+    for (int j = 0; j < height; ++j)
+        for (int i = 0; i < width; ++i) rays[static_cast<size_t>(j) * width + i] = camera.getRay(i + 0.5f, j + 0.5f);
+    std::vector<Intersection> hits(rays.size());
+    result.primary = trace(*accel, rays, false, &hits);
+
+    Rasterizer rasterizer;
+    start = std::chrono::steady_clock::now();
+    if (rasterizer.render(scene.primitives, camera, 1)) {
+        result.raster.seconds = secondsSince(start);
+        result.raster.rays = rasterizer.samples.size();
+        for (const VisibilitySample &v : rasterizer.samples) result.raster.hits += v.primitive != VisibilitySample::None;
+    }
+
+    // Secondary rays start at the primary hits: towards the light, and in
+    // uniformly random directions over the hemisphere of the normal.
+    std::vector<Ray> shadowRays, incoherentRays;
+    std::mt19937 rng(4);
+    std::normal_distribution<float> gauss;
+    const float eps = 1e-4f;
+    for (const Intersection &h : hits) {
+        if (h.hitT == FLT_MAX) continue;
+        shadowRays.push_back(Ray(h.position, scene.lightPos - h.position, eps, 1.0f - eps));
+        Vec3 d(gauss(rng), gauss(rng), gauss(rng));
+        if (d * h.normal < 0.0f) d = -d;
+        incoherentRays.push_back(Ray(h.position, d.normalize(), eps, FLT_MAX));
+    }
+    result.shadow = trace(*accel, shadowRays, true, nullptr);
+    result.incoherent = trace(*accel, incoherentRays, false, nullptr);
+
+    RayBatch batch;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < incoherentRays.size(); ++i) batch.push(incoherentRays[i], static_cast<uint32_t>(i));
+    batch.sort();
+    result.sortSeconds = secondsSince(start);
+    result.sorted = trace(*accel, batch.rays, false, nullptr);
+    result.peakBytes = peakMemory();
+    return result;
+}
+
+struct KernelResult {
+    std::string kernel;
+    int width{0};
+    size_t tests{0}, hits{0};
+    double seconds{0.0};
+
+    double mtestsPerSecond() const { return seconds > 0.0 ? tests * 1e-6 / seconds : 0.0; }
+};
+
+// Primitives packed Width to a block: a sphere center in a, or a triangle in a, b and c.
+template <int Width> struct KernelBlock {
+    Vec3xN<Width> a, b, c;
+};
+
+// One ray against a block of Width primitives per call, on one thread. The
+// hit count only depends on the primitives, so it has to match across widths.
+template <int Width>
+KernelResult benchKernel(bool spheres, const std::vector<Ray> &rays, const std::vector<Vec3> &points, float radius) {
+    const size_t stride = spheres ? 1 : 3;
+    const size_t count = points.size() / stride;
+    std::vector<KernelBlock<Width>, AlignedAllocator<KernelBlock<Width>>> blocks(count / Width);
+    for (size_t p = 0; p < blocks.size() * Width; ++p) {
+        KernelBlock<Width> &block = blocks[p / Width];
+        const int lane = static_cast<int>(p % Width);
+        block.a.set(lane, points[stride * p]);
+        if (!spheres) {
+            block.b.set(lane, points[stride * p + 1]);
+            block.c.set(lane, points[stride * p + 2]);
+        }
+    }
+
+    KernelResult result;
+    result.kernel = spheres ? "sphere" : "triangle";
+    result.width = Width;
+    const FloatN<Width> r(radius);
+    auto start = std::chrono::steady_clock::now();
+    for (const Ray &ray : rays) {
+        const Vec3xN<Width> orig(ray.orig), dir(ray.dir);
+        const FloatN<Width> minT(ray.minT), maxT(ray.maxT);
+        for (const KernelBlock<Width> &block : blocks) {
+            FloatN<Width> t;
+            Vec3xN<Width> n;
+            const MaskN<Width> hit = spheres ? intersectSphereN<Width>(orig, dir, minT, maxT, block.a, r, t)
+                                             : intersectTriangleN<Width>(orig, dir, minT, maxT, block.a, block.b,
+                                                                         block.c, t, n);
+            for (int i = 0; i < Width; ++i) result.hits += hit[i];
+        }
+    }
+    result.seconds = secondsSince(start);
+    result.tests = rays.size() * blocks.size() * Width;
+    return result;
+}
+
+const size_t KernelWidths = 4; // 1, 4, 8 and 16 lanes per kernel
+
+std::vector<KernelResult> benchKernels() {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> pos(-1.0f, 1.0f);
+    std::normal_distribution<float> gauss;
+    std::vector<Ray> rays(2048);
+    for (Ray &ray : rays) {
+        const Vec3 target(pos(rng), pos(rng), pos(rng));
+        Vec3 orig(gauss(rng), gauss(rng), gauss(rng));
+        orig = 3.0f * orig.normalize();
+        Vec3 dir = target - orig;
+        ray = Ray(orig, dir.normalize());
+    }
+    const size_t count = 1024; // a multiple of every width
+    std::vector<Vec3> centers(count), vertices;
+    for (Vec3 &c : centers) c = Vec3(pos(rng), pos(rng), pos(rng));
+    vertices.reserve(3 * count);
+    for (const Vec3 &c : centers)
+        for (int k = 0; k < 3; ++k) vertices.push_back(c + 0.2f * Vec3(pos(rng), pos(rng), pos(rng)));
+
+    std::vector<KernelResult> results;
+    for (int kernel = 0; kernel < 2; ++kernel) {
+        const bool spheres = kernel == 0;
+        const std::vector<Vec3> &points = spheres ? centers : vertices;
+        results.push_back(benchKernel<1>(spheres, rays, points, 0.1f));
+        results.push_back(benchKernel<4>(spheres, rays, points, 0.1f));
+        results.push_back(benchKernel<8>(spheres, rays, points, 0.1f));
+        results.push_back(benchKernel<16>(spheres, rays, points, 0.1f));
+    }
+    return results;
+}
+
+void writeRays(std::ostream &out, const char *name, const RayResult &r) {
+    const double n = r.rays > 0 ? double(r.rays) : 1.0;
+    out << "\"" << name << "\": {\"rays\": " << r.rays << ", \"hits\": " << r.hits << ", \"seconds\": " << r.seconds
+        << ", \"mraysPerSecond\": " << r.mraysPerSecond();
+    if (r.cacheMisses >= 0) out << ", \"cacheMisses\": " << r.cacheMisses << ", \"cacheMissesPerRay\": " << r.cacheMisses / n;
+    if (SW_STATS)
+        out << ", \"nodeVisitsPerRay\": " << r.counters.nodeVisits / n
+            << ", \"primitiveTestsPerRay\": " << r.counters.primitiveTests / n;
+    out << "}";
+}
+
+bool writeJson(const std::string &path, const std::vector<KernelResult> &kernels, const std::vector<Result> &results,
+               int width, int height, unsigned threads) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not create " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"width\": " << width << ",\n  \"height\": " << height << ",\n  \"threads\": " << threads
+        << ",\n  \"kernels\": [\n";
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        const KernelResult &k = kernels[i];
+        out << "    {\"kernel\": \"" << k.kernel << "\", \"width\": " << k.width << ", \"tests\": " << k.tests
+            << ", \"hits\": " << k.hits << ", \"seconds\": " << k.seconds
+            << ", \"mtestsPerSecond\": " << k.mtestsPerSecond() << "}" << (i + 1 < kernels.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        out << "    {\"scene\": \"" << r.scene << "\", \"primitives\": " << r.primitives << ", \"accelerator\": \""
+            << r.accelerator << "\", \"buildSeconds\": " << r.buildSeconds
+            << ", \"acceleratorBytes\": " << r.acceleratorBytes << ", \"peakMemoryBytes\": " << r.peakBytes << ",\n     ";
+        writeRays(out, "primary", r.primary);
+        out << ",\n     ";
+        writeRays(out, "shadow", r.shadow);
+        out << ",\n     ";
+        writeRays(out, "incoherent", r.incoherent);
+        out << ",\n     ";
+        writeRays(out, "sorted", r.sorted);
+        out << ", \"sortSeconds\": " << r.sortSeconds << ",\n     ";
+        writeRays(out, "raster", r.raster);
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool parseList(const std::string &list, std::vector<AcceleratorType> &types) {
+    types.clear();
+    std::stringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        if (name == "all") {
+            types.assign(std::begin(AcceleratorTypes), std::end(AcceleratorTypes));
+            continue;
+        }
+        AcceleratorType type;
+        if (!parseAcceleratorType(name, type)) return false;
+        types.push_back(type);
+    }
+    return !types.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    size_t maxPrimitives = 10000000;
+    int width = 512, height = 512;
+    std::vector<AcceleratorType> types(1, AcceleratorType::BVH);
+    std::string jsonPath = "raytracer_bench.json";
+    std::string meshPath = "raytracer_bench.swm";
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        if (arg == "--max-primitives" && a + 1 < argc) {
+            maxPrimitives = std::strtoull(argv[++a], nullptr, 10);
+        } else if (arg == "--size" && a + 1 < argc) {
+            width = height = std::max(std::atoi(argv[++a]), 1);
+        } else if (arg == "--accel" && a + 1 < argc && parseList(argv[a + 1], types)) {
+            ++a;
+        } else if (arg == "--json" && a + 1 < argc) {
+            jsonPath = argv[++a];
+        } else if (arg == "--mesh-file" && a + 1 < argc) {
+            meshPath = argv[++a];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--max-primitives n] [--size pixels]"
+                      << " [--accel all|name[,name...]] [--json file] [--mesh-file scratch.swm]\n";
+            return 1;
+        }
+    }
+
+    std::printf("%-8s %5s %12s %9s\n", "kernel", "width", "Mtests/s", "hits");
+    const std::vector<KernelResult> kernels = benchKernels();
+    for (size_t i = 0; i < kernels.size(); ++i) {
+        const KernelResult &k = kernels[i];
+        std::printf("%-8s %5d %12.1f %9zu\n", k.kernel.c_str(), k.width, k.mtestsPerSecond(), k.hits);
+        if (k.hits != kernels[i - i % KernelWidths].hits)
+            std::cerr << "The " << k.kernel << " kernel disagrees with its scalar version at width " << k.width
+                      << std::endl;
+    }
+    std::printf("\n");
+
+    std::printf("%-8s %9s %-7s %10s %10s %10s %9s %9s %9s %9s %9s %11s\n", "scene", "prims", "accel", "build ms",
+                "accel MiB", "peak MiB", "primary", "shadow", "incoh.", "sorted", "raster", "miss ratio");
+    std::vector<Result> results;
+    for (size_t n = 10; n <= maxPrimitives; n *= 10) {
+        for (SceneKind kind : SceneKinds) {
+            for (AcceleratorType type : types) {
+                // Brute force is only bearable on small scenes.
+                if (type == AcceleratorType::List && n > 1000) continue;
+
+                resetPeakMemory();
+                BenchScene scene;
+                scene.count = n;
+                if (kind == SceneKind::Spheres)
+                    makeSpheres(scene, n);
+                else if (kind == SceneKind::Soup)
+                    makeSoup(scene, n);
+                else if (!makeMesh(scene, n, meshPath))
+                    return 1;
+
+                results.push_back(run(scene, kind, type, width, height));
+                const Result &r = results.back();
+                char missRatio[16] = "n/a";
+                if (r.incoherent.cacheMisses > 0 && r.sorted.cacheMisses >= 0)
+                    std::snprintf(missRatio, sizeof(missRatio), "%.3f",
+                                  double(r.sorted.cacheMisses) / double(r.incoherent.cacheMisses));
+                std::printf("%-8s %9zu %-7s %10.2f %10.1f %10.1f %9.2f %9.2f %9.2f %9.2f %9.2f %11s\n",
+                            r.scene.c_str(), r.primitives, r.accelerator.c_str(), 1e3 * r.buildSeconds,
+                            r.acceleratorBytes / 1048576.0, r.peakBytes / 1048576.0, r.primary.mraysPerSecond(),
+                            r.shadow.mraysPerSecond(), r.incoherent.mraysPerSecond(), r.sorted.mraysPerSecond(),
+                            r.raster.mraysPerSecond(), missRatio);
+                std::fflush(stdout);
+            }
+        }
+    }
+    std::remove(meshPath.c_str());
+
+    if (!writeJson(jsonPath, kernels, results, width, height, hardwareThreads())) return 1;
+    std::cout << "Mrays/s per ray kind, miss ratio is the sorted over the unsorted incoherent cache misses; results "
+                 "written to "
+              << jsonPath << "\n";
+    return 0;
+}
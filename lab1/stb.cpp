@@ -0,0 +1,8 @@
+// The stb implementations, compiled once for every target. Projects that
+// already compile stb_image themselves turn SWTRACER_STB_IMAGE off.
+#ifndef SW_NO_STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+
+#include "swRay.h"
+#include "swSimd.h"
+
+namespace sw {
+
+inline Vec3 minimum(const Vec3 &a, const Vec3 &b) {
+    return Vec3(std::min(a[0], b[0]), std::min(a[1], b[1]), std::min(a[2], b[2]));
+}
+
+inline Vec3 maximum(const Vec3 &a, const Vec3 &b) {
+    return Vec3(std::max(a[0], b[0]), std::max(a[1], b[1]), std::max(a[2], b[2]));
+}
+
+// Reciprocal of a ray direction, shared by all slab tests of one ray.
+inline Vec3 reciprocal(const Vec3 &d) { return Vec3(1.0f / d[0], 1.0f / d[1], 1.0f / d[2]); }
+
+class AABB {
+  public:
+    AABB() = default;
+    AABB(const Vec3 &lo, const Vec3 &hi) : lower(lo), upper(hi) {}
+
+    bool empty() const { return lower[0] > upper[0] || lower[1] > upper[1] || lower[2] > upper[2]; }
+    Vec3 centroid() const { return 0.5f * (lower + upper); }
+    Vec3 extent() const { return upper - lower; }
+
+    float surfaceArea() const {
+        if (empty()) return 0.0f;
+        Vec3 e = extent();
+        return 2.0f * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+    }
+
+    int maxAxis() const {
+        Vec3 e = extent();
+        return e[0] > e[1] ? (e[0] > e[2] ? 0 : 2) : (e[1] > e[2] ? 1 : 2);
+    }
+
+    void extend(const Vec3 &p) {
+        lower = minimum(lower, p);
+        upper = maximum(upper, p);
+    }
+
+    void extend(const AABB &b) {
+        lower = minimum(lower, b.lower);
+        upper = maximum(upper, b.upper);
+    }
+
+    // Slab test; on entry [t0, t1] is the ray interval, on exit the part of it inside the box.
+    bool intersect(const Ray &r, const Vec3 &invDir, float &t0, float &t1) const {
+        for (int a = 0; a < 3; ++a) {
+            float tNear = (lower[a] - r.orig[a]) * invDir[a];
+            float tFar = (upper[a] - r.orig[a]) * invDir[a];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+            if (t0 > t1) return false;
+        }
+        return true;
+    }
+
+    // Same test with the ray already in SSE registers.
+    bool intersect(const Vec3A &orig, const Vec3A &invDir, float &t0, float &t1) const {
+        const Vec3A tLower = (Vec3A(lower) - orig) * invDir;
+        const Vec3A tUpper = (Vec3A(upper) - orig) * invDir;
+        t0 = maxComponent(max(min(tLower, tUpper), Vec3A(t0, t0, t0)));
+        t1 = minComponent(min(max(tLower, tUpper), Vec3A(t1, t1, t1)));
+        return t0 <= t1;
+    }
+
+  public:
+    Vec3 lower{FLT_MAX, FLT_MAX, FLT_MAX};
+    Vec3 upper{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+};
+
+// Box between a and b. Bounds of linearly moving points interpolated like
+// this keep enclosing them at every t in [0, 1].
+inline AABB lerp(const AABB &a, const AABB &b, float t) {
+    const float s = 1.0f - t;
+    return AABB(s * a.lower + t * b.lower, s * a.upper + t * b.upper);
+}
+
+} // namespace sw
@@ -0,0 +1,61 @@
+#include "swAccelerator.h"
+
+#include "swBVH.h"
+#include "swGrid.h"
+#include "swKdTree.h"
+#include "swQBVH.h"
+
+namespace sw {
+
+std::unique_ptr<Accelerator> createAccelerator(AcceleratorType type) {
+    switch (type) {
+    case AcceleratorType::List: return std::unique_ptr<Accelerator>(new ListAccelerator());
+    case AcceleratorType::BVH: return std::unique_ptr<Accelerator>(new BVHAccelerator());
+    case AcceleratorType::QBVH4: return std::unique_ptr<Accelerator>(new QuantizedBVHAccelerator<4>());
+    case AcceleratorType::QBVH8: return std::unique_ptr<Accelerator>(new QuantizedBVHAccelerator<8>());
+    case AcceleratorType::Grid: return std::unique_ptr<Accelerator>(new GridAccelerator());
+    case AcceleratorType::KdTree: return std::unique_ptr<Accelerator>(new KdTreeAccelerator());
+    }
+    return nullptr;
+}
+
+const char *acceleratorName(AcceleratorType type) {
+    switch (type) {
+    case AcceleratorType::List: return "list";
+    case AcceleratorType::BVH: return "bvh";
+    case AcceleratorType::QBVH4: return "qbvh4";
+    case AcceleratorType::QBVH8: return "qbvh8";
+    case AcceleratorType::Grid: return "grid";
+    case AcceleratorType::KdTree: return "kdtree";
+    }
+    return "unknown";
+}
+
+bool parseAcceleratorType(const std::string &name, AcceleratorType &type) {
+    for (AcceleratorType t : AcceleratorTypes) {
+        if (name == acceleratorName(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ListAccelerator::build(const std::vector<std::shared_ptr<Primitive>> &primitives) {
+    prims.clear();
+    for (auto &primitive : primitives) prims.push_back(primitive.get());
+}
+
+bool ListAccelerator::intersect(const Ray &r, Intersection &isect, bool any) const {
+    Ray ray = r;
+    bool hit = false;
+    for (const Primitive *primitive : prims) {
+        if (intersectPrimitive(*primitive, ray, isect)) {
+            hit = true;
+            if (any) return hit;
+        }
+    }
+    return hit;
+}
+
+} // namespace sw
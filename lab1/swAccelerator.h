@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "swIntersection.h"
+#include "swPrimitive.h"
+#include "swStats.h"
+
+namespace sw {
+
+enum class AcceleratorType {
+    List,  // brute force, every ray against every primitive
+    BVH,   // binned SAH bounding volume hierarchy
+    QBVH4, // the BVH collapsed to 4-wide nodes with 8-bit child boxes
+    QBVH8, // same with 8-wide nodes
+    Grid,  // hashed uniform grid with mailboxing
+    KdTree // SAH kd-tree
+};
+
+// Spatial index over the primitives of a scene. build() is called once after
+// all primitives are pushed; intersect() must then be safe to call from
+// several threads at once.
+class Accelerator {
+  public:
+    virtual ~Accelerator() {}
+
+    virtual void build(const std::vector<std::shared_ptr<Primitive>> &primitives) = 0;
+    virtual bool intersect(const Ray &r, Intersection &isect, bool any) const = 0;
+    // Bytes used by the index itself, excluding the primitives.
+    virtual size_t memoryUsage() const = 0;
+    virtual HierarchyQuality quality() const { return HierarchyQuality(); }
+};
+
+std::unique_ptr<Accelerator> createAccelerator(AcceleratorType type);
+const char *acceleratorName(AcceleratorType type);
+bool parseAcceleratorType(const std::string &name, AcceleratorType &type);
+
+// All backends, in declaration order, for benchmarks and option parsing.
+const AcceleratorType AcceleratorTypes[] = {AcceleratorType::List,  AcceleratorType::BVH,  AcceleratorType::QBVH4,
+                                            AcceleratorType::QBVH8, AcceleratorType::Grid, AcceleratorType::KdTree};
+
+// Tests one primitive and keeps the closest hit: on a hit isect is replaced
+// and ray.maxT shortened, so later tests only accept closer hits.
+inline bool intersectPrimitive(const Primitive &p, Ray &ray, Intersection &isect) {
+    Intersection curr;
+    SW_STAT(primitiveTests++);
+    if (!p.intersect(ray, curr) || curr.hitT >= isect.hitT) return false;
+    isect = curr;
+    isect.primitive = &p;
+    ray.maxT = curr.hitT;
+    return true;
+}
+
+// Direct-mapped per-ray record of the primitives already tested, so that
+// primitives referenced from several cells are intersected once per ray.
+class Mailbox {
+  public:
+    Mailbox() {
+        for (auto &slot : slots) slot = UINT32_MAX;
+    }
+
+    // Returns false if prim was tested already.
+    bool visit(uint32_t prim) {
+        uint32_t &slot = slots[prim & (Size - 1)];
+        if (slot == prim) return false;
+        slot = prim;
+        return true;
+    }
+
+  private:
+    static const uint32_t Size = 16;
+    uint32_t slots[Size];
+};
+
+class ListAccelerator : public Accelerator {
+  public:
+    void build(const std::vector<std::shared_ptr<Primitive>> &primitives);
+    bool intersect(const Ray &r, Intersection &isect, bool any) const;
+    size_t memoryUsage() const { return prims.capacity() * sizeof(const Primitive *); }
+
+  private:
+    std::vector<const Primitive *> prims;
+};
+
+} // namespace sw
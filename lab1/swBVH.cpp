@@ -0,0 +1,219 @@
+#include "swBVH.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace sw {
+
+namespace {
+
+const int NumBins = 16;
+// Deeper nodes fall back to median splits, which halve any of the up to 2^32
+// primitives left in the remaining BVH::MaxDepth - MaxSahDepth levels.
+const int MaxSahDepth = 32;
+
+class Builder {
+  public:
+    Builder(const std::vector<AABB> &bounds, int maxLeafSize, BVH &bvh)
+      : bounds(bounds), maxLeafSize(maxLeafSize), bvh(bvh), centroids(bounds.size()) {
+        for (size_t i = 0; i < bounds.size(); ++i) centroids[i] = bounds[i].centroid();
+    }
+
+    uint32_t build(uint32_t begin, uint32_t end, int depth) {
+        assert(depth <= BVH::MaxDepth);
+        const uint32_t nodeIndex = static_cast<uint32_t>(bvh.nodes.size());
+        bvh.nodes.push_back(BVHNode());
+
+        AABB nodeBounds, centroidBounds;
+        for (uint32_t i = begin; i < end; ++i) {
+            nodeBounds.extend(bounds[bvh.indices[i]]);
+            centroidBounds.extend(centroids[bvh.indices[i]]);
+        }
+        bvh.nodes[nodeIndex].bounds = nodeBounds;
+
+        const uint32_t count = end - begin;
+        if (count <= static_cast<uint32_t>(maxLeafSize) || depth == BVH::MaxDepth) {
+            makeLeaf(nodeIndex, begin, count);
+            return nodeIndex;
+        }
+
+        const int axis = centroidBounds.maxAxis();
+        const uint32_t mid = depth < MaxSahDepth ? sahSplit(begin, end, axis, centroidBounds) : end;
+        const uint32_t split = (mid == begin || mid == end) ? medianSplit(begin, end, axis) : mid;
+
+        build(begin, split, depth + 1);
+        const uint32_t second = build(split, end, depth + 1);
+        bvh.nodes[nodeIndex].offset = second;
+        bvh.nodes[nodeIndex].count = 0;
+        bvh.nodes[nodeIndex].axis = static_cast<uint8_t>(axis);
+        return nodeIndex;
+    }
+
+  private:
+    void makeLeaf(uint32_t nodeIndex, uint32_t begin, uint32_t count) {
+        assert(count <= 0xffff);
+        BVHNode &node = bvh.nodes[nodeIndex];
+        node.offset = begin;
+        node.count = static_cast<uint16_t>(count);
+        node.axis = 0;
+    }
+
+    // Returns the partition point of the cheapest bin boundary, or end when
+    // the centroids cannot be told apart along the axis.
+    uint32_t sahSplit(uint32_t begin, uint32_t end, int axis, const AABB &centroidBounds) {
+        const float lo = centroidBounds.lower[axis];
+        const float extent = centroidBounds.upper[axis] - lo;
+        if (!(extent > 0.0f)) return end;
+        const float scale = NumBins / extent;
+        auto binOf = [&](uint32_t prim) {
+            return std::min(NumBins - 1, static_cast<int>((centroids[prim][axis] - lo) * scale));
+        };
+
+        AABB binBounds[NumBins];
+        uint32_t binCounts[NumBins] = {0};
+        for (uint32_t i = begin; i < end; ++i) {
+            const int b = binOf(bvh.indices[i]);
+            binBounds[b].extend(bounds[bvh.indices[i]]);
+            ++binCounts[b];
+        }
+
+        // Sweep from the right to get the cost of everything above each boundary.
+        float rightCost[NumBins];
+        AABB acc;
+        uint32_t accCount = 0;
+        for (int b = NumBins - 1; b > 0; --b) {
+            acc.extend(binBounds[b]);
+            accCount += binCounts[b];
+            rightCost[b] = accCount * acc.surfaceArea();
+        }
+        acc = AABB();
+        accCount = 0;
+        int bestBin = -1;
+        float bestCost = FLT_MAX;
+        for (int b = 1; b < NumBins; ++b) {
+            acc.extend(binBounds[b - 1]);
+            accCount += binCounts[b - 1];
+            const float cost = accCount * acc.surfaceArea() + rightCost[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestBin = b;
+            }
+        }
+        if (bestBin < 0) return end;
+
+        uint32_t *first = &bvh.indices[0] + begin;
+        uint32_t *mid = std::partition(first, &bvh.indices[0] + end, [&](uint32_t prim) { return binOf(prim) < bestBin; });
+        return begin + static_cast<uint32_t>(mid - first);
+    }
+
+    uint32_t medianSplit(uint32_t begin, uint32_t end, int axis) {
+        const uint32_t mid = begin + (end - begin) / 2;
+        std::nth_element(&bvh.indices[0] + begin, &bvh.indices[0] + mid, &bvh.indices[0] + end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        return mid;
+    }
+
+    const std::vector<AABB> &bounds;
+    const int maxLeafSize;
+    BVH &bvh;
+    std::vector<Vec3> centroids;
+};
+
+} // namespace
+
+void BVH::build(const std::vector<AABB> &bounds, int maxLeafSize) {
+    nodes.clear();
+    endNodeBounds.clear();
+    indices.resize(bounds.size());
+    for (size_t i = 0; i < bounds.size(); ++i) indices[i] = static_cast<uint32_t>(i);
+    if (bounds.empty()) return;
+
+    nodes.reserve(2 * bounds.size());
+    Builder builder(bounds, std::max(1, std::min(maxLeafSize, 0xffff)), *this);
+    builder.build(0, static_cast<uint32_t>(bounds.size()), 0);
+    nodes.shrink_to_fit();
+}
+
+void BVH::refit(const std::vector<AABB> &startBounds, const std::vector<AABB> &endBounds) {
+    endNodeBounds.resize(nodes.size());
+    // Children are stored after their parent, so a backwards sweep sees them first.
+    for (size_t i = nodes.size(); i-- > 0;) {
+        BVHNode &node = nodes[i];
+        AABB start, end;
+        if (node.count > 0) {
+            for (uint32_t k = node.offset; k < node.offset + node.count; ++k) {
+                start.extend(startBounds[indices[k]]);
+                end.extend(endBounds[indices[k]]);
+            }
+        } else {
+            start = nodes[i + 1].bounds;
+            start.extend(nodes[node.offset].bounds);
+            end = endNodeBounds[i + 1];
+            end.extend(endNodeBounds[node.offset]);
+        }
+        node.bounds = start;
+        endNodeBounds[i] = end;
+    }
+}
+
+HierarchyQuality BVH::quality() const {
+    HierarchyQuality q;
+    if (nodes.empty()) return q;
+
+    const float rootArea = nodes[0].bounds.surfaceArea();
+    uint64_t leafPrimitives = 0;
+    std::vector<std::pair<uint32_t, int>> stack(1, std::make_pair(0u, 1));
+    while (!stack.empty()) {
+        const uint32_t index = stack.back().first;
+        const int depth = stack.back().second;
+        stack.pop_back();
+
+        const BVHNode &node = nodes[index];
+        const double p = rootArea > 0.0f ? node.bounds.surfaceArea() / rootArea : 1.0;
+        ++q.nodes;
+        q.maxDepth = std::max(q.maxDepth, depth);
+        if (node.count > 0) {
+            ++q.leaves;
+            leafPrimitives += node.count;
+            q.sahCost += p * node.count;
+        } else {
+            q.sahCost += p;
+            stack.push_back(std::make_pair(index + 1, depth + 1));
+            stack.push_back(std::make_pair(node.offset, depth + 1));
+        }
+    }
+    q.averageLeafSize = double(leafPrimitives) / double(q.leaves);
+    return q;
+}
+
+void BVHAccelerator::build(const std::vector<std::shared_ptr<Primitive>> &primitives) {
+    prims.clear();
+    std::vector<AABB> bounds;
+    bounds.reserve(primitives.size());
+    bool moving = false;
+    for (auto &primitive : primitives) {
+        prims.push_back(primitive.get());
+        bounds.push_back(primitive->bounds());
+        moving = moving || primitive->moving();
+    }
+    // The tree is built over the bounds of the whole shutter interval, then
+    // refit so a ray only enters nodes where things are at its time.
+    bvh.build(bounds);
+    if (!moving) return;
+    std::vector<AABB> startBounds, endBounds;
+    startBounds.reserve(primitives.size());
+    endBounds.reserve(primitives.size());
+    for (auto &primitive : primitives) {
+        startBounds.push_back(primitive->boundsAt(0.0f));
+        endBounds.push_back(primitive->boundsAt(1.0f));
+    }
+    bvh.refit(startBounds, endBounds);
+}
+
+bool BVHAccelerator::intersect(const Ray &r, Intersection &isect, bool any) const {
+    auto leaf = [&](uint32_t i, Ray &ray) { return intersectPrimitive(*prims[i], ray, isect); };
+    return bvh.traverse(r, any, leaf);
+}
+
+} // namespace sw
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swAABB.h"
+#include "swAccelerator.h"
+#include "swStats.h"
+
+namespace sw {
+
+// 32-byte node of a binary BVH stored in depth-first order: the first child
+// of an interior node directly follows it, offset points at the second one.
+struct BVHNode {
+    AABB bounds;
+    uint32_t offset; // first index of a leaf, second child of an interior node
+    uint16_t count;  // primitives in a leaf, 0 for interior nodes
+    uint8_t axis;    // split axis of interior nodes, used to order traversal
+    uint8_t pad;
+};
+
+// Binned SAH BVH over a set of boxes, independent of what the boxes hold.
+class BVH {
+  public:
+    // Depth of the deepest leaf build() creates, the root being at depth 0;
+    // a walk holds at most one pending node per level on its stack.
+    static const int MaxDepth = 64;
+
+    void build(const std::vector<AABB> &bounds, int maxLeafSize = 4);
+    // Keeps the tree but recomputes the node bounds of items moving from
+    // startBounds to endBounds: nodes then hold the bounds at shutter time 0
+    // and endNodeBounds those at time 1, interpolated to each ray's time
+    // during traversal.
+    void refit(const std::vector<AABB> &startBounds, const std::vector<AABB> &endBounds);
+
+    // Calls leaf(index, ray) for every item of every leaf the ray reaches,
+    // nearest first. leaf returns true on a hit and is expected to shorten
+    // ray.maxT itself; with any set the walk stops at the first hit.
+    template <typename Leaf> bool traverse(const Ray &r, bool any, Leaf leaf) const {
+        if (nodes.empty()) return false;
+        auto indexed = [&](uint32_t i, Ray &ray) { return leaf(indices[i], ray); };
+        return traverseBVH(nodes.data(), r, any, indexed, endNodeBounds.empty() ? nullptr : endNodeBounds.data());
+    }
+
+    // Same walk over nodes stored elsewhere, e.g. a mapped scene file; leaf
+    // receives positions in the leaf order instead of item indices. Given
+    // numNodes, nodes are not trusted: interior nodes whose children are
+    // not after them and within numNodes, or that would overflow the stack,
+    // are skipped, and leaf is left to check the positions it receives.
+    template <typename Leaf>
+    static bool traverseBVH(const BVHNode *nodes, const Ray &r, bool any, Leaf &leaf,
+                            const AABB *endNodeBounds = nullptr, uint32_t numNodes = 0);
+
+    size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(BVHNode) + indices.capacity() * sizeof(uint32_t) +
+               endNodeBounds.capacity() * sizeof(AABB);
+    }
+    HierarchyQuality quality() const;
+
+  public:
+    std::vector<BVHNode> nodes;
+    std::vector<uint32_t> indices;
+    std::vector<AABB> endNodeBounds; // per node at shutter time 1 after refit(), empty for static items
+};
+
+template <typename Leaf>
+bool BVH::traverseBVH(const BVHNode *nodes, const Ray &r, bool any, Leaf &leaf, const AABB *endNodeBounds,
+                      uint32_t numNodes) {
+    if (nodes == nullptr) return false;
+    Ray ray = r;
+    const Vec3 invDir = reciprocal(ray.dir);
+    const int dirNegative[3] = {invDir[0] < 0.0f, invDir[1] < 0.0f, invDir[2] < 0.0f};
+    const Vec3A orig(ray.orig), invDirA(invDir);
+
+    uint32_t stack[MaxDepth];
+    int top = 0;
+    uint32_t current = 0;
+    bool hit = false;
+    for (;;) {
+        const BVHNode &node = nodes[current];
+        SW_STAT(nodeVisits++);
+        float t0 = ray.minT, t1 = ray.maxT;
+        const bool entered = endNodeBounds
+                                 ? lerp(node.bounds, endNodeBounds[current], ray.time).intersect(orig, invDirA, t0, t1)
+                                 : node.bounds.intersect(orig, invDirA, t0, t1);
+        if (entered) {
+            if (node.count > 0) {
+                for (uint32_t i = 0; i < node.count; ++i) {
+                    if (leaf(node.offset + i, ray)) {
+                        hit = true;
+                        if (any) return true;
+                    }
+                }
+            } else if (numNodes > 0 && (node.offset <= current + 1 || node.offset >= numNodes || node.axis > 2 ||
+                                        top == MaxDepth)) {
+                // Corrupt subtree, treated as missed.
+            } else if (dirNegative[node.axis]) {
+                stack[top++] = current + 1;
+                current = node.offset;
+                continue;
+            } else {
+                stack[top++] = node.offset;
+                current = current + 1;
+                continue;
+            }
+        }
+        if (top == 0) break;
+        current = stack[--top];
+    }
+    return hit;
+}
+
+class BVHAccelerator : public Accelerator {
+  public:
+    void build(const std::vector<std::shared_ptr<Primitive>> &primitives);
+    bool intersect(const Ray &r, Intersection &isect, bool any) const;
+    size_t memoryUsage() const { return bvh.memoryUsage() + prims.capacity() * sizeof(const Primitive *); }
+    HierarchyQuality quality() const { return bvh.quality(); }
+
+  private:
+    BVH bvh; // refit to the shutter interval when any primitive moves
+    std::vector<const Primitive *> prims;
+};
+
+} // namespace sw
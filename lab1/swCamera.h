@@ -11,7 +11,7 @@ class Camera {
       : origin(o), lookAt(at), up(u), vFOV(v), aspectRatio(a) {}
 
     void setup(int w, int h);
-    Ray getRay(float x, float y);
+    Ray getRay(float x, float y, float time = 0.0f) const;
 
   public:
     Vec3 origin;
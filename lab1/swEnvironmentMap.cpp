@@ -0,0 +1,210 @@
+#include "swEnvironmentMap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "stb_image.h"
+#include "swParallel.h"
+
+namespace sw {
+
+namespace {
+
+const float Pi = static_cast<float>(M_PI);
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t width, height;
+    uint64_t hash;
+};
+
+const uint32_t CacheVersion = 1;
+
+float luminance(const Color &c) { return 0.2126f * c.x() + 0.7152f * c.y() + 0.0722f * c.z(); }
+
+uint64_t hashBytes(const void *data, size_t size) {
+    // FNV-1a, 64 bits
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+} // namespace
+
+float buildAliasTable(const float *weights, int n, AliasEntry *out) {
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += std::max(weights[i], 0.0f);
+    if (sum <= 0.0) {
+        for (int i = 0; i < n; ++i) {
+            out[i].prob = 1.0f;
+            out[i].alias = static_cast<uint32_t>(i);
+            out[i].pdf = 1.0f / static_cast<float>(n);
+        }
+        return 0.0f;
+    }
+
+    // Vose's method: pair every under-full slot with an over-full one.
+    std::vector<double> scaled(n);
+    std::vector<int> small, large;
+    for (int i = 0; i < n; ++i) {
+        double p = std::max(weights[i], 0.0f) / sum;
+        out[i].pdf = static_cast<float>(p);
+        scaled[i] = p * n;
+        if (scaled[i] < 1.0)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+        out[s].prob = static_cast<float>(scaled[s]);
+        out[s].alias = static_cast<uint32_t>(l);
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Leftovers are full up to rounding error.
+    for (int i : large) {
+        out[i].prob = 1.0f;
+        out[i].alias = static_cast<uint32_t>(i);
+    }
+    for (int i : small) {
+        out[i].prob = 1.0f;
+        out[i].alias = static_cast<uint32_t>(i);
+    }
+    return static_cast<float>(sum);
+}
+
+int sampleAliasTable(const AliasEntry *table, int n, float u) {
+    float x = u * static_cast<float>(n);
+    int i = std::min(static_cast<int>(x), n - 1);
+    return (x - static_cast<float>(i)) < table[i].prob ? i : static_cast<int>(table[i].alias);
+}
+
+bool EnvironmentMap::load(const std::string &path) {
+    int w, h, n;
+    float *data = stbi_loadf(path.c_str(), &w, &h, &n, 3);
+    if (data == nullptr) {
+        std::cerr << "Could not load environment map " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    width = w;
+    height = h;
+    pixels.resize(static_cast<size_t>(w) * h);
+    for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = Color(data[3 * i], data[3 * i + 1], data[3 * i + 2]);
+    stbi_image_free(data);
+
+    const std::string cachePath = path + ".alias";
+    const uint64_t hash = hashBytes(&pixels[0], pixels.size() * sizeof(Color));
+    if (!readCache(cachePath, hash)) {
+        buildDistribution();
+        writeCache(cachePath, hash);
+    }
+    return true;
+}
+
+void EnvironmentMap::buildDistribution() {
+    marginal.resize(height);
+    conditional.resize(static_cast<size_t>(width) * height);
+
+    std::vector<float> rowWeights(height);
+    parallelFor(
+      0, height,
+      [&](int y) {
+          const float sinTheta = std::sin(Pi * (static_cast<float>(y) + 0.5f) / static_cast<float>(height));
+          std::vector<float> weights(width);
+          const Color *row = &pixels[static_cast<size_t>(y) * width];
+          for (int x = 0; x < width; ++x) weights[x] = luminance(row[x]) * sinTheta;
+          rowWeights[y] = buildAliasTable(weights.data(), width, &conditional[static_cast<size_t>(y) * width]);
+      },
+      16);
+    buildAliasTable(rowWeights.data(), height, marginal.data());
+}
+
+bool EnvironmentMap::readCache(const std::string &path, uint64_t hash) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+
+    CacheHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "SWAT", 4) != 0 || header.version != CacheVersion ||
+        header.width != width || header.height != height || header.hash != hash)
+        return false;
+
+    marginal.resize(height);
+    conditional.resize(static_cast<size_t>(width) * height);
+    file.read(reinterpret_cast<char *>(marginal.data()), marginal.size() * sizeof(AliasEntry));
+    file.read(reinterpret_cast<char *>(conditional.data()), conditional.size() * sizeof(AliasEntry));
+    return static_cast<bool>(file);
+}
+
+void EnvironmentMap::writeCache(const std::string &path, uint64_t hash) const {
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file) return; // Read-only location, rebuild next time.
+
+    CacheHeader header;
+    std::memcpy(header.magic, "SWAT", 4);
+    header.version = CacheVersion;
+    header.width = width;
+    header.height = height;
+    header.hash = hash;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(marginal.data()), marginal.size() * sizeof(AliasEntry));
+    file.write(reinterpret_cast<const char *>(conditional.data()), conditional.size() * sizeof(AliasEntry));
+}
+
+void EnvironmentMap::toPixel(const Vec3 &dir, int &x, int &y, float &sinTheta) const {
+    Vec3 d = dir;
+    d.normalize();
+    float phi = std::atan2(d.z(), d.x());
+    if (phi < 0.0f) phi += 2.0f * Pi;
+    float cosTheta = std::min(std::max(d.y(), -1.0f), 1.0f);
+    float theta = std::acos(cosTheta);
+    sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    x = std::min(static_cast<int>(phi / (2.0f * Pi) * static_cast<float>(width)), width - 1);
+    y = std::min(static_cast<int>(theta / Pi * static_cast<float>(height)), height - 1);
+}
+
+Color EnvironmentMap::lookup(const Vec3 &dir) const {
+    int x, y;
+    float sinTheta;
+    toPixel(dir, x, y, sinTheta);
+    return pixels[static_cast<size_t>(y) * width + x];
+}
+
+Vec3 EnvironmentMap::sample(float u0, float u1, float u2, float u3, float &pdf) const {
+    const int y = sampleAliasTable(marginal.data(), height, u0);
+    const AliasEntry *row = &conditional[static_cast<size_t>(y) * width];
+    const int x = sampleAliasTable(row, width, u1);
+
+    // Uniform in (phi, theta) inside the chosen pixel.
+    const float phi = 2.0f * Pi * (static_cast<float>(x) + u2) / static_cast<float>(width);
+    const float theta = Pi * (static_cast<float>(y) + u3) / static_cast<float>(height);
+    const float sinTheta = std::sin(theta);
+    pdf = sinTheta > 0.0f ? marginal[y].pdf * row[x].pdf * static_cast<float>(width) * static_cast<float>(height) /
+                              (2.0f * Pi * Pi * sinTheta)
+                          : 0.0f;
+    return Vec3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+}
+
+float EnvironmentMap::pdf(const Vec3 &dir) const {
+    int x, y;
+    float sinTheta;
+    toPixel(dir, x, y, sinTheta);
+    if (sinTheta <= 0.0f) return 0.0f;
+    return marginal[y].pdf * conditional[static_cast<size_t>(y) * width + x].pdf * static_cast<float>(width) *
+           static_cast<float>(height) / (2.0f * Pi * Pi * sinTheta);
+}
+
+} // namespace sw
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "swVec3.h"
+
+namespace sw {
+
+// One slot of a Vose alias table: keep the slot with probability prob,
+// otherwise jump to alias. pdf is the normalized probability of the slot.
+struct AliasEntry {
+    float prob{1.0f};
+    uint32_t alias{0};
+    float pdf{0.0f};
+};
+
+// Builds an alias table over n weights into out and returns the weight sum.
+// All-zero input yields a uniform table.
+float buildAliasTable(const float *weights, int n, AliasEntry *out);
+
+// Picks a slot of the table in O(1) from a single uniform number in [0, 1).
+int sampleAliasTable(const AliasEntry *table, int n, float u);
+
+// Lat-long (equirectangular) HDR environment, importance sampled with a 2D
+// alias table: a marginal table over rows and one conditional table per row,
+// both proportional to luminance times the solid angle of each pixel.
+class EnvironmentMap {
+  public:
+    bool load(const std::string &path);
+    bool valid() const { return width > 0 && height > 0; }
+
+    Color lookup(const Vec3 &dir) const;
+    Vec3 sample(float u0, float u1, float u2, float u3, float &pdf) const;
+    float pdf(const Vec3 &dir) const;
+
+  private:
+    void buildDistribution();
+    bool readCache(const std::string &path, uint64_t hash);
+    void writeCache(const std::string &path, uint64_t hash) const;
+    void toPixel(const Vec3 &dir, int &x, int &y, float &sinTheta) const;
+
+  public:
+    int width{0}, height{0};
+    std::vector<Color> pixels;
+    std::vector<AliasEntry> marginal;    // height entries
+    std::vector<AliasEntry> conditional; // width * height entries, row major
+};
+
+} // namespace sw
@@ -0,0 +1,149 @@
+#define _USE_MATH_DEFINES
+#include "swFilm.h"
+
+#include <algorithm>
+
+#include "swParallel.h"
+
+namespace sw {
+
+namespace {
+
+float filterRadius(FilterType type) {
+    switch (type) {
+    case FilterType::Box: return 0.5f;
+    case FilterType::Gaussian: return 1.5f;
+    case FilterType::Mitchell: return 2.0f;
+    case FilterType::BlackmanHarris: return 2.0f;
+    }
+    return 0.5f;
+}
+
+// One-dimensional profile at distance x in [0, radius] from the center.
+float profile(FilterType type, float x, float radius) {
+    switch (type) {
+    case FilterType::Box: return 1.0f;
+    case FilterType::Gaussian: {
+        const float alpha = 2.0f;
+        return std::max(0.0f, std::exp(-alpha * x * x) - std::exp(-alpha * radius * radius));
+    }
+    case FilterType::Mitchell: {
+        const float B = 1.0f / 3.0f, C = 1.0f / 3.0f;
+        const float t = 2.0f * x / radius;
+        if (t > 1.0f)
+            return ((-B - 6.0f * C) * t * t * t + (6.0f * B + 30.0f * C) * t * t + (-12.0f * B - 48.0f * C) * t +
+                    (8.0f * B + 24.0f * C)) /
+                   6.0f;
+        return ((12.0f - 9.0f * B - 6.0f * C) * t * t * t + (-18.0f + 12.0f * B + 6.0f * C) * t * t +
+                (6.0f - 2.0f * B)) /
+               6.0f;
+    }
+    case FilterType::BlackmanHarris: {
+        const float n = 0.5f + 0.5f * x / radius; // position in the window, 0.5 at the center
+        const float w = 2.0f * float(M_PI) * n;
+        return 0.35875f - 0.48829f * std::cos(w) + 0.14128f * std::cos(2.0f * w) - 0.01168f * std::cos(3.0f * w);
+    }
+    }
+    return 0.0f;
+}
+
+} // namespace
+
+const char *filterName(FilterType type) {
+    switch (type) {
+    case FilterType::Box: return "box";
+    case FilterType::Gaussian: return "gaussian";
+    case FilterType::Mitchell: return "mitchell";
+    case FilterType::BlackmanHarris: return "blackman-harris";
+    }
+    return "unknown";
+}
+
+bool parseFilterType(const std::string &name, FilterType &type) {
+    for (FilterType t : FilterTypes) {
+        if (name == filterName(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+Filter::Filter(FilterType type) : type(type), radius(filterRadius(type)), invRadius(1.0f / radius) {
+    // Sampled at the middle of each table entry.
+    for (int i = 0; i < TableSize; ++i) table[i] = profile(type, (i + 0.5f) * radius / TableSize, radius);
+}
+
+void FilmTile::addSample(float x, float y, const Color &c) {
+    // Pixel centers within the filter radius, clipped to the tile and the image.
+    const float r = filter->radius;
+    const int px0 = std::max(static_cast<int>(std::ceil(x - 0.5f - r)), std::max(x0, 0));
+    const int py0 = std::max(static_cast<int>(std::ceil(y - 0.5f - r)), std::max(y0, 0));
+    const int px1 = std::min(static_cast<int>(std::floor(x - 0.5f + r)), std::min(x0 + width, imageWidth) - 1);
+    const int py1 = std::min(static_cast<int>(std::floor(y - 0.5f + r)), std::min(y0 + height, imageHeight) - 1);
+    for (int py = py0; py <= py1; ++py) {
+        for (int px = px0; px <= px1; ++px) {
+            const float w = filter->evaluate(px + 0.5f - x, py + 0.5f - y);
+            const size_t i = static_cast<size_t>(py - y0) * width + (px - x0);
+            sums[i] += w * c;
+            weights[i] += w;
+        }
+    }
+}
+
+Film::Film(int width, int height, const Filter &filter, int tileSize)
+  : width(width), height(height), tileSize(tileSize), tilesX((width + tileSize - 1) / tileSize),
+    tilesY((height + tileSize - 1) / tileSize), filter(filter), pixels(static_cast<size_t>(width) * height) {
+    const int border = static_cast<int>(std::ceil(filter.radius - 0.5f));
+    tiles.resize(static_cast<size_t>(tilesX) * tilesY);
+    for (int t = 0; t < tileCount(); ++t) {
+        FilmTile &tile = tiles[t];
+        tile.x0 = (t % tilesX) * tileSize - border;
+        tile.y0 = (t / tilesX) * tileSize - border;
+        tile.width = std::min(tileSize, width - (t % tilesX) * tileSize) + 2 * border;
+        tile.height = std::min(tileSize, height - (t / tilesX) * tileSize) + 2 * border;
+        tile.filter = &this->filter;
+        tile.imageWidth = width;
+        tile.imageHeight = height;
+    }
+    clear();
+}
+
+void Film::clear() {
+    for (FilmTile &tile : tiles) {
+        tile.sums.assign(static_cast<size_t>(tile.width) * tile.height, Color());
+        tile.weights.assign(static_cast<size_t>(tile.width) * tile.height, 0.0f);
+    }
+}
+
+void Film::resolve(unsigned numThreads) {
+    const int border = static_cast<int>(std::ceil(filter.radius - 0.5f));
+    parallelFor(
+      0, height,
+      [&](int y) {
+          std::vector<Color> sum(width);
+          std::vector<float> weight(width, 0.0f);
+          // Only tile rows within the border of this row overlap it.
+          const int ty0 = std::max((y - border) / tileSize, 0), ty1 = std::min((y + border) / tileSize, tilesY - 1);
+          for (int ty = ty0; ty <= ty1; ++ty) {
+              for (int tx = 0; tx < tilesX; ++tx) {
+                  const FilmTile &tile = tiles[static_cast<size_t>(ty) * tilesX + tx];
+                  if (y < tile.y0 || y >= tile.y0 + tile.height) continue;
+                  const size_t row = static_cast<size_t>(y - tile.y0) * tile.width;
+                  for (int x = std::max(tile.x0, 0); x < std::min(tile.x0 + tile.width, width); ++x) {
+                      sum[x] += tile.sums[row + (x - tile.x0)];
+                      weight[x] += tile.weights[row + (x - tile.x0)];
+                  }
+              }
+          }
+          // Negative lobes can leave a pixel with no or negative weight, or a negative color.
+          for (int x = 0; x < width; ++x) {
+              Color c = weight[x] > 0.0f ? sum[x] * (1.0f / weight[x]) : Color();
+              for (int k = 0; k < 3; ++k) c.m[k] = std::max(c.m[k], 0.0f);
+              pixels[static_cast<size_t>(y) * width + x] = c;
+          }
+      },
+      16, numThreads);
+}
+
+} // namespace sw
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "swVec3.h"
+
+namespace sw {
+
+enum class FilterType {
+    Box,           // the pixel's own samples, weighted equally
+    Gaussian,      // radius 1.5, falls to zero at the edge
+    Mitchell,      // Mitchell-Netravali with B = C = 1/3, radius 2, slightly negative lobes
+    BlackmanHarris // four-term Blackman-Harris window, radius 2
+};
+
+const char *filterName(FilterType type);
+bool parseFilterType(const std::string &name, FilterType &type);
+
+const FilterType FilterTypes[] = {FilterType::Box, FilterType::Gaussian, FilterType::Mitchell,
+                                  FilterType::BlackmanHarris};
+
+// Separable pixel reconstruction filter, tabulated over [0, radius].
+class Filter {
+  public:
+    explicit Filter(FilterType type = FilterType::Box);
+
+    // Weight of a sample at offset (dx, dy) from a pixel center.
+    float evaluate(float dx, float dy) const { return lookup(dx) * lookup(dy); }
+
+  public:
+    FilterType type;
+    float radius;
+
+  private:
+    static const int TableSize = 64;
+
+    float lookup(float d) const {
+        const int i = static_cast<int>(std::fabs(d) * invRadius * TableSize);
+        return i < TableSize ? table[i] : 0.0f;
+    }
+
+    float invRadius;
+    float table[TableSize];
+};
+
+// Accumulates the splats of the samples taken inside one image tile, and
+// of its border as wide as the filter reaches. Each tile is written by one
+// thread at a time, so splatting needs no synchronization.
+class FilmTile {
+  public:
+    void addSample(float x, float y, const Color &c);
+
+  public:
+    int x0{0}, y0{0}, width{0}, height{0}; // pixels covered, border included
+    std::vector<Color> sums;
+    std::vector<float> weights;
+
+  private:
+    friend class Film;
+    const Filter *filter{nullptr};
+    int imageWidth{0}, imageHeight{0};
+};
+
+// Image built from weighted sample splats. Rendering threads splat into the
+// film tile of the image tile they work on; resolve() then gathers the
+// overlapping tiles one image row at a time, so no two threads ever write
+// the same pixel and the shared image needs no atomics or locks however
+// wide the filter is.
+class Film {
+  public:
+    Film(int width, int height, const Filter &filter, int tileSize = 16);
+    Film(const Film &) = delete; // the tiles point at the filter
+    Film &operator=(const Film &) = delete;
+
+    int tileCount() const { return static_cast<int>(tiles.size()); }
+    // Tile tile % tilesX, tile / tilesX of tileSize x tileSize pixels, row-major.
+    FilmTile &tile(int tile) { return tiles[tile]; }
+    void clear();
+
+    void resolve(unsigned numThreads = 0);
+    // Filtered pixel after resolve(), black where no sample reached it.
+    Color pixel(int x, int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+
+  public:
+    int width, height;
+    int tileSize, tilesX, tilesY;
+    Filter filter;
+
+  private:
+    std::vector<FilmTile> tiles;
+    std::vector<Color> pixels;
+};
+
+} // namespace sw
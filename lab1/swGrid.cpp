@@ -0,0 +1,166 @@
+#include "swGrid.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sw {
+
+namespace {
+
+const float CellsPerPrimitive = 3.0f;
+const int MaxResolution = 1 << 20;
+
+} // namespace
+
+void GridAccelerator::build(const std::vector<std::shared_ptr<Primitive>> &primitives) {
+    prims.clear();
+    table.clear();
+    cellPrims.clear();
+    bounds = AABB();
+
+    std::vector<AABB> primBounds;
+    primBounds.reserve(primitives.size());
+    for (auto &primitive : primitives) {
+        prims.push_back(primitive.get());
+        primBounds.push_back(primitive->bounds());
+        bounds.extend(primBounds.back());
+    }
+    if (prims.empty()) return;
+
+    // Give flat scenes some thickness so every axis has a usable cell size.
+    Vec3 extent = bounds.extent();
+    const float maxExtent = std::max(std::max(extent[0], extent[1]), std::max(extent[2], 1e-6f));
+    for (int a = 0; a < 3; ++a) {
+        const float pad = std::max(1e-3f * maxExtent - extent[a], 0.0f) * 0.5f + 1e-5f * maxExtent;
+        bounds.lower.m[a] -= pad;
+        bounds.upper.m[a] += pad;
+    }
+    extent = bounds.extent();
+
+    const float volume = extent[0] * extent[1] * extent[2];
+    const float cellsPerUnit = std::cbrt(CellsPerPrimitive * static_cast<float>(prims.size()) / volume);
+    for (int a = 0; a < 3; ++a) {
+        res[a] = std::min(std::max(static_cast<int>(extent[a] * cellsPerUnit), 1), MaxResolution);
+        cellSize.m[a] = extent[a] / static_cast<float>(res[a]);
+        invCellSize.m[a] = static_cast<float>(res[a]) / extent[a];
+    }
+
+    auto cellOf = [&](const Vec3 &p, int a) {
+        return std::min(std::max(static_cast<int>((p[a] - bounds.lower[a]) * invCellSize[a]), 0), res[a] - 1);
+    };
+
+    // Reference every primitive from all the cells its box overlaps, then group by cell.
+    std::vector<std::pair<uint64_t, uint32_t>> refs;
+    refs.reserve(prims.size() * 2);
+    for (uint32_t i = 0; i < prims.size(); ++i) {
+        const AABB &b = primBounds[i];
+        const int x0 = cellOf(b.lower, 0), x1 = cellOf(b.upper, 0);
+        const int y0 = cellOf(b.lower, 1), y1 = cellOf(b.upper, 1);
+        const int z0 = cellOf(b.lower, 2), z1 = cellOf(b.upper, 2);
+        for (int z = z0; z <= z1; ++z)
+            for (int y = y0; y <= y1; ++y)
+                for (int x = x0; x <= x1; ++x) {
+                    const uint64_t key = static_cast<uint64_t>(x) +
+                                         static_cast<uint64_t>(res[0]) * (y + static_cast<uint64_t>(res[1]) * z);
+                    refs.emplace_back(key, i);
+                }
+    }
+    std::sort(refs.begin(), refs.end());
+
+    size_t numCells = 0;
+    for (size_t i = 0; i < refs.size(); ++i)
+        if (i == 0 || refs[i].first != refs[i - 1].first) ++numCells;
+
+    int bits = 1;
+    while ((uint64_t(1) << bits) < 2 * numCells) ++bits;
+    hashShift = 64 - bits;
+    table.assign(size_t(1) << bits, Cell{EmptyKey, 0, 0});
+
+    cellPrims.resize(refs.size());
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (size_t i = 0; i < refs.size();) {
+        size_t j = i;
+        while (j < refs.size() && refs[j].first == refs[i].first) {
+            cellPrims[j] = refs[j].second;
+            ++j;
+        }
+        uint64_t slot = hashSlot(refs[i].first);
+        while (table[slot].key != EmptyKey) slot = (slot + 1) & mask;
+        table[slot] = Cell{refs[i].first, static_cast<uint32_t>(i), static_cast<uint32_t>(j - i)};
+        i = j;
+    }
+}
+
+const GridAccelerator::Cell *GridAccelerator::findCell(uint64_t key) const {
+    const uint64_t mask = table.size() - 1;
+    for (uint64_t slot = hashSlot(key);; slot = (slot + 1) & mask) {
+        const Cell &cell = table[slot];
+        if (cell.key == key) return &cell;
+        if (cell.key == EmptyKey) return nullptr;
+    }
+}
+
+bool GridAccelerator::intersect(const Ray &r, Intersection &isect, bool any) const {
+    if (table.empty()) return false;
+
+    Ray ray = r;
+    const Vec3 invDir = reciprocal(ray.dir);
+    float tEnter = ray.minT, tExit = ray.maxT;
+    if (!bounds.intersect(ray, invDir, tEnter, tExit)) return false;
+
+    // 3D DDA setup (Amanatides & Woo).
+    const Vec3 p = ray.orig + tEnter * ray.dir;
+    int cell[3], step[3], out[3];
+    float tNext[3], tDelta[3];
+    for (int a = 0; a < 3; ++a) {
+        cell[a] = std::min(std::max(static_cast<int>((p[a] - bounds.lower[a]) * invCellSize[a]), 0), res[a] - 1);
+        if (ray.dir[a] > 0.0f) {
+            tNext[a] = tEnter + (bounds.lower[a] + (cell[a] + 1) * cellSize[a] - p[a]) * invDir[a];
+            tDelta[a] = cellSize[a] * invDir[a];
+            step[a] = 1;
+            out[a] = res[a];
+        } else if (ray.dir[a] < 0.0f) {
+            tNext[a] = tEnter + (bounds.lower[a] + cell[a] * cellSize[a] - p[a]) * invDir[a];
+            tDelta[a] = -cellSize[a] * invDir[a];
+            step[a] = -1;
+            out[a] = -1;
+        } else {
+            tNext[a] = FLT_MAX;
+            tDelta[a] = FLT_MAX;
+            step[a] = 0;
+            out[a] = -1;
+        }
+    }
+
+    Mailbox mailbox;
+    bool hit = false;
+    for (;;) {
+        const uint64_t key = static_cast<uint64_t>(cell[0]) +
+                             static_cast<uint64_t>(res[0]) * (cell[1] + static_cast<uint64_t>(res[1]) * cell[2]);
+        SW_STAT(nodeVisits++);
+        if (const Cell *c = findCell(key)) {
+            for (uint32_t i = c->first; i < c->first + c->count; ++i) {
+                const uint32_t prim = cellPrims[i];
+                if (!mailbox.visit(prim)) continue;
+                if (intersectPrimitive(*prims[prim], ray, isect)) {
+                    hit = true;
+                    if (any) return true;
+                }
+            }
+        }
+
+        const int a = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        if (ray.maxT < tNext[a] || step[a] == 0) break; // closest hit lies in this cell
+        cell[a] += step[a];
+        if (cell[a] == out[a]) break;
+        tNext[a] += tDelta[a];
+    }
+    return hit;
+}
+
+size_t GridAccelerator::memoryUsage() const {
+    return table.capacity() * sizeof(Cell) + cellPrims.capacity() * sizeof(uint32_t) +
+           prims.capacity() * sizeof(const Primitive *);
+}
+
+} // namespace sw
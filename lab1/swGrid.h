@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swAABB.h"
+#include "swAccelerator.h"
+
+namespace sw {
+
+// Uniform grid with about CellsPerPrimitive cells per primitive. Only
+// non-empty cells are stored, in an open-addressing hash table keyed on the
+// linear cell index, so fine grids over sparse scenes stay small. Rays walk
+// the cells with a 3D DDA and use a mailbox to skip primitives straddling
+// several cells.
+class GridAccelerator : public Accelerator {
+  public:
+    void build(const std::vector<std::shared_ptr<Primitive>> &primitives);
+    bool intersect(const Ray &r, Intersection &isect, bool any) const;
+    size_t memoryUsage() const;
+
+  private:
+    struct Cell {
+        uint64_t key;
+        uint32_t first, count; // range in cellPrims
+    };
+
+    static const uint64_t EmptyKey = UINT64_MAX;
+
+    const Cell *findCell(uint64_t key) const;
+    uint64_t hashSlot(uint64_t key) const { return (key * 0x9E3779B97F4A7C15ull) >> hashShift; }
+
+    AABB bounds;
+    int res[3]{0, 0, 0};
+    Vec3 cellSize, invCellSize;
+    std::vector<Cell> table;
+    int hashShift{64};
+    std::vector<uint32_t> cellPrims;
+    std::vector<const Primitive *> prims;
+};
+
+} // namespace sw
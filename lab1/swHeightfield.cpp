@@ -0,0 +1,302 @@
+#include "swHeightfield.h"
+
+#include <algorithm>
+
+#include "swParallel.h"
+#include "swRasterizer.h"
+#include "swStats.h"
+
+namespace sw {
+
+namespace {
+
+// Noise functions ported from cg_labs/shaders/EDAN35/ray_marching.frag.
+float fract(float x) { return x - std::floor(x); }
+
+float hash2dToFloat(float px, float py) {
+    const float h = std::floor(px) * 127.1f + std::floor(py) * 311.7f;
+    return fract(std::sin(h) * 43758.5453123f);
+}
+
+float valueNoise(float px, float py) {
+    const float ix = std::floor(px), iy = std::floor(py);
+    const float fx = px - ix, fy = py - iy;
+
+    const float v00 = hash2dToFloat(ix, iy);
+    const float v10 = hash2dToFloat(ix + 1.0f, iy);
+    const float v01 = hash2dToFloat(ix, iy + 1.0f);
+    const float v11 = hash2dToFloat(ix + 1.0f, iy + 1.0f);
+
+    const float ux = fx * fx * (3.0f - 2.0f * fx);
+    const float uy = fy * fy * (3.0f - 2.0f * fy);
+    const float nx0 = v00 + (v10 - v00) * ux;
+    const float nx1 = v01 + (v11 - v01) * ux;
+    return nx0 + (nx1 - nx0) * uy;
+}
+
+float fbm(float px, float py, int octaves) {
+    float sum = 0.0f, amplitude = 1.0f, freq = 1.0f, amplitudeSum = 0.0f;
+    // Columns of the GLSL mat2, rotated by (4/5, 3/5) every octave.
+    float c0x = 1.0f, c0y = 0.0f, c1x = 0.0f, c1y = 1.0f;
+    for (int i = 0; i < octaves; ++i) {
+        const float vx = px * freq, vy = py * freq;
+        sum += valueNoise(vx * c0x + vy * c0y, vx * c1x + vy * c1y) * amplitude;
+        amplitudeSum += amplitude;
+
+        freq *= 2.0f;
+        amplitude *= 0.5f;
+        const float n0x = 0.8f * c0x + 0.6f * c1x, n0y = 0.8f * c0y + 0.6f * c1y;
+        const float n1x = -0.6f * c0x + 0.8f * c1x, n1y = -0.6f * c0y + 0.8f * c1y;
+        c0x = n0x;
+        c0y = n0y;
+        c1x = n1x;
+        c1y = n1y;
+    }
+    return sum / amplitudeSum;
+}
+
+} // namespace
+
+Heightfield::Heightfield(int resX, int resZ, const Vec3 &origin, float spacing, const Material &m)
+  : resX(resX), resZ(resZ), origin(origin), spacing(spacing), heights(static_cast<size_t>(resX) * resZ, 0.0f),
+    material(m) {}
+
+void Heightfield::generateFbm(float terrainScale, int octaves) {
+    const float terrainBaseY = 50.0f;
+    const float terrainAmplitude = 80.0f;
+    parallelFor(
+      0, resZ,
+      [&](int z) {
+          const float wz = origin.z() + static_cast<float>(z) * spacing;
+          for (int x = 0; x < resX; ++x) {
+              const float wx = origin.x() + static_cast<float>(x) * spacing;
+              const float n = fbm(wx * terrainScale, wz * terrainScale, octaves) * 2.0f - 1.0f;
+              height(x, z) = n * terrainAmplitude + terrainBaseY;
+          }
+      },
+      16);
+    buildPyramid();
+}
+
+void Heightfield::buildPyramid() {
+    levels.clear();
+    const int cellsX = resX - 1, cellsZ = resZ - 1;
+    if (cellsX < 1 || cellsZ < 1) return;
+
+    const auto minMax = std::minmax_element(heights.begin(), heights.end());
+    rangeBase = *minMax.first;
+    rangeScale = std::max(*minMax.second - *minMax.first, 1e-6f) / 65535.0f;
+    auto quantize = [this](float h, bool up) {
+        float q = (h - rangeBase) / rangeScale;
+        q = up ? std::ceil(q) : std::floor(q);
+        return static_cast<uint16_t>(std::min(std::max(q, 0.0f), 65535.0f));
+    };
+
+    // Leaf level: every 2x2-cell block spans 3x3 height samples.
+    Level leaves;
+    leaves.nx = (cellsX + 1) / 2;
+    leaves.nz = (cellsZ + 1) / 2;
+    leaves.ranges.resize(static_cast<size_t>(leaves.nx) * leaves.nz);
+    parallelFor(
+      0, leaves.nz,
+      [&](int j) {
+          const int z0 = 2 * j, z1 = std::min(2 * j + 2, cellsZ);
+          for (int i = 0; i < leaves.nx; ++i) {
+              const int x0 = 2 * i, x1 = std::min(2 * i + 2, cellsX);
+              float lo = height(x0, z0), hi = lo;
+              for (int z = z0; z <= z1; ++z)
+                  for (int x = x0; x <= x1; ++x) {
+                      lo = std::min(lo, height(x, z));
+                      hi = std::max(hi, height(x, z));
+                  }
+              Range &range = leaves.ranges[static_cast<size_t>(j) * leaves.nx + i];
+              range.lo = quantize(lo, false);
+              range.hi = quantize(hi, true);
+          }
+      },
+      16);
+    levels.push_back(std::move(leaves));
+
+    while (levels.back().nx > 1 || levels.back().nz > 1) {
+        const Level &child = levels.back();
+        Level parent;
+        parent.nx = (child.nx + 1) / 2;
+        parent.nz = (child.nz + 1) / 2;
+        parent.ranges.resize(static_cast<size_t>(parent.nx) * parent.nz);
+        for (int j = 0; j < parent.nz; ++j)
+            for (int i = 0; i < parent.nx; ++i) {
+                Range range{65535, 0};
+                for (int cj = 2 * j; cj < std::min(2 * j + 2, child.nz); ++cj)
+                    for (int ci = 2 * i; ci < std::min(2 * i + 2, child.nx); ++ci) {
+                        const Range &c = child.ranges[static_cast<size_t>(cj) * child.nx + ci];
+                        range.lo = std::min(range.lo, c.lo);
+                        range.hi = std::max(range.hi, c.hi);
+                    }
+                parent.ranges[static_cast<size_t>(j) * parent.nx + i] = range;
+            }
+        levels.push_back(std::move(parent));
+    }
+}
+
+AABB Heightfield::bounds() const {
+    if (levels.empty()) return AABB();
+    const Range &root = levels.back().ranges[0];
+    const float pad = rangeScale;
+    return AABB(Vec3(origin.x(), origin.y() + rangeBase + static_cast<float>(root.lo) * rangeScale - pad, origin.z()),
+                Vec3(origin.x() + static_cast<float>(resX - 1) * spacing,
+                     origin.y() + rangeBase + static_cast<float>(root.hi) * rangeScale + pad,
+                     origin.z() + static_cast<float>(resZ - 1) * spacing));
+}
+
+bool Heightfield::intersectCell(int cx, int cz, const Ray &r, float &tBest, Vec3 &normal) const {
+    const float x0 = origin.x() + static_cast<float>(cx) * spacing, x1 = x0 + spacing;
+    const float z0 = origin.z() + static_cast<float>(cz) * spacing, z1 = z0 + spacing;
+    const Vec3 p00(x0, origin.y() + height(cx, cz), z0);
+    const Vec3 p10(x1, origin.y() + height(cx + 1, cz), z0);
+    const Vec3 p01(x0, origin.y() + height(cx, cz + 1), z1);
+    const Vec3 p11(x1, origin.y() + height(cx + 1, cz + 1), z1);
+
+    // Moller-Trumbore, vertices wound so that the normal points up.
+    auto triangle = [&](const Vec3 &a, const Vec3 &b, const Vec3 &c) {
+        SW_STAT(primitiveTests++);
+        const Vec3 e1 = b - a, e2 = c - a;
+        const Vec3 p = r.dir % e2;
+        const float det = e1 * p;
+        if (det == 0.0f) return false;
+        const float invDet = 1.0f / det;
+        const Vec3 s = r.orig - a;
+        const float u = (s * p) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+        const Vec3 q = s % e1;
+        const float v = (r.dir * q) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+        const float t = (e2 * q) * invDet;
+        if (t < r.minT || t >= tBest) return false;
+        tBest = t;
+        normal = e1 % e2;
+        return true;
+    };
+    const bool hit0 = triangle(p00, p11, p10);
+    const bool hit1 = triangle(p00, p01, p11);
+    return hit0 || hit1;
+}
+
+bool Heightfield::intersect(const Ray &r, Intersection &isect) const {
+    if (levels.empty()) return false;
+
+    const int cellsX = resX - 1, cellsZ = resZ - 1;
+    const Vec3 &o = r.orig, &d = r.dir;
+    const float invX = 1.0f / d.x(), invY = 1.0f / d.y(), invZ = 1.0f / d.z();
+    const float pad = rangeScale;
+    float tBest = r.maxT;
+
+    // Clips the ray against the bounds of a node, tightened by the closest hit so far.
+    auto enter = [&](int level, int i, int j, float &tEnter) {
+        const Level &l = levels[level];
+        const Range &range = l.ranges[static_cast<size_t>(j) * l.nx + i];
+        const int shift = level + 1;
+        const float x0 = origin.x() + static_cast<float>(i << shift) * spacing;
+        const float x1 = origin.x() + static_cast<float>(std::min((i + 1) << shift, cellsX)) * spacing;
+        const float z0 = origin.z() + static_cast<float>(j << shift) * spacing;
+        const float z1 = origin.z() + static_cast<float>(std::min((j + 1) << shift, cellsZ)) * spacing;
+        const float y0 = origin.y() + rangeBase + static_cast<float>(range.lo) * rangeScale - pad;
+        const float y1 = origin.y() + rangeBase + static_cast<float>(range.hi) * rangeScale + pad;
+
+        float t0 = r.minT, t1 = tBest;
+        float a = (x0 - o.x()) * invX, b = (x1 - o.x()) * invX;
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+        a = (y0 - o.y()) * invY, b = (y1 - o.y()) * invY;
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+        a = (z0 - o.z()) * invZ, b = (z1 - o.z()) * invZ;
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+        tEnter = t0;
+        return t0 <= t1;
+    };
+
+    struct Node {
+        int level, i, j;
+        float tEnter;
+    };
+    Node stack[64];
+    int top = 0;
+    float tRoot;
+    const int rootLevel = static_cast<int>(levels.size()) - 1;
+    if (!enter(rootLevel, 0, 0, tRoot)) return false;
+    stack[top++] = Node{rootLevel, 0, 0, tRoot};
+
+    // Children are pushed far to near so the nearest one is visited first.
+    const int farI = d.x() >= 0.0f ? 1 : 0;
+    const int farJ = d.z() >= 0.0f ? 1 : 0;
+    const int order[4][2] = {{farI, farJ}, {farI, 1 - farJ}, {1 - farI, farJ}, {1 - farI, 1 - farJ}};
+
+    bool hit = false;
+    Vec3 normal;
+    while (top > 0) {
+        const Node node = stack[--top];
+        if (node.tEnter > tBest) continue;
+        SW_STAT(nodeVisits++);
+
+        if (node.level == 0) {
+            for (int cz = 2 * node.j; cz < std::min(2 * node.j + 2, cellsZ); ++cz)
+                for (int cx = 2 * node.i; cx < std::min(2 * node.i + 2, cellsX); ++cx)
+                    hit |= intersectCell(cx, cz, r, tBest, normal);
+            continue;
+        }
+
+        const int level = node.level - 1;
+        const Level &child = levels[level];
+        for (int k = 0; k < 4; ++k) {
+            const int ci = 2 * node.i + order[k][0], cj = 2 * node.j + order[k][1];
+            if (ci >= child.nx || cj >= child.nz) continue;
+            float t;
+            if (enter(level, ci, cj, t)) stack[top++] = Node{level, ci, cj, t};
+        }
+    }
+    if (!hit) return false;
+
+    setIntersection(r, tBest, normal, isect);
+    return true;
+}
+
+bool Heightfield::intersectElement(uint32_t cell, const Ray &r, Intersection &isect) const {
+    const int cellsX = resX - 1;
+    if (cellsX <= 0 || cell >= static_cast<uint32_t>(cellsX) * static_cast<uint32_t>(resZ - 1)) return false;
+    float tBest = r.maxT;
+    Vec3 normal;
+    if (!intersectCell(static_cast<int>(cell % cellsX), static_cast<int>(cell / cellsX), r, tBest, normal)) return false;
+    setIntersection(r, tBest, normal, isect);
+    return true;
+}
+
+bool Heightfield::rasterize(Rasterizer &r) const {
+    for (int cz = 0; cz + 1 < resZ; ++cz) {
+        for (int cx = 0; cx + 1 < resX; ++cx) {
+            const float x0 = origin.x() + static_cast<float>(cx) * spacing, x1 = x0 + spacing;
+            const float z0 = origin.z() + static_cast<float>(cz) * spacing, z1 = z0 + spacing;
+            const Vec3 p00(x0, origin.y() + height(cx, cz), z0);
+            const Vec3 p10(x1, origin.y() + height(cx + 1, cz), z0);
+            const Vec3 p01(x0, origin.y() + height(cx, cz + 1), z1);
+            const Vec3 p11(x1, origin.y() + height(cx + 1, cz + 1), z1);
+            const uint32_t cell = static_cast<uint32_t>(cz) * (resX - 1) + cx;
+            r.addTriangle(cell, p00, p11, p10);
+            r.addTriangle(cell, p00, p01, p11);
+        }
+    }
+    return true;
+}
+
+void Heightfield::setIntersection(const Ray &r, float t, const Vec3 &normal, Intersection &isect) const {
+    isect.hitT = t;
+    isect.normal = normal;
+    isect.normal.normalize();
+    isect.frontFacing = (-r.dir * isect.normal) > 0.0f;
+    if (!isect.frontFacing) isect.normal = -isect.normal;
+    isect.position = r.orig + t * r.dir;
+    isect.material = material;
+    isect.ray = r;
+}
+
+} // namespace sw
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swIntersection.h"
+#include "swPrimitive.h"
+#include "swRay.h"
+
+namespace sw {
+
+// Regular grid of heights over the xz-plane, each cell split in two triangles.
+// A min/max quadtree over the cells lets rays skip every node whose height
+// range they pass above or below, so intersection visits O(log n) nodes on
+// typical terrain instead of marching the grid cell by cell.
+class Heightfield : public Primitive {
+  public:
+    Heightfield() = default;
+    // resX * resZ height samples, the first one at origin, spaced by spacing
+    // along x and z; origin.y is added to every height.
+    Heightfield(int resX, int resZ, const Vec3 &origin, float spacing, const Material &m);
+    Heightfield(Heightfield &&) = default;
+    Heightfield &operator=(Heightfield &&) = default;
+
+    float &height(int x, int z) { return heights[static_cast<size_t>(z) * resX + x]; }
+    float height(int x, int z) const { return heights[static_cast<size_t>(z) * resX + x]; }
+
+    // Fills the grid with the fBm terrain of cg_labs/shaders/EDAN35/ray_marching.frag
+    // and rebuilds the pyramid.
+    void generateFbm(float terrainScale = 0.007f, int octaves = 12);
+    // Must be called after the heights change.
+    void buildPyramid();
+
+    bool intersect(const Ray &r, Intersection &isect) const;
+    AABB bounds() const;
+    // Elements are cells, cz * (resX - 1) + cx, each rasterized as its two triangles.
+    bool intersectElement(uint32_t cell, const Ray &r, Intersection &isect) const;
+    bool rasterize(Rasterizer &r) const;
+
+  private:
+    struct Range {
+        uint16_t lo, hi; // quantized, conservative
+    };
+
+    struct Level {
+        int nx, nz;
+        std::vector<Range> ranges;
+    };
+
+    bool intersectCell(int cx, int cz, const Ray &r, float &tBest, Vec3 &normal) const;
+    void setIntersection(const Ray &r, float t, const Vec3 &normal, Intersection &isect) const;
+
+  public:
+    int resX{0}, resZ{0};
+    Vec3 origin;
+    float spacing{1.0f};
+    std::vector<float> heights;
+    Material material;
+
+  private:
+    // levels[0] holds 2x2-cell blocks, each level above halves the resolution
+    // down to a single root node.
+    std::vector<Level> levels;
+    float rangeBase{0.0f}, rangeScale{0.0f};
+};
+
+} // namespace sw
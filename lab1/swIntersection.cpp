@@ -6,7 +6,7 @@ Ray Intersection::getShadowRay(const Vec3 &lightPos) {
     Vec3 L = lightPos - position;
     float tMax = sqrt(L * L);
     // 0.01f
-    return Ray(position, L.normalize(), 0.01f, tMax);
+    return Ray(position, L.normalize(), 0.01f, tMax, ray.time);
 }
 
 Ray Intersection::getReflectedRay(void) {
@@ -18,7 +18,7 @@ Ray Intersection::getReflectedRay(void) {
     Vec3 R = D - 2*(N * D)*N;
     // -------------------
 
-    return Ray(position, R, 0.01f, FLT_MAX);
+    return Ray(position, R, 0.01f, FLT_MAX, ray.time);
 }
 
 Ray Intersection::getRefractedRay(void) {
@@ -36,7 +36,7 @@ Ray Intersection::getRefractedRay(void) {
     Vec3 R = eta*D + (eta*r - sqrt(c))*N;
     // -------------------
 
-    return Ray(position, R, 0.01f, FLT_MAX);
+    return Ray(position, R, 0.01f, FLT_MAX, ray.time);
 }
 
 } // namespace sw
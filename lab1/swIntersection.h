@@ -5,6 +5,8 @@
 
 namespace sw {
 
+class Primitive;
+
 class Intersection {
   public:
     Ray getShadowRay(const Vec3 &lightPos);
@@ -18,6 +20,7 @@ class Intersection {
     bool frontFacing{true};
     Material material;
     Ray ray; // incoming ray that creates intersection
+    const Primitive *primitive{nullptr}; // set by the accelerators, see intersectPrimitive
 };
 
 } // namespace sw
@@ -0,0 +1,208 @@
+#include "swKdTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sw {
+
+namespace {
+
+struct BoundEdge {
+    enum Type { Start, End };
+
+    float t;
+    uint32_t primNum;
+    Type type;
+
+    bool operator<(const BoundEdge &e) const { return t == e.t ? type < e.type : t < e.t; }
+};
+
+} // namespace
+
+void KdTreeAccelerator::Node::initLeaf(const std::vector<uint32_t> &primNums,
+                                       std::vector<uint32_t> &primitiveIndices) {
+    flags = 3;
+    nPrims |= static_cast<uint32_t>(primNums.size()) << 2;
+    if (primNums.empty())
+        onePrimitive = 0;
+    else if (primNums.size() == 1)
+        onePrimitive = primNums[0];
+    else {
+        primitiveOffset = static_cast<uint32_t>(primitiveIndices.size());
+        primitiveIndices.insert(primitiveIndices.end(), primNums.begin(), primNums.end());
+    }
+}
+
+void KdTreeAccelerator::Node::initInterior(int axis, uint32_t aboveChild, float s) {
+    split = s;
+    flags = static_cast<uint32_t>(axis);
+    above |= aboveChild << 2;
+}
+
+void KdTreeAccelerator::build(const std::vector<std::shared_ptr<Primitive>> &primitives) {
+    prims.clear();
+    nodes.clear();
+    primitiveIndices.clear();
+    bounds = AABB();
+    primBounds.clear();
+    for (auto &primitive : primitives) {
+        prims.push_back(primitive.get());
+        primBounds.push_back(primitive->bounds());
+        bounds.extend(primBounds.back());
+    }
+    if (prims.empty()) return;
+
+    const int maxDepth =
+      std::min(static_cast<int>(std::lround(8.0 + 1.3 * std::log2(static_cast<double>(prims.size())))), 60);
+    std::vector<uint32_t> primNums(prims.size());
+    for (uint32_t i = 0; i < primNums.size(); ++i) primNums[i] = i;
+    buildNode(bounds, primNums, maxDepth, 0);
+
+    std::vector<AABB>().swap(primBounds);
+    nodes.shrink_to_fit();
+}
+
+void KdTreeAccelerator::buildNode(const AABB &nodeBounds, std::vector<uint32_t> &primNums, int depth,
+                                  int badRefines) {
+    const uint32_t nodeNum = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node());
+
+    const int n = static_cast<int>(primNums.size());
+    if (n <= maxPrims || depth == 0) {
+        nodes[nodeNum].initLeaf(primNums, primitiveIndices);
+        return;
+    }
+
+    // Sweep the sorted box edges of each axis, largest first, for the cheapest split.
+    int bestAxis = -1, bestOffset = -1;
+    float bestCost = FLT_MAX;
+    const float oldCost = static_cast<float>(isectCost * n);
+    const float invTotalSA = 1.0f / nodeBounds.surfaceArea();
+    const Vec3 d = nodeBounds.extent();
+    std::vector<BoundEdge> edges[3];
+
+    int axis = nodeBounds.maxAxis();
+    for (int retries = 0; retries < 3 && bestAxis == -1; ++retries, axis = (axis + 1) % 3) {
+        std::vector<BoundEdge> &axisEdges = edges[axis];
+        axisEdges.resize(2 * n);
+        for (int i = 0; i < n; ++i) {
+            const AABB &b = primBounds[primNums[i]];
+            axisEdges[2 * i] = BoundEdge{b.lower[axis], primNums[i], BoundEdge::Start};
+            axisEdges[2 * i + 1] = BoundEdge{b.upper[axis], primNums[i], BoundEdge::End};
+        }
+        std::sort(axisEdges.begin(), axisEdges.end());
+
+        int nBelow = 0, nAbove = n;
+        const int otherAxis0 = (axis + 1) % 3, otherAxis1 = (axis + 2) % 3;
+        for (int i = 0; i < 2 * n; ++i) {
+            if (axisEdges[i].type == BoundEdge::End) --nAbove;
+            const float edgeT = axisEdges[i].t;
+            if (edgeT > nodeBounds.lower[axis] && edgeT < nodeBounds.upper[axis]) {
+                const float belowSA = 2.0f * (d[otherAxis0] * d[otherAxis1] +
+                                              (edgeT - nodeBounds.lower[axis]) * (d[otherAxis0] + d[otherAxis1]));
+                const float aboveSA = 2.0f * (d[otherAxis0] * d[otherAxis1] +
+                                              (nodeBounds.upper[axis] - edgeT) * (d[otherAxis0] + d[otherAxis1]));
+                const float pBelow = belowSA * invTotalSA, pAbove = aboveSA * invTotalSA;
+                const float eb = (nAbove == 0 || nBelow == 0) ? emptyBonus : 0.0f;
+                const float cost = traversalCost + isectCost * (1.0f - eb) * (pBelow * nBelow + pAbove * nAbove);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestOffset = i;
+                }
+            }
+            if (axisEdges[i].type == BoundEdge::Start) ++nBelow;
+        }
+    }
+
+    if (bestCost > oldCost) ++badRefines;
+    if ((bestCost > 4.0f * oldCost && n < 16) || bestAxis == -1 || badRefines == 3) {
+        nodes[nodeNum].initLeaf(primNums, primitiveIndices);
+        return;
+    }
+
+    std::vector<uint32_t> below, above;
+    const std::vector<BoundEdge> &axisEdges = edges[bestAxis];
+    for (int i = 0; i < bestOffset; ++i)
+        if (axisEdges[i].type == BoundEdge::Start) below.push_back(axisEdges[i].primNum);
+    for (int i = bestOffset + 1; i < 2 * n; ++i)
+        if (axisEdges[i].type == BoundEdge::End) above.push_back(axisEdges[i].primNum);
+    const float split = axisEdges[bestOffset].t;
+    std::vector<uint32_t>().swap(primNums);
+    for (auto &e : edges) std::vector<BoundEdge>().swap(e);
+
+    AABB bounds0 = nodeBounds, bounds1 = nodeBounds;
+    bounds0.upper.m[bestAxis] = split;
+    bounds1.lower.m[bestAxis] = split;
+    buildNode(bounds0, below, depth - 1, badRefines);
+    const uint32_t aboveChild = static_cast<uint32_t>(nodes.size());
+    nodes[nodeNum].initInterior(bestAxis, aboveChild, split);
+    buildNode(bounds1, above, depth - 1, badRefines);
+}
+
+bool KdTreeAccelerator::intersect(const Ray &r, Intersection &isect, bool any) const {
+    if (nodes.empty()) return false;
+
+    Ray ray = r;
+    const Vec3 invDir = reciprocal(ray.dir);
+    float tMin = ray.minT, tMax = ray.maxT;
+    if (!bounds.intersect(ray, invDir, tMin, tMax)) return false;
+
+    struct Todo {
+        const Node *node;
+        float tMin, tMax;
+    };
+    Todo todo[64];
+    int todoPos = 0;
+
+    Mailbox mailbox;
+    bool hit = false;
+    const Node *node = &nodes[0];
+    while (node != nullptr) {
+        if (ray.maxT < tMin) break;
+        SW_STAT(nodeVisits++);
+        if (!node->isLeaf()) {
+            const int axis = node->splitAxis();
+            const float tPlane = (node->split - ray.orig[axis]) * invDir[axis];
+
+            const bool belowFirst =
+              (ray.orig[axis] < node->split) || (ray.orig[axis] == node->split && ray.dir[axis] <= 0.0f);
+            const Node *firstChild = belowFirst ? node + 1 : &nodes[node->aboveChild()];
+            const Node *secondChild = belowFirst ? &nodes[node->aboveChild()] : node + 1;
+
+            if (tPlane > tMax || tPlane <= 0.0f)
+                node = firstChild;
+            else if (tPlane < tMin)
+                node = secondChild;
+            else {
+                todo[todoPos++] = Todo{secondChild, tPlane, tMax};
+                node = firstChild;
+                tMax = tPlane;
+            }
+        } else {
+            const uint32_t count = node->primitiveCount();
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t prim = count == 1 ? node->onePrimitive : primitiveIndices[node->primitiveOffset + i];
+                if (!mailbox.visit(prim)) continue;
+                if (intersectPrimitive(*prims[prim], ray, isect)) {
+                    hit = true;
+                    if (any) return true;
+                }
+            }
+
+            if (todoPos == 0) break;
+            --todoPos;
+            node = todo[todoPos].node;
+            tMin = todo[todoPos].tMin;
+            tMax = todo[todoPos].tMax;
+        }
+    }
+    return hit;
+}
+
+size_t KdTreeAccelerator::memoryUsage() const {
+    return nodes.capacity() * sizeof(Node) + primitiveIndices.capacity() * sizeof(uint32_t) +
+           prims.capacity() * sizeof(const Primitive *);
+}
+
+} // namespace sw
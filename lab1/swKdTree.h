@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swAABB.h"
+#include "swAccelerator.h"
+
+namespace sw {
+
+// SAH kd-tree built with sorted split candidates at every node, after
+// "Physically Based Rendering", with 8-byte nodes.
+class KdTreeAccelerator : public Accelerator {
+  public:
+    void build(const std::vector<std::shared_ptr<Primitive>> &primitives);
+    bool intersect(const Ray &r, Intersection &isect, bool any) const;
+    size_t memoryUsage() const;
+
+  public:
+    int isectCost{80};
+    int traversalCost{1};
+    float emptyBonus{0.5f};
+    int maxPrims{1};
+
+  private:
+    struct Node {
+        void initLeaf(const std::vector<uint32_t> &primNums, std::vector<uint32_t> &primitiveIndices);
+        void initInterior(int axis, uint32_t aboveChild, float s);
+
+        bool isLeaf() const { return (flags & 3) == 3; }
+        int splitAxis() const { return flags & 3; }
+        uint32_t primitiveCount() const { return nPrims >> 2; }
+        uint32_t aboveChild() const { return above >> 2; }
+
+        union {
+            float split;              // interior
+            uint32_t onePrimitive;    // leaf with a single primitive
+            uint32_t primitiveOffset; // leaf, into primitiveIndices
+        };
+        union {
+            uint32_t flags; // low two bits: split axis, 3 for leaves
+            uint32_t nPrims;
+            uint32_t above;
+        };
+    };
+
+    void buildNode(const AABB &nodeBounds, std::vector<uint32_t> &primNums, int depth, int badRefines);
+
+    AABB bounds;
+    std::vector<AABB> primBounds; // only during build
+    std::vector<Node> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    std::vector<const Primitive *> prims;
+};
+
+} // namespace sw
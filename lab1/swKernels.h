@@ -0,0 +1,64 @@
+#pragma once
+
+#include "swSimd.h"
+
+namespace sw {
+
+// Intersection kernels written once over N lanes. Every argument is per
+// lane, so the same code tests N rays against one primitive, one ray
+// (broadcast) against N primitives, or a single ray with N = 1. A lane hits
+// when its mask is set and t is then the hit distance in [minT, maxT].
+
+template <int N>
+MaskN<N> intersectSphereN(const Vec3xN<N> &orig, const Vec3xN<N> &dir, const FloatN<N> &minT, const FloatN<N> &maxT,
+                          const Vec3xN<N> &center, const FloatN<N> &radius, FloatN<N> &t) {
+    const Vec3xN<N> o = orig - center;
+    const FloatN<N> A = dot(dir, dir);
+    const FloatN<N> B = FloatN<N>(2.0f) * dot(dir, o);
+    const FloatN<N> C = dot(o, o) - radius * radius;
+    const FloatN<N> disc = B * B - FloatN<N>(4.0f) * A * C;
+    const FloatN<N> root = sqrt(max(disc, FloatN<N>(0.0f)));
+    const FloatN<N> inv2A = FloatN<N>(0.5f) / A;
+    const FloatN<N> t0 = (-B - root) * inv2A;
+    const FloatN<N> t1 = (-B + root) * inv2A;
+    // The far root counts when the ray starts inside the sphere.
+    t = select(t0 >= minT, t0, t1);
+    return (disc >= FloatN<N>(0.0f)) & (t >= minT) & (t <= maxT);
+}
+
+// Moller-Trumbore; normal is the unnormalized geometric normal (b - a) x (c - a).
+template <int N>
+MaskN<N> intersectTriangleN(const Vec3xN<N> &orig, const Vec3xN<N> &dir, const FloatN<N> &minT, const FloatN<N> &maxT,
+                            const Vec3xN<N> &a, const Vec3xN<N> &b, const Vec3xN<N> &c, FloatN<N> &t,
+                            Vec3xN<N> &normal) {
+    const Vec3xN<N> e1 = b - a, e2 = c - a;
+    const Vec3xN<N> p = cross(dir, e2);
+    const FloatN<N> det = dot(e1, p);
+    const FloatN<N> invDet = FloatN<N>(1.0f) / det;
+    const Vec3xN<N> s = orig - a;
+    const FloatN<N> u = dot(s, p) * invDet;
+    const Vec3xN<N> q = cross(s, e1);
+    const FloatN<N> v = dot(dir, q) * invDet;
+    t = dot(e2, q) * invDet;
+    normal = cross(e1, e2);
+    // Comparisons with the NaNs of a zero determinant fail, so those lanes miss.
+    const FloatN<N> zero(0.0f), one(1.0f);
+    return (u >= zero) & (v >= zero) & (u + v <= one) & (t >= minT) & (t <= maxT);
+}
+
+// Slab test of N boxes; tNear is where each lane enters its box.
+template <int N>
+MaskN<N> intersectBoxN(const Vec3xN<N> &orig, const Vec3xN<N> &invDir, const FloatN<N> &minT, const FloatN<N> &maxT,
+                       const Vec3xN<N> &lower, const Vec3xN<N> &upper, FloatN<N> &tNear) {
+    const Vec3xN<N> tLower = Vec3xN<N>((lower.x - orig.x) * invDir.x, (lower.y - orig.y) * invDir.y,
+                                       (lower.z - orig.z) * invDir.z);
+    const Vec3xN<N> tUpper = Vec3xN<N>((upper.x - orig.x) * invDir.x, (upper.y - orig.y) * invDir.y,
+                                       (upper.z - orig.z) * invDir.z);
+    const Vec3xN<N> tMin = min(tLower, tUpper), tMax = max(tLower, tUpper);
+    // NaN slabs (a zero direction through a box face) come first so min/max skip them.
+    tNear = max(tMin.z, max(tMin.y, max(tMin.x, minT)));
+    const FloatN<N> tFar = min(tMax.z, min(tMax.y, min(tMax.x, maxT)));
+    return tNear <= tFar;
+}
+
+} // namespace sw
@@ -0,0 +1,98 @@
+#include "swMappedFile.h"
+
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sw {
+
+MappedFile &MappedFile::operator=(MappedFile &&m) {
+    if (this != &m) {
+        close();
+        ptr = m.ptr;
+        length = m.length;
+        m.ptr = nullptr;
+        m.length = 0;
+    }
+    return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        std::cerr << "Could not map empty file " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    // The view keeps the mapping alive, so both handles can be closed right away.
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    if (view == nullptr) {
+        std::cerr << "Could not map " << path << std::endl;
+        return false;
+    }
+    ptr = static_cast<const uint8_t *>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) UnmapViewOfFile(ptr);
+    ptr = nullptr;
+    length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "Could not map empty file " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    // The mapping keeps its own reference to the file.
+    void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Could not map " << path << std::endl;
+        return false;
+    }
+    ptr = static_cast<const uint8_t *>(view);
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) munmap(const_cast<uint8_t *>(ptr), length);
+    ptr = nullptr;
+    length = 0;
+}
+
+#endif
+
+} // namespace sw
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sw {
+
+// Read-only memory mapping of a whole file. Pages are read by the OS on
+// first access and can be dropped again under memory pressure, so only
+// the parts actually touched stay resident.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&m) : ptr(m.ptr), length(m.length) {
+        m.ptr = nullptr;
+        m.length = 0;
+    }
+    ~MappedFile() { close(); }
+
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile &operator=(MappedFile &&m);
+
+    bool open(const std::string &path);
+    void close();
+
+    const uint8_t *data() const { return ptr; }
+    size_t size() const { return length; }
+
+  private:
+    const uint8_t *ptr{nullptr};
+    size_t length{0};
+};
+
+} // namespace sw
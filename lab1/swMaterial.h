@@ -4,6 +4,17 @@
 
 namespace sw {
 
+// Terms of the shading of a material. Its class is the set of terms with a
+// non-zero weight, e.g. DirectTerm for diffuse materials, DirectTerm |
+// ReflectedTerm for mirror-like ones and all three for dielectrics, so that
+// shading kernels can be specialised per class.
+enum MaterialTerm : unsigned {
+    DirectTerm = 1u << 0,
+    ReflectedTerm = 1u << 1,
+    RefractedTerm = 1u << 2,
+};
+const unsigned NumMaterialClasses = 8;
+
 class Material {
   public:
     Material() = default;
@@ -11,6 +22,11 @@ class Material {
     Material(const Vec3 &c, float r = 0, float t = 0, float i = 1)
       : color{c}, reflectivity(r), transparency(t), refractiveIndex(i) {}
 
+    unsigned shadingClass() const {
+        return (reflectivity + transparency < 1.0f ? DirectTerm : 0u) | (reflectivity > 0.0f ? ReflectedTerm : 0u) |
+               (transparency > 0.0f ? RefractedTerm : 0u);
+    }
+
   public:
     Vec3 color;
     float reflectivity{0.0f};
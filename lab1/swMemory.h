@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace sw {
+
+const size_t CacheLineSize = 64;
+
+inline void *alignedAlloc(size_t size, size_t alignment) {
+#if defined(_WIN32)
+    void *p = _aligned_malloc(size, alignment);
+#else
+    void *p = nullptr;
+    if (posix_memalign(&p, alignment, size) != 0) p = nullptr;
+#endif
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+inline void alignedFree(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// Allocator for std::vector storage that has to start on a cache line,
+// as operator new only guarantees 16-byte alignment before C++17.
+template <typename T, size_t Alignment = CacheLineSize> class AlignedAllocator {
+  public:
+    typedef T value_type;
+
+    template <typename U> struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(alignedAlloc(n * sizeof(T), Alignment)); }
+    void deallocate(T *p, size_t) { alignedFree(p); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+} // namespace sw
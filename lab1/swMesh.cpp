@@ -0,0 +1,233 @@
+#include "swMesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "swKernels.h"
+#include "swRasterizer.h"
+
+namespace sw {
+
+static_assert(sizeof(Vec3) == 3 * sizeof(float), "Vec3 is stored as three floats in mesh files");
+static_assert(sizeof(BVHNode) == 32, "BVHNode is stored as is in mesh files");
+
+namespace {
+
+const char MeshMagic[4] = {'S', 'W', 'M', 'F'};
+
+uint64_t alignSection(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+
+// Returns the depth of the deepest leaf, or -1 unless the nodes form a tree
+// laid out depth-first, no deeper than BVH::MaxDepth, whose leaves stay
+// within the triangles.
+int checkTree(const BVHNode *nodes, uint32_t numNodes, uint32_t numTriangles) {
+    struct Pending {
+        uint32_t node;
+        int depth;
+    };
+    std::vector<Pending> pending{{0, 0}};
+    uint32_t next = 0; // nodes are visited in the order they are stored
+    int maxDepth = 0;
+    while (!pending.empty()) {
+        const Pending p = pending.back();
+        pending.pop_back();
+        if (p.node != next++ || p.depth > BVH::MaxDepth) return -1;
+        maxDepth = std::max(maxDepth, p.depth);
+        const BVHNode &node = nodes[p.node];
+        if (node.count > 0) {
+            if (node.offset > numTriangles || node.count > numTriangles - node.offset) return -1;
+        } else {
+            if (node.offset <= p.node + 1 || node.offset >= numNodes || node.axis > 2) return -1;
+            pending.push_back(Pending{node.offset, p.depth + 1});
+            pending.push_back(Pending{p.node + 1, p.depth + 1});
+        }
+    }
+    return next == numNodes ? maxDepth : -1;
+}
+
+} // namespace
+
+bool writeMeshFile(const std::string &path, const std::vector<Vec3> &vertices, const std::vector<uint32_t> &indices) {
+    const size_t numTriangles = indices.size() / 3;
+    std::vector<AABB> bounds(numTriangles);
+    for (size_t t = 0; t < numTriangles; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = indices[3 * t + k];
+            if (v >= vertices.size()) {
+                std::cerr << "Triangle " << t << " of " << path << " uses missing vertex " << v << std::endl;
+                return false;
+            }
+            bounds[t].extend(vertices[v]);
+        }
+    }
+    BVH bvh;
+    bvh.build(bounds);
+
+    // Triangles in leaf order, vertices renumbered by first use.
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vec3> outVertices;
+    std::vector<uint32_t> outTriangles;
+    outVertices.reserve(vertices.size());
+    outTriangles.reserve(3 * numTriangles);
+    for (uint32_t t : bvh.indices) {
+        for (int k = 0; k < 3; ++k) {
+            const uint32_t v = indices[3 * t + k];
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = static_cast<uint32_t>(outVertices.size());
+                outVertices.push_back(vertices[v]);
+            }
+            outTriangles.push_back(remap[v]);
+        }
+    }
+
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MeshMagic, sizeof(MeshMagic));
+    header.version = MeshFileHeader::Version;
+    header.numVertices = static_cast<uint32_t>(outVertices.size());
+    header.numTriangles = static_cast<uint32_t>(numTriangles);
+    header.numNodes = static_cast<uint32_t>(bvh.nodes.size());
+    header.depth = bvh.nodes.empty() ? 0 : static_cast<uint32_t>(checkTree(bvh.nodes.data(), header.numNodes, header.numTriangles));
+    header.nodeOffset = alignSection(sizeof(header));
+    header.triangleOffset = alignSection(header.nodeOffset + bvh.nodes.size() * sizeof(BVHNode));
+    header.vertexOffset = alignSection(header.triangleOffset + outTriangles.size() * sizeof(uint32_t));
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Could not create " << path << std::endl;
+        return false;
+    }
+    auto padTo = [&](uint64_t offset) {
+        static const char zeros[64] = {0};
+        file.write(zeros, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    padTo(header.nodeOffset);
+    file.write(reinterpret_cast<const char *>(bvh.nodes.data()), bvh.nodes.size() * sizeof(BVHNode));
+    padTo(header.triangleOffset);
+    file.write(reinterpret_cast<const char *>(outTriangles.data()), outTriangles.size() * sizeof(uint32_t));
+    padTo(header.vertexOffset);
+    file.write(reinterpret_cast<const char *>(outVertices.data()), outVertices.size() * sizeof(Vec3));
+    if (!file) {
+        std::cerr << "Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Mesh::open(const std::string &path, const Material &m, bool verify) {
+    material = m;
+    nodes = nullptr;
+    triangles = nullptr;
+    vertices = nullptr;
+    numNodes = numTriangles = numVertices = 0;
+    if (!file.open(path)) return false;
+
+    MeshFileHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << path << " is not a mesh file" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MeshMagic, sizeof(MeshMagic)) != 0 || header.version != MeshFileHeader::Version) {
+        std::cerr << path << " is not a version " << MeshFileHeader::Version << " mesh file" << std::endl;
+        return false;
+    }
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % 64 == 0 && offset <= file.size() && bytes <= file.size() - offset;
+    };
+    if (!fits(header.nodeOffset, uint64_t(header.numNodes) * sizeof(BVHNode)) ||
+        !fits(header.triangleOffset, uint64_t(header.numTriangles) * 3 * sizeof(uint32_t)) ||
+        !fits(header.vertexOffset, uint64_t(header.numVertices) * sizeof(Vec3))) {
+        std::cerr << path << " is truncated" << std::endl;
+        return false;
+    }
+    if (header.depth > static_cast<uint32_t>(BVH::MaxDepth)) {
+        std::cerr << path << " has a BVH deeper than " << BVH::MaxDepth << " levels" << std::endl;
+        return false;
+    }
+
+    // Reads every node and triangle, which is what opening avoids otherwise.
+    const BVHNode *fileNodes = reinterpret_cast<const BVHNode *>(file.data() + header.nodeOffset);
+    const uint32_t *fileTriangles = reinterpret_cast<const uint32_t *>(file.data() + header.triangleOffset);
+    if (verify) {
+        const int depth = header.numNodes > 0 ? checkTree(fileNodes, header.numNodes, header.numTriangles) : 0;
+        if (depth < 0 || static_cast<uint32_t>(depth) != header.depth) {
+            std::cerr << path << " has an invalid BVH" << std::endl;
+            return false;
+        }
+        const uint32_t *trianglesEnd = fileTriangles + 3 * static_cast<size_t>(header.numTriangles);
+        if (std::any_of(fileTriangles, trianglesEnd, [&](uint32_t v) { return v >= header.numVertices; })) {
+            std::cerr << path << " has triangles using missing vertices" << std::endl;
+            return false;
+        }
+    }
+
+    nodes = fileNodes;
+    triangles = fileTriangles;
+    vertices = reinterpret_cast<const Vec3 *>(file.data() + header.vertexOffset);
+    numNodes = header.numNodes;
+    numTriangles = header.numTriangles;
+    numVertices = header.numVertices;
+    return true;
+}
+
+bool Mesh::intersect(const Ray &r, Intersection &isect) const {
+    if (numNodes == 0) return false;
+
+    float tBest = r.maxT;
+    Vec3 normal;
+    auto leaf = [&](uint32_t t, Ray &ray) {
+        SW_STAT(primitiveTests++);
+        const uint32_t *tri = triangleVertices(t);
+        if (tri == nullptr) return false;
+        FloatN<1> hitT;
+        Vec3xN<1> n;
+        if (!intersectTriangleN<1>(ray.orig, ray.dir, ray.minT, ray.maxT, vertices[tri[0]], vertices[tri[1]],
+                                   vertices[tri[2]], hitT, n)[0])
+            return false;
+        tBest = ray.maxT = hitT[0];
+        normal = n.get(0);
+        return true;
+    };
+    if (!BVH::traverseBVH(nodes, r, false, leaf, nullptr, numNodes)) return false;
+
+    setIntersection(r, tBest, normal, isect);
+    return true;
+}
+
+bool Mesh::intersectElement(uint32_t triangle, const Ray &r, Intersection &isect) const {
+    const uint32_t *tri = triangleVertices(triangle);
+    if (tri == nullptr) return false;
+    FloatN<1> t;
+    Vec3xN<1> n;
+    if (!intersectTriangleN<1>(r.orig, r.dir, r.minT, r.maxT, vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], t,
+                               n)[0])
+        return false;
+    setIntersection(r, t[0], n.get(0), isect);
+    return true;
+}
+
+bool Mesh::rasterize(Rasterizer &r) const {
+    for (uint32_t t = 0; t < numTriangles; ++t) {
+        const uint32_t *tri = triangleVertices(t);
+        if (tri == nullptr) continue;
+        r.addTriangle(t, vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]);
+    }
+    return true;
+}
+
+void Mesh::setIntersection(const Ray &r, float t, const Vec3 &normal, Intersection &isect) const {
+    isect.hitT = t;
+    isect.normal = normal;
+    isect.normal.normalize();
+    isect.frontFacing = (-r.dir * isect.normal) > 0.0f;
+    if (!isect.frontFacing) isect.normal = -isect.normal;
+    isect.position = r.orig + t * r.dir;
+    isect.material = material;
+    isect.ray = r;
+}
+
+} // namespace sw
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "swBVH.h"
+#include "swIntersection.h"
+#include "swMappedFile.h"
+#include "swPrimitive.h"
+
+namespace sw {
+
+// Header of a .swm mesh file. The sections follow in traversal order, each
+// starting on a 64-byte boundary: the BVH nodes depth-first, the triangles
+// in BVH leaf order and the vertices in order of first use by those
+// triangles, so a subtree's nodes and geometry sit next to each other.
+struct MeshFileHeader {
+    static const uint32_t Version = 2;
+
+    char magic[4]; // "SWMF"
+    uint32_t version;
+    uint32_t numVertices, numTriangles, numNodes;
+    uint32_t depth; // of the deepest BVH leaf, at most BVH::MaxDepth
+    uint64_t nodeOffset, triangleOffset, vertexOffset; // in bytes from the file start
+};
+
+// Builds the BVH over an indexed triangle list and writes it with the mesh.
+bool writeMeshFile(const std::string &path, const std::vector<Vec3> &vertices, const std::vector<uint32_t> &indices);
+
+// Triangle mesh read straight from a memory-mapped .swm file, traversing
+// the BVH stored in it. Opening only checks the header and section sizes,
+// so that nothing else is paged in before rays reach it; node, triangle and
+// vertex indices are bounds-checked as they are used, so a corrupt file
+// renders wrong but stays within the mapping. With verify, open() also
+// walks the whole tree and every triangle, as mesh_convert --verify does.
+class Mesh : public Primitive {
+  public:
+    Mesh() = default;
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
+
+    bool open(const std::string &path, const Material &m, bool verify = false);
+
+    bool intersect(const Ray &r, Intersection &isect) const;
+    bool intersectElement(uint32_t triangle, const Ray &r, Intersection &isect) const;
+    bool rasterize(Rasterizer &r) const;
+    AABB bounds() const { return numNodes > 0 ? nodes[0].bounds : AABB(); }
+    uint32_t triangleCount() const { return numTriangles; }
+    size_t nodeBytes() const { return numNodes * sizeof(BVHNode); }
+
+  public:
+    Material material;
+
+  private:
+    // Vertex indices of a triangle, or nullptr if it is out of range or
+    // uses missing vertices.
+    const uint32_t *triangleVertices(uint32_t t) const {
+        if (t >= numTriangles) return nullptr;
+        const uint32_t *tri = triangles + 3 * static_cast<size_t>(t);
+        return tri[0] < numVertices && tri[1] < numVertices && tri[2] < numVertices ? tri : nullptr;
+    }
+    void setIntersection(const Ray &r, float t, const Vec3 &normal, Intersection &isect) const;
+
+    MappedFile file;
+    const BVHNode *nodes{nullptr};
+    const uint32_t *triangles{nullptr}; // three vertex indices each
+    const Vec3 *vertices{nullptr};
+    uint32_t numNodes{0}, numTriangles{0}, numVertices{0};
+};
+
+} // namespace sw
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "swStats.h"
+
+namespace sw {
+
+inline unsigned hardwareThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Calls fn(i) for every i in [begin, end), handing out chunks of indices to a
+// pool of worker threads. Runs inline when there is a single thread or item.
+// Every worker flushes its statistics counters when it runs out of work.
+template <typename Fn> void parallelFor(int begin, int end, Fn fn, int chunk = 1, unsigned numThreads = 0) {
+    if (end <= begin) return;
+    if (numThreads == 0) numThreads = hardwareThreads();
+    chunk = std::max(chunk, 1);
+    int numChunks = (end - begin + chunk - 1) / chunk;
+    numThreads = std::min(numThreads, static_cast<unsigned>(numChunks));
+
+    std::atomic<int> next(begin);
+    auto worker = [&]() {
+        for (;;) {
+            int first = next.fetch_add(chunk);
+            if (first >= end) {
+                flushThreadStats();
+                return;
+            }
+            int last = std::min(first + chunk, end);
+            for (int i = first; i < last; ++i) fn(i);
+        }
+    };
+
+    if (numThreads <= 1) {
+        worker();
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (unsigned t = 1; t < numThreads; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads) t.join();
+}
+
+} // namespace sw
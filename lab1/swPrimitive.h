@@ -1,14 +1,35 @@
 #pragma once
 
+#include <cstdint>
+
+#include "swAABB.h"
+#include "swIntersection.h"
 #include "swMaterial.h"
 
 namespace sw {
 
+class Rasterizer;
+
 class Primitive {
   public:
     virtual ~Primitive() {}
 
     virtual bool intersect(const Ray &r, Intersection &isect) const = 0;
+    // Bounds over the whole shutter interval of a moving primitive.
+    virtual AABB bounds() const = 0;
+
+    // Primitives that move linearly between two keyframes at Ray::time 0
+    // and 1. Their bounds at a time in between are lerp(boundsAt(0),
+    // boundsAt(1), time) or smaller, which the BVH relies on.
+    virtual bool moving() const { return false; }
+    virtual AABB boundsAt(float) const { return bounds(); }
+
+    // Hands the primitive's triangles or spheres to the rasterizer, false if
+    // it has no such shape.
+    virtual bool rasterize(Rasterizer &) const { return false; }
+    // Intersects one of the elements passed to the rasterizer, e.g. a single
+    // triangle of a mesh.
+    virtual bool intersectElement(uint32_t, const Ray &r, Intersection &isect) const { return intersect(r, isect); }
 
   public:
     Material material;
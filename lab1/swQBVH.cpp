@@ -0,0 +1,275 @@
+#include "swQBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "swKernels.h"
+
+namespace sw {
+
+namespace {
+
+const int MaxDepth = BVH::MaxDepth; // collapsing the binary BVH only makes it shallower
+// Levels splitLeaf() adds below a binary leaf: at least 4 ways each, a leaf
+// of up to 0xffff primitives ends in parts of fewer than 255 after 5.
+const int MaxSplitDepth = 5;
+
+// 2^e for e in [-126, 127], built from its bits.
+inline float exp2i(int e) {
+    const uint32_t bits = static_cast<uint32_t>(e + 127) << 23;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Smallest exponent for which 255 steps from lo cover hi.
+int quantizationExponent(float lo, float hi) {
+    const float extent = hi - lo;
+    int e = extent > 0.0f ? static_cast<int>(std::ceil(std::log2(extent / 255.0f))) : -126;
+    e = std::min(std::max(e, -126), 127);
+    while (e < 127 && lo + 255.0f * exp2i(e) < hi) ++e;
+    return e;
+}
+
+// Outward-rounded quantization of [lo, hi] inside [origin, origin + 255 * scale].
+void quantize(float origin, float scale, float lo, float hi, uint8_t &qLo, uint8_t &qHi) {
+    int l = std::min(std::max(static_cast<int>(std::floor((lo - origin) / scale)), 0), 255);
+    while (l > 0 && origin + l * scale > lo) --l;
+    int h = std::min(std::max(static_cast<int>(std::ceil((hi - origin) / scale)), 0), 255);
+    while (h < 255 && origin + h * scale < hi) ++h;
+    qLo = static_cast<uint8_t>(l);
+    qHi = static_cast<uint8_t>(h);
+}
+
+// Zeroes node and sets it up to quantize boxes inside bounds.
+template <int Width> void initNode(QuantizedBVHNode<Width> &node, const AABB &bounds, float scale[3]) {
+    std::memset(&node, 0, sizeof(node));
+    for (int a = 0; a < 3; ++a) {
+        node.origin[a] = bounds.lower[a];
+        node.exponent[a] = static_cast<int8_t>(quantizationExponent(bounds.lower[a], bounds.upper[a]));
+        scale[a] = exp2i(node.exponent[a]);
+    }
+}
+
+template <int Width> AABB childBounds(const QuantizedBVHNode<Width> &node, int i) {
+    AABB b;
+    for (int a = 0; a < 3; ++a) {
+        const float scale = exp2i(node.exponent[a]);
+        b.lower.m[a] = node.origin[a] + node.lower[a][i] * scale;
+        b.upper.m[a] = node.origin[a] + node.upper[a][i] * scale;
+    }
+    return b;
+}
+
+} // namespace
+
+template <int Width> void QuantizedBVHAccelerator<Width>::build(const std::vector<std::shared_ptr<Primitive>> &primitives) {
+    nodes.clear();
+    prims.clear();
+
+    std::vector<AABB> bounds;
+    bounds.reserve(primitives.size());
+    for (auto &primitive : primitives) bounds.push_back(primitive->bounds());
+    BVH bvh;
+    bvh.build(bounds);
+    if (bvh.nodes.empty()) return;
+
+    prims.reserve(primitives.size());
+    for (uint32_t i : bvh.indices) prims.push_back(primitives[i].get());
+
+    nodes.reserve(bvh.nodes.size() / (Width - 1) + 1);
+    collapse(bvh, 0);
+    nodes.shrink_to_fit();
+}
+
+template <int Width> uint32_t QuantizedBVHAccelerator<Width>::collapse(const BVH &bvh, uint32_t binaryNode) {
+    const BVHNode &parent = bvh.nodes[binaryNode];
+
+    // Gather up to Width binary nodes below this one, a lone leaf becomes the only child.
+    uint32_t children[Width];
+    int numChildren = 0;
+    if (parent.count > 0) {
+        children[numChildren++] = binaryNode;
+    } else {
+        children[numChildren++] = binaryNode + 1;
+        children[numChildren++] = parent.offset;
+    }
+    while (numChildren < Width) {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for (int i = 0; i < numChildren; ++i) {
+            const BVHNode &child = bvh.nodes[children[i]];
+            if (child.count == 0 && child.bounds.surfaceArea() > largestArea) {
+                largest = i;
+                largestArea = child.bounds.surfaceArea();
+            }
+        }
+        if (largest < 0) break;
+        const uint32_t opened = children[largest];
+        children[largest] = opened + 1;
+        children[numChildren++] = bvh.nodes[opened].offset;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node());
+
+    Node node;
+    float scale[3];
+    initNode(node, parent.bounds, scale);
+    for (int i = 0; i < Width; ++i) {
+        if (i >= numChildren) {
+            node.count[i] = Node::EmptyChild;
+            continue;
+        }
+        const BVHNode &child = bvh.nodes[children[i]];
+        for (int a = 0; a < 3; ++a)
+            quantize(node.origin[a], scale[a], child.bounds.lower[a], child.bounds.upper[a], node.lower[a][i],
+                     node.upper[a][i]);
+        if (child.count >= Node::EmptyChild) {
+            node.child[i] = splitLeaf(child.bounds, child.offset, child.count);
+            node.count[i] = 0;
+        } else if (child.count > 0) {
+            node.child[i] = child.offset;
+            node.count[i] = static_cast<uint8_t>(child.count);
+        } else {
+            node.child[i] = collapse(bvh, children[i]);
+            node.count[i] = 0;
+        }
+    }
+    nodes[index] = node;
+    return index;
+}
+
+template <int Width>
+uint32_t QuantizedBVHAccelerator<Width>::splitLeaf(const AABB &bounds, uint32_t first, uint32_t count) {
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node());
+
+    // Every part keeps the bounds of the whole leaf, those of its own
+    // primitives are not known here.
+    Node node;
+    float scale[3];
+    initNode(node, bounds, scale);
+    const uint32_t partCount = (count + Width - 1) / Width;
+    for (int i = 0; i < Width; ++i) {
+        const uint32_t begin = std::min(count, i * partCount), end = std::min(count, begin + partCount);
+        if (begin == end) {
+            node.count[i] = Node::EmptyChild;
+            continue;
+        }
+        for (int a = 0; a < 3; ++a)
+            quantize(node.origin[a], scale[a], bounds.lower[a], bounds.upper[a], node.lower[a][i], node.upper[a][i]);
+        if (end - begin >= Node::EmptyChild) {
+            node.child[i] = splitLeaf(bounds, first + begin, end - begin);
+            node.count[i] = 0;
+        } else {
+            node.child[i] = first + begin;
+            node.count[i] = static_cast<uint8_t>(end - begin);
+        }
+    }
+    nodes[index] = node;
+    return index;
+}
+
+template <int Width> bool QuantizedBVHAccelerator<Width>::intersect(const Ray &r, Intersection &isect, bool any) const {
+    if (nodes.empty()) return false;
+
+    Ray ray = r;
+    const Vec3xN<Width> orig(ray.orig), invDir(reciprocal(ray.dir));
+
+    struct Entry {
+        uint32_t child, count;
+        float t; // entry distance, lets entries behind a closer hit be dropped
+    };
+    Entry stack[(MaxDepth + MaxSplitDepth) * (Width - 1) + 1];
+    int top = 0;
+    stack[top++] = Entry{0, 0, ray.minT};
+
+    bool hit = false;
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.t > ray.maxT) continue;
+
+        if (entry.count > 0) {
+            for (uint32_t i = 0; i < entry.count; ++i) {
+                if (intersectPrimitive(*prims[entry.child + i], ray, isect)) {
+                    hit = true;
+                    if (any) return true;
+                }
+            }
+            continue;
+        }
+
+        // Decode every child box and test them all at once, keeping the hits sorted by distance.
+        const Node &node = nodes[entry.child];
+        SW_STAT(nodeVisits++);
+        Vec3xN<Width> lower, upper;
+        auto decode = [&](int a, FloatN<Width> &lo, FloatN<Width> &hi) {
+            const float scale = exp2i(node.exponent[a]);
+            for (int i = 0; i < Width; ++i) {
+                lo[i] = node.origin[a] + node.lower[a][i] * scale;
+                hi[i] = node.origin[a] + node.upper[a][i] * scale;
+            }
+        };
+        decode(0, lower.x, upper.x);
+        decode(1, lower.y, upper.y);
+        decode(2, lower.z, upper.z);
+        FloatN<Width> tNear;
+        const MaskN<Width> boxHits = intersectBoxN<Width>(orig, invDir, ray.minT, ray.maxT, lower, upper, tNear);
+        Entry hits[Width];
+        int numHits = 0;
+        for (int i = 0; i < Width && node.count[i] != Node::EmptyChild; ++i) {
+            if (!boxHits[i]) continue;
+            int j = numHits++;
+            for (; j > 0 && hits[j - 1].t > tNear[i]; --j) hits[j] = hits[j - 1];
+            hits[j] = Entry{node.child[i], node.count[i], tNear[i]};
+        }
+        // Farthest first, so the nearest child is popped next.
+        while (numHits > 0) stack[top++] = hits[--numHits];
+    }
+    return hit;
+}
+
+template <int Width> HierarchyQuality QuantizedBVHAccelerator<Width>::quality() const {
+    HierarchyQuality q;
+    if (nodes.empty()) return q;
+
+    AABB root;
+    for (int i = 0; i < Width && nodes[0].count[i] != Node::EmptyChild; ++i) root.extend(childBounds(nodes[0], i));
+    const float rootArea = root.surfaceArea();
+
+    struct Item {
+        uint32_t node;
+        int depth;
+        double p; // probability of a ray through the root reaching the node
+    };
+    uint64_t leafPrimitives = 0;
+    std::vector<Item> stack(1, Item{0, 1, 1.0});
+    while (!stack.empty()) {
+        const Item item = stack.back();
+        stack.pop_back();
+
+        const Node &node = nodes[item.node];
+        ++q.nodes;
+        q.maxDepth = std::max(q.maxDepth, item.depth);
+        q.sahCost += item.p;
+        for (int i = 0; i < Width && node.count[i] != Node::EmptyChild; ++i) {
+            const double p = rootArea > 0.0f ? childBounds(node, i).surfaceArea() / rootArea : 1.0;
+            if (node.count[i] > 0) {
+                ++q.leaves;
+                leafPrimitives += node.count[i];
+                q.sahCost += p * node.count[i];
+            } else {
+                stack.push_back(Item{node.child[i], item.depth + 1, p});
+            }
+        }
+    }
+    q.averageLeafSize = double(leafPrimitives) / double(q.leaves);
+    return q;
+}
+
+template class QuantizedBVHAccelerator<4>;
+template class QuantizedBVHAccelerator<8>;
+
+} // namespace sw
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swAccelerator.h"
+#include "swBVH.h"
+#include "swMemory.h"
+
+namespace sw {
+
+// Wide BVH node with its children's boxes quantized to 8 bits inside the
+// node's own box: child i spans origin + q * 2^exponent for q between
+// lower[axis][i] and upper[axis][i]. Power-of-two scales make the decoding
+// exact, and the boxes are rounded outwards so they stay conservative.
+// A 4-wide node fills one cache line, an 8-wide node two.
+template <int Width> struct alignas(CacheLineSize) QuantizedBVHNode {
+    static const uint8_t EmptyChild = 0xff; // count of unused child slots, which come last
+
+    float origin[3];
+    int8_t exponent[3];
+    uint8_t pad;
+    uint8_t lower[3][Width];
+    uint8_t upper[3][Width];
+    uint32_t child[Width]; // node index, or first primitive of a leaf
+    uint8_t count[Width];  // primitives in a leaf, 0 for interior children
+};
+
+static_assert(sizeof(QuantizedBVHNode<4>) == CacheLineSize, "4-wide nodes should fill one cache line");
+static_assert(sizeof(QuantizedBVHNode<8>) == 2 * CacheLineSize, "8-wide nodes should fill two cache lines");
+
+// Collapses a binary SAH BVH into Width-wide quantized nodes, opening the
+// child with the largest surface area until a node is full. Primitives are
+// stored in leaf order so leaves need no index indirection.
+template <int Width> class QuantizedBVHAccelerator : public Accelerator {
+  public:
+    typedef QuantizedBVHNode<Width> Node;
+
+    void build(const std::vector<std::shared_ptr<Primitive>> &primitives);
+    bool intersect(const Ray &r, Intersection &isect, bool any) const;
+    size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(Node) + prims.capacity() * sizeof(const Primitive *);
+    }
+    HierarchyQuality quality() const;
+
+  private:
+    uint32_t collapse(const BVH &bvh, uint32_t binaryNode);
+    // Node splitting a leaf too large for an 8-bit count, e.g. one forced
+    // at BVH::MaxDepth, into parts of fewer than EmptyChild primitives.
+    uint32_t splitLeaf(const AABB &bounds, uint32_t first, uint32_t count);
+
+    std::vector<Node, AlignedAllocator<Node>> nodes;
+    std::vector<const Primitive *> prims;
+};
+
+} // namespace sw
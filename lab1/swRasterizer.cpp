@@ -0,0 +1,253 @@
+#include "swRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "swKernels.h"
+#include "swParallel.h"
+
+namespace sw {
+
+namespace {
+
+// Camera rays start at the eye, so anything in front of it is visible; the
+// near plane only keeps the projection finite.
+const float NearDepth = 1e-4f;
+
+// Integer hash with good avalanche, for the sample jitter.
+inline uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+} // namespace
+
+bool Rasterizer::render(const std::vector<std::shared_ptr<Primitive>> &primitives, const Camera &camera,
+                        int samplesPerSide, unsigned numThreads) {
+    width = camera.imageWidth;
+    height = camera.imageHeight;
+    this->samplesPerSide = std::max(samplesPerSide, 1);
+    samplesPerPixel = this->samplesPerSide * this->samplesPerSide;
+
+    origin = camera.origin;
+    right = camera.right;
+    up = camera.up;
+    forward = camera.forward;
+    extentX = camera.imageExtentX;
+    extentY = camera.imageExtentY;
+    xIncr = 2.0f / static_cast<float>(width) * extentX * right;
+    yIncr = -2.0f / static_cast<float>(height) * extentY * up;
+    view = forward - extentX * right + extentY * up;
+
+    tilesX = (width + TileSize - 1) / TileSize;
+    tilesY = (height + TileSize - 1) / TileSize;
+    triangles.clear();
+    spheres.clear();
+    triangleBins.assign(static_cast<size_t>(tilesX) * tilesY, std::vector<uint32_t>());
+    sphereBins.assign(static_cast<size_t>(tilesX) * tilesY, std::vector<uint32_t>());
+
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        currentPrimitive = static_cast<uint32_t>(i);
+        if (!primitives[i]->rasterize(*this)) {
+            std::cerr << "Primitive " << i << " cannot be rasterized" << std::endl;
+            return false;
+        }
+    }
+
+    samples.assign(static_cast<size_t>(width) * height * samplesPerPixel, VisibilitySample());
+    parallelFor(0, tilesX * tilesY, [&](int tile) { renderTile(tile); }, 1, numThreads);
+    return true;
+}
+
+void Rasterizer::samplePosition(int x, int y, int s, float &sx, float &sy) const {
+    const uint32_t h = hash((static_cast<uint32_t>(y) * width + x) * samplesPerPixel + s);
+    const float jx = static_cast<float>(h & 0xffff) / 65536.0f, jy = static_cast<float>(h >> 16) / 65536.0f;
+    sx = (static_cast<float>(s % samplesPerSide) + jx) / static_cast<float>(samplesPerSide);
+    sy = (static_cast<float>(s / samplesPerSide) + jy) / static_cast<float>(samplesPerSide);
+}
+
+Vec3 Rasterizer::toCamera(const Vec3 &p) const {
+    const Vec3 d = p - origin;
+    return Vec3(d * right, d * up, d * forward);
+}
+
+void Rasterizer::addTriangle(uint32_t element, const Vec3 &a, const Vec3 &b, const Vec3 &c) {
+    const Vec3 v[3] = {toCamera(a), toCamera(b), toCamera(c)};
+    const bool in[3] = {v[0].z() >= NearDepth, v[1].z() >= NearDepth, v[2].z() >= NearDepth};
+    if (!in[0] && !in[1] && !in[2]) return;
+
+    // Screen bounds of the part in front of the near plane.
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    auto extend = [&](const Vec3 &p) {
+        const float x = (p.x() / p.z() + extentX) * static_cast<float>(width) / (2.0f * extentX);
+        const float y = (extentY - p.y() / p.z()) * static_cast<float>(height) / (2.0f * extentY);
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    };
+    for (int k = 0; k < 3; ++k) {
+        const int next = (k + 1) % 3;
+        if (in[k]) extend(v[k]);
+        if (in[k] != in[next]) {
+            const float t = (NearDepth - v[k].z()) / (v[next].z() - v[k].z());
+            extend(v[k] + t * (v[next] - v[k]));
+        }
+    }
+    Bounds bounds;
+    if (!pixelBounds(minX - 1.0f, minY - 1.0f, maxX + 1.0f, maxY + 1.0f, bounds)) return;
+
+    // Edge and depth equations in homogeneous coordinates: camera ray d
+    // crosses edge (i, j) where d . (v[i] x v[j]) changes sign and hits the
+    // plane at depth det / (d . n). Nothing is divided by vertex depths, so
+    // triangles reaching behind the eye need no clipping.
+    const Vec3 n = (v[1] - v[0]) % (v[2] - v[0]);
+    const float det = v[0] * n;
+    if (!(std::fabs(det) > 0.0f)) return; // seen edge-on, or not finite
+    const float side = det > 0.0f ? 1.0f : -1.0f;
+    RasterTriangle t;
+    t.edges[0] = pixelPlane(side * (v[1] % v[2]));
+    t.edges[1] = pixelPlane(side * (v[2] % v[0]));
+    t.edges[2] = pixelPlane(side * (v[0] % v[1]));
+    t.invDepth = pixelPlane((1.0f / det) * n);
+    t.bounds = bounds;
+    t.primitive = currentPrimitive;
+    t.element = element;
+    triangles.push_back(t);
+    bin(bounds, static_cast<uint32_t>(triangles.size() - 1), triangleBins);
+}
+
+Vec3 Rasterizer::pixelPlane(const Vec3 &w) const {
+    // The camera space ray direction through pixel position (x, y) is
+    // (-extentX + x * 2 extentX / width, extentY - y * 2 extentY / height, 1).
+    const float sx = 2.0f * extentX / static_cast<float>(width), sy = -2.0f * extentY / static_cast<float>(height);
+    return Vec3(w.x() * sx, w.y() * sy, -w.x() * extentX + w.y() * extentY + w.z());
+}
+
+void Rasterizer::addSphere(const Vec3 &center, float radius) {
+    Bounds b;
+    if (!sphereBounds(toCamera(center), radius, b)) return;
+
+    RasterSphere s;
+    s.center = center;
+    s.radius = radius;
+    s.primitive = currentPrimitive;
+    spheres.push_back(s);
+    bin(b, static_cast<uint32_t>(spheres.size() - 1), sphereBins);
+}
+
+bool Rasterizer::sphereBounds(const Vec3 &c, float radius, Bounds &b) const {
+    if (c.z() + radius < NearDepth) return false;
+    if (c.z() - radius < NearDepth) {
+        // Around the eye the silhouette can cover anything.
+        b = Bounds{0, 0, width - 1, height - 1};
+        return true;
+    }
+    // The projected corners of the sphere's box bound its silhouette.
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int k = 0; k < 8; ++k) {
+        const float cx = c.x() + ((k & 1) ? radius : -radius), cy = c.y() + ((k & 2) ? radius : -radius);
+        const float cz = c.z() + ((k & 4) ? radius : -radius);
+        const float x = (cx / cz + extentX) * static_cast<float>(width) / (2.0f * extentX);
+        const float y = (extentY - cy / cz) * static_cast<float>(height) / (2.0f * extentY);
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+    return pixelBounds(minX, minY, maxX, maxY, b);
+}
+
+bool Rasterizer::pixelBounds(float minX, float minY, float maxX, float maxY, Bounds &b) const {
+    const float w = static_cast<float>(width), h = static_cast<float>(height);
+    if (maxX < 0.0f || maxY < 0.0f || minX >= w || minY >= h) return false;
+    b = Bounds{static_cast<int>(std::max(minX, 0.0f)), static_cast<int>(std::max(minY, 0.0f)),
+               static_cast<int>(std::min(maxX, w - 1.0f)), static_cast<int>(std::min(maxY, h - 1.0f))};
+    return true;
+}
+
+void Rasterizer::bin(const Bounds &b, uint32_t item, std::vector<std::vector<uint32_t>> &bins) {
+    for (int ty = b.y0 / TileSize; ty <= b.y1 / TileSize; ++ty)
+        for (int tx = b.x0 / TileSize; tx <= b.x1 / TileSize; ++tx)
+            bins[static_cast<size_t>(ty) * tilesX + tx].push_back(item);
+}
+
+void Rasterizer::renderTile(int tile) {
+    const int tx0 = (tile % tilesX) * TileSize, ty0 = (tile / tilesX) * TileSize;
+    const int tx1 = std::min(tx0 + TileSize, width) - 1, ty1 = std::min(ty0 + TileSize, height) - 1;
+    const int tileWidth = tx1 - tx0 + 1;
+
+    // Sample positions of the tile, relative to the tile origin.
+    std::vector<float> positions(2 * static_cast<size_t>(tileWidth) * (ty1 - ty0 + 1) * samplesPerPixel);
+    for (int y = ty0; y <= ty1; ++y)
+        for (int x = tx0; x <= tx1; ++x)
+            for (int s = 0; s < samplesPerPixel; ++s) {
+                float *p = &positions[2 * ((static_cast<size_t>(y - ty0) * tileWidth + (x - tx0)) * samplesPerPixel + s)];
+                samplePosition(x, y, s, p[0], p[1]);
+                p[0] += static_cast<float>(x - tx0);
+                p[1] += static_cast<float>(y - ty0);
+            }
+    auto visit = [&](int x, int y, int s, const float *&p) -> VisibilitySample & {
+        p = &positions[2 * ((static_cast<size_t>(y - ty0) * tileWidth + (x - tx0)) * samplesPerPixel + s)];
+        return samples[(static_cast<size_t>(y) * width + x) * samplesPerPixel + s];
+    };
+
+    for (uint32_t index : triangleBins[tile]) {
+        const RasterTriangle &t = triangles[index];
+        const int x0 = std::max(tx0, t.bounds.x0), y0 = std::max(ty0, t.bounds.y0);
+        const int x1 = std::min(tx1, t.bounds.x1), y1 = std::min(ty1, t.bounds.y1);
+        for (int py = y0; py <= y1; ++py) {
+            for (int px = x0; px <= x1; ++px) {
+                for (int s = 0; s < samplesPerPixel; ++s) {
+                    const float *p;
+                    VisibilitySample &v = visit(px, py, s, p);
+                    const float x = p[0] + static_cast<float>(tx0), y = p[1] + static_cast<float>(ty0);
+                    if (t.edges[0].x() * x + t.edges[0].y() * y + t.edges[0].z() < 0.0f ||
+                        t.edges[1].x() * x + t.edges[1].y() * y + t.edges[1].z() < 0.0f ||
+                        t.edges[2].x() * x + t.edges[2].y() * y + t.edges[2].z() < 0.0f)
+                        continue;
+                    const float depth = 1.0f / (t.invDepth.x() * x + t.invDepth.y() * y + t.invDepth.z());
+                    if (depth < v.depth) {
+                        v.depth = depth;
+                        v.primitive = t.primitive;
+                        v.element = t.element;
+                    }
+                }
+            }
+        }
+    }
+
+    // Sphere impostors: every sample in the tile is intersected with the sphere exactly.
+    for (uint32_t index : sphereBins[tile]) {
+        const RasterSphere &sphere = spheres[index];
+        Bounds b;
+        if (!sphereBounds(toCamera(sphere.center), sphere.radius, b)) continue;
+        const int x0 = std::max(tx0, b.x0), y0 = std::max(ty0, b.y0);
+        const int x1 = std::min(tx1, b.x1), y1 = std::min(ty1, b.y1);
+        for (int py = y0; py <= y1; ++py) {
+            for (int px = x0; px <= x1; ++px) {
+                for (int s = 0; s < samplesPerPixel; ++s) {
+                    const float *p;
+                    VisibilitySample &v = visit(px, py, s, p);
+                    const Vec3 dir = view + (p[0] + static_cast<float>(tx0)) * xIncr +
+                                     (p[1] + static_cast<float>(ty0)) * yIncr;
+                    FloatN<1> t;
+                    if (!intersectSphereN<1>(origin, dir, 0.0f, v.depth, sphere.center, sphere.radius, t)[0])
+                        continue;
+                    if (t[0] < v.depth) {
+                        v.depth = t[0];
+                        v.primitive = sphere.primitive;
+                        v.element = 0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace sw
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "swCamera.h"
+#include "swPrimitive.h"
+
+namespace sw {
+
+// Nearest primitive seen by one sub-sample of the visibility buffer.
+struct VisibilitySample {
+    static const uint32_t None = UINT32_MAX;
+
+    float depth{FLT_MAX};     // hit distance along the camera ray of Camera::getRay
+    uint32_t primitive{None}; // index into the rasterized primitives
+    uint32_t element{0};      // triangle or cell inside the primitive, see Primitive::intersectElement
+};
+
+// CPU tile rasterizer for primary visibility. Triangles are clipped to the
+// near plane and binned to screen tiles, spheres are drawn as screen-space
+// impostors with an exact ray-sphere depth per sample, and every tile is
+// then rendered by one thread into a visibility buffer holding all
+// samplesPerSide^2 sub-samples of each pixel. Shading reconstructs the hits
+// from the buffer instead of traversing the scene.
+class Rasterizer {
+  public:
+    // Returns false if a primitive cannot be rasterized, the camera must be set up.
+    bool render(const std::vector<std::shared_ptr<Primitive>> &primitives, const Camera &camera, int samplesPerSide,
+                unsigned numThreads = 0);
+
+    const VisibilitySample &sample(int x, int y, int s) const {
+        return samples[(static_cast<size_t>(y) * width + x) * samplesPerPixel + s];
+    }
+    // Jittered position of sub-sample s inside pixel (x, y), in [0, 1)^2 and
+    // the same for every frame.
+    void samplePosition(int x, int y, int s, float &sx, float &sy) const;
+
+    // Called by Primitive::rasterize for the primitive being rasterized.
+    void addTriangle(uint32_t element, const Vec3 &a, const Vec3 &b, const Vec3 &c);
+    void addSphere(const Vec3 &center, float radius);
+
+  public:
+    static const int TileSize = 16;
+
+    int width{0}, height{0};
+    int samplesPerSide{1}, samplesPerPixel{1};
+    std::vector<VisibilitySample> samples;
+
+  private:
+    struct Bounds {
+        int x0, y0, x1, y1; // pixels, inclusive
+    };
+
+    // Triangle as linear functions of the pixel position (x, y), each
+    // evaluated as a.x * x + a.y * y + a.z: three edges that are non-negative
+    // inside and the reciprocal depth.
+    struct RasterTriangle {
+        Vec3 edges[3];
+        Vec3 invDepth;
+        Bounds bounds;
+        uint32_t primitive, element;
+    };
+
+    struct RasterSphere {
+        Vec3 center;
+        float radius;
+        uint32_t primitive;
+    };
+
+    Vec3 toCamera(const Vec3 &p) const;
+    Vec3 pixelPlane(const Vec3 &w) const;
+    bool sphereBounds(const Vec3 &center, float radius, Bounds &b) const;
+    bool pixelBounds(float minX, float minY, float maxX, float maxY, Bounds &b) const;
+    void bin(const Bounds &b, uint32_t item, std::vector<std::vector<uint32_t>> &bins);
+    void renderTile(int tile);
+
+    Vec3 origin, right, up, forward;
+    float extentX{1.0f}, extentY{1.0f};
+    Vec3 view, xIncr, yIncr; // camera ray through pixel position (x, y) is view + x * xIncr + y * yIncr
+    int tilesX{0}, tilesY{0};
+    uint32_t currentPrimitive{0};
+    std::vector<RasterTriangle> triangles;
+    std::vector<RasterSphere> spheres;
+    std::vector<std::vector<uint32_t>> triangleBins, sphereBins;
+};
+
+} // namespace sw
@@ -7,7 +7,8 @@ namespace sw {
 class Ray {
   public:
     Ray() = default;
-    Ray(const Vec3 &o, const Vec3 &d, float t0 = 0.0f, float t1 = FLT_MAX) : orig(o), dir(d), minT(t0), maxT(t1) {}
+    Ray(const Vec3 &o, const Vec3 &d, float t0 = 0.0f, float t1 = FLT_MAX, float tm = 0.0f)
+      : orig(o), dir(d), minT(t0), maxT(t1), time(tm) {}
 
     Vec3 origin() const { return orig; }
     Vec3 direction() const { return dir; }
@@ -17,6 +18,7 @@ class Ray {
     Vec3 dir;
     float minT{0.0f};
     float maxT{FLT_MAX};
+    float time{0.0f}; // when in the shutter interval [0, 1] the ray is cast, for moving primitives
 };
 
 } // namespace sw
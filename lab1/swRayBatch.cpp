@@ -0,0 +1,56 @@
+#include "swRayBatch.h"
+
+#include <algorithm>
+
+namespace sw {
+
+namespace {
+
+// Spreads the low 10 bits of v out to every third bit.
+uint32_t expandBits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+} // namespace
+
+uint32_t mortonCode(const Vec3 &p, const AABB &bounds) {
+    uint32_t code = 0;
+    for (int a = 0; a < 3; ++a) {
+        const float extent = bounds.upper[a] - bounds.lower[a];
+        const float t = extent > 0.0f ? (p[a] - bounds.lower[a]) / extent : 0.0f;
+        const uint32_t q = static_cast<uint32_t>(std::min(std::max(t * 1024.0f, 0.0f), 1023.0f));
+        code |= expandBits(q) << (2 - a);
+    }
+    return code;
+}
+
+void RayBatch::sort() {
+    if (rays.size() < 2) return;
+    AABB bounds;
+    for (const Ray &r : rays) bounds.extend(r.orig);
+
+    // Octant above the top 29 bits of the Morton code, so that the key fits
+    // in 32 bits; the position below keeps the sort stable.
+    keys.resize(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const uint32_t key = (directionOctant(rays[i].dir) << 29) | (mortonCode(rays[i].orig, bounds) >> 1);
+        keys[i] = (uint64_t(key) << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    sortedRays.resize(rays.size());
+    sortedIds.resize(ids.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const uint32_t from = static_cast<uint32_t>(keys[i]);
+        sortedRays[i] = rays[from];
+        sortedIds[i] = ids[from];
+    }
+    rays.swap(sortedRays);
+    ids.swap(sortedIds);
+}
+
+} // namespace sw
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "swAABB.h"
+#include "swRay.h"
+
+namespace sw {
+
+// Morton code of p with 10 bits per axis, relative to bounds.
+uint32_t mortonCode(const Vec3 &p, const AABB &bounds);
+
+// 0-7 from the signs of the direction components.
+inline uint32_t directionOctant(const Vec3 &d) {
+    return (d[0] < 0.0f ? 1u : 0u) | (d[1] < 0.0f ? 2u : 0u) | (d[2] < 0.0f ? 4u : 0u);
+}
+
+// Rays collected to be traced together, each tagged with an id telling the
+// caller where its result goes. sort() groups the rays by direction octant
+// and orders each group along a Morton curve through their origins, so
+// consecutive rays start close together, head the same way and mostly
+// visit the nodes and primitives the previous ray just brought into cache.
+class RayBatch {
+  public:
+    void push(const Ray &r, uint32_t id) {
+        rays.push_back(r);
+        ids.push_back(id);
+    }
+    size_t size() const { return rays.size(); }
+    bool empty() const { return rays.empty(); }
+    void clear() {
+        rays.clear();
+        ids.clear();
+    }
+    // Reorders rays and ids together.
+    void sort();
+
+  public:
+    std::vector<Ray> rays;
+    std::vector<uint32_t> ids;
+
+  private:
+    std::vector<uint64_t> keys; // sort key in the high bits, position in the low bits
+    std::vector<Ray> sortedRays;
+    std::vector<uint32_t> sortedIds;
+};
+
+} // namespace sw
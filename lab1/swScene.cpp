@@ -1,20 +1,72 @@
 #include "swScene.h"
 
+#include "swParallel.h"
+#include "swRayBatch.h"
+
 namespace sw {
 
-bool Scene::intersect(const Ray &r, Intersection &isect, bool any) {
-    bool hit = false;
-    Intersection currIsect;
-    for (auto &primitive : primitives) {
-        if (primitive->intersect(r, currIsect)) {
-            hit = true;
-            if (any) return hit;
-            if (currIsect.hitT < isect.hitT) {
-                isect = currIsect;
-            }
-        }
+namespace {
+
+const int QueryChunk = 256; // rays per parallelFor item
+
+// Runs query(ray, index) for every ray, in sorted order for incoherent
+// batches; index is always the ray's position in the caller's array.
+template <typename Query>
+void forEachRay(const Ray *rays, size_t count, RayOrder order, unsigned numThreads, Query query) {
+    const int chunks = static_cast<int>((count + QueryChunk - 1) / QueryChunk);
+    if (order == RayOrder::Coherent) {
+        parallelFor(0, chunks, [&](int c) {
+            const size_t end = std::min(count, static_cast<size_t>(c + 1) * QueryChunk);
+            for (size_t i = static_cast<size_t>(c) * QueryChunk; i < end; ++i) query(rays[i], i);
+        }, 1, numThreads);
+        return;
     }
-    return hit;
+
+    RayBatch batch;
+    batch.rays.assign(rays, rays + count);
+    batch.ids.resize(count);
+    for (size_t i = 0; i < count; ++i) batch.ids[i] = static_cast<uint32_t>(i);
+    batch.sort();
+    parallelFor(0, chunks, [&](int c) {
+        const size_t end = std::min(count, static_cast<size_t>(c + 1) * QueryChunk);
+        for (size_t i = static_cast<size_t>(c) * QueryChunk; i < end; ++i) query(batch.rays[i], batch.ids[i]);
+    }, 1, numThreads);
+}
+
+} // namespace
+
+void Scene::build(AcceleratorType type) {
+    accelerator = createAccelerator(type);
+    accelerator->build(primitives);
+    primitiveIndices.clear();
+    for (size_t i = 0; i < primitives.size(); ++i) primitiveIndices[primitives[i].get()] = static_cast<uint32_t>(i);
+}
+
+bool Scene::intersect(const Ray &r, Intersection &isect, bool any) {
+    if (!accelerator) build();
+    return accelerator->intersect(r, isect, any);
+}
+
+void Scene::intersect(const Ray *rays, size_t count, RayHit *hits, RayOrder order, unsigned numThreads) {
+    if (!accelerator) build();
+    forEachRay(rays, count, order, numThreads, [&](const Ray &r, size_t i) {
+        Intersection isect;
+        RayHit &hit = hits[i];
+        hit = RayHit();
+        if (!accelerator->intersect(r, isect, false)) return;
+        hit.t = isect.hitT;
+        hit.primitive = primitiveIndices.at(isect.primitive);
+        hit.position = isect.position;
+        hit.normal = isect.normal;
+    });
+}
+
+void Scene::occluded(const Ray *rays, size_t count, uint8_t *occluded, RayOrder order, unsigned numThreads) {
+    if (!accelerator) build();
+    forEachRay(rays, count, order, numThreads, [&](const Ray &r, size_t i) {
+        Intersection isect;
+        occluded[i] = accelerator->intersect(r, isect, true) ? 1 : 0;
+    });
 }
 
 } // namespace sw
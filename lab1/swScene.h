@@ -1,23 +1,72 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "swAccelerator.h"
+#include "swEnvironmentMap.h"
+#include "swHeightfield.h"
 #include "swIntersection.h"
+#include "swMesh.h"
 #include "swPrimitive.h"
 #include "swSphere.h"
 #include "swTriangle.h"
 
 namespace sw {
 
+// Closest hit of one ray of a batched query.
+struct RayHit {
+    static const uint32_t None = UINT32_MAX;
+
+    float t{FLT_MAX};
+    uint32_t primitive{None}; // index in the order the primitives were pushed, None on a miss
+    Vec3 position;
+    Vec3 normal; // unit length, facing the ray
+};
+
+enum class RayOrder {
+    Coherent,  // traced as given, e.g. camera rays of neighbouring pixels
+    Incoherent // sorted by direction and origin first like RayBatch, e.g. AO or bounce rays
+};
+
+// Primitives and their acceleration structure. Besides the single-ray
+// intersect() used by the renderer, arrays of rays can be queried at once:
+// the batch is split into chunks traced on all cores, so tools such as
+// bakers or picking get the accelerators without the renderer around them.
 class Scene {
   public:
     void push(const Sphere &s) { primitives.push_back(std::make_shared<Sphere>(s)); }
     void push(const Triangle &t) { primitives.push_back(std::make_shared<Triangle>(t)); }
+    void push(Heightfield &&h) { primitives.push_back(std::make_shared<Heightfield>(std::move(h))); }
+    void push(Mesh &&m) { primitives.push_back(std::make_shared<Mesh>(std::move(m))); }
+    void push(std::shared_ptr<Primitive> p) { primitives.push_back(std::move(p)); }
+    // Builds the acceleration structure over the pushed primitives; call it
+    // after the last push and before tracing from several threads.
+    void build(AcceleratorType type = AcceleratorType::BVH);
     bool intersect(const Ray &r, Intersection &isect, bool any = false);
 
+    // Closest hits of count rays, written to hits in the order of rays.
+    void intersect(const Ray *rays, size_t count, RayHit *hits, RayOrder order = RayOrder::Coherent,
+                   unsigned numThreads = 0);
+    // occluded[i] is 1 if anything lies on ray i between its minT and maxT, 0 otherwise.
+    void occluded(const Ray *rays, size_t count, uint8_t *occluded, RayOrder order = RayOrder::Coherent,
+                  unsigned numThreads = 0);
+    size_t size() const { return primitives.size(); }
+    const std::vector<std::shared_ptr<Primitive>> &getPrimitives() const { return primitives; }
+    const Accelerator *getAccelerator() const { return accelerator.get(); }
+    Color background(const Vec3 &dir) const {
+        return environment.valid() ? environment.lookup(dir) : Color(0.0f, 0.0f, 0.0f);
+    }
+
+  public:
+    EnvironmentMap environment;
+
   private:
     std::vector<std::shared_ptr<Primitive>> primitives;
+    std::unique_ptr<Accelerator> accelerator;
+    std::unordered_map<const Primitive *, uint32_t> primitiveIndices;
 };
 
 } // namespace sw
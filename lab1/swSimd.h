@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SW_SSE 1
+#include <emmintrin.h>
+#else
+#define SW_SSE 0
+#endif
+
+#include "swVec3.h"
+
+namespace sw {
+
+// N float lanes. The operations are plain loops over the lanes, which the
+// compiler turns into SSE, AVX or AVX-512 code depending on the target (see
+// the SWTRACER_NATIVE CMake option), so every width shares one code path.
+template <int N> struct FloatN {
+    FloatN() = default;
+    FloatN(float a) {
+        for (int i = 0; i < N; ++i) v[i] = a;
+    }
+
+    float operator[](int i) const { return v[i]; }
+    float &operator[](int i) { return v[i]; }
+
+    alignas(sizeof(float) * N) float v[N];
+};
+
+// Per-lane condition, all bits set for true lanes.
+template <int N> struct MaskN {
+    bool operator[](int i) const { return m[i] != 0; }
+
+    alignas(sizeof(int32_t) * N) int32_t m[N];
+};
+
+#define SW_LANEWISE_OP(op)                                                                                             \
+    template <int N> inline FloatN<N> operator op(const FloatN<N> &a, const FloatN<N> &b) {                           \
+        FloatN<N> r;                                                                                                   \
+        for (int i = 0; i < N; ++i) r.v[i] = a.v[i] op b.v[i];                                                         \
+        return r;                                                                                                      \
+    }
+SW_LANEWISE_OP(+)
+SW_LANEWISE_OP(-)
+SW_LANEWISE_OP(*)
+SW_LANEWISE_OP(/)
+#undef SW_LANEWISE_OP
+
+#define SW_LANEWISE_CMP(op)                                                                                            \
+    template <int N> inline MaskN<N> operator op(const FloatN<N> &a, const FloatN<N> &b) {                            \
+        MaskN<N> r;                                                                                                    \
+        for (int i = 0; i < N; ++i) r.m[i] = a.v[i] op b.v[i] ? -1 : 0;                                                \
+        return r;                                                                                                      \
+    }
+SW_LANEWISE_CMP(<)
+SW_LANEWISE_CMP(<=)
+SW_LANEWISE_CMP(>)
+SW_LANEWISE_CMP(>=)
+#undef SW_LANEWISE_CMP
+
+template <int N> inline FloatN<N> operator-(const FloatN<N> &a) {
+    FloatN<N> r;
+    for (int i = 0; i < N; ++i) r.v[i] = -a.v[i];
+    return r;
+}
+
+template <int N> inline MaskN<N> operator&(const MaskN<N> &a, const MaskN<N> &b) {
+    MaskN<N> r;
+    for (int i = 0; i < N; ++i) r.m[i] = a.m[i] & b.m[i];
+    return r;
+}
+
+template <int N> inline MaskN<N> operator|(const MaskN<N> &a, const MaskN<N> &b) {
+    MaskN<N> r;
+    for (int i = 0; i < N; ++i) r.m[i] = a.m[i] | b.m[i];
+    return r;
+}
+
+template <int N> inline bool any(const MaskN<N> &a) {
+    int32_t r = 0;
+    for (int i = 0; i < N; ++i) r |= a.m[i];
+    return r != 0;
+}
+
+template <int N> inline FloatN<N> select(const MaskN<N> &m, const FloatN<N> &a, const FloatN<N> &b) {
+    FloatN<N> r;
+    for (int i = 0; i < N; ++i) r.v[i] = m.m[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+template <int N> inline FloatN<N> min(const FloatN<N> &a, const FloatN<N> &b) {
+    FloatN<N> r;
+    for (int i = 0; i < N; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+template <int N> inline FloatN<N> max(const FloatN<N> &a, const FloatN<N> &b) {
+    FloatN<N> r;
+    for (int i = 0; i < N; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+template <int N> inline FloatN<N> sqrt(const FloatN<N> &a) {
+    FloatN<N> r;
+    for (int i = 0; i < N; ++i) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+// N 3D vectors in structure-of-arrays layout, one lane per ray or primitive.
+template <int N> struct Vec3xN {
+    Vec3xN() = default;
+    Vec3xN(const FloatN<N> &x, const FloatN<N> &y, const FloatN<N> &z) : x(x), y(y), z(z) {}
+    // The same vector in every lane.
+    Vec3xN(const Vec3 &a) : x(a[0]), y(a[1]), z(a[2]) {}
+
+    Vec3 get(int i) const { return Vec3(x.v[i], y.v[i], z.v[i]); }
+    void set(int i, const Vec3 &a) {
+        x.v[i] = a[0];
+        y.v[i] = a[1];
+        z.v[i] = a[2];
+    }
+
+    FloatN<N> x, y, z;
+};
+
+template <int N> inline Vec3xN<N> operator+(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+template <int N> inline Vec3xN<N> operator-(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+template <int N> inline Vec3xN<N> operator*(const FloatN<N> &s, const Vec3xN<N> &a) {
+    return Vec3xN<N>(s * a.x, s * a.y, s * a.z);
+}
+
+template <int N> inline FloatN<N> dot(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template <int N> inline Vec3xN<N> cross(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+template <int N> inline Vec3xN<N> normalize(const Vec3xN<N> &a) { return (FloatN<N>(1.0f) / sqrt(dot(a, a))) * a; }
+
+template <int N> inline Vec3xN<N> min(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z));
+}
+
+template <int N> inline Vec3xN<N> max(const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z));
+}
+
+template <int N> inline Vec3xN<N> select(const MaskN<N> &m, const Vec3xN<N> &a, const Vec3xN<N> &b) {
+    return Vec3xN<N>(select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z));
+}
+
+// A single 3D vector in one 16-byte SSE register (fourth lane unused), for
+// the per-ray code that keeps using the same vectors, like the slab tests
+// of BVH traversal. Falls back to scalar code without SSE.
+struct alignas(16) Vec3A {
+#if SW_SSE
+    Vec3A() : v(_mm_setzero_ps()) {}
+    explicit Vec3A(__m128 v) : v(v) {}
+    Vec3A(float x, float y, float z) : v(_mm_setr_ps(x, y, z, 0.0f)) {}
+    Vec3A(const Vec3 &a) : v(_mm_setr_ps(a.m[0], a.m[1], a.m[2], 0.0f)) {}
+
+    float operator[](int i) const {
+        alignas(16) float f[4];
+        _mm_store_ps(f, v);
+        return f[i];
+    }
+
+    __m128 v;
+#else
+    Vec3A() : m{0.0f, 0.0f, 0.0f, 0.0f} {}
+    Vec3A(float x, float y, float z) : m{x, y, z, 0.0f} {}
+    Vec3A(const Vec3 &a) : m{a.m[0], a.m[1], a.m[2], 0.0f} {}
+
+    float operator[](int i) const { return m[i]; }
+
+    float m[4];
+#endif
+};
+
+#if SW_SSE
+inline Vec3A operator+(const Vec3A &a, const Vec3A &b) { return Vec3A(_mm_add_ps(a.v, b.v)); }
+inline Vec3A operator-(const Vec3A &a, const Vec3A &b) { return Vec3A(_mm_sub_ps(a.v, b.v)); }
+inline Vec3A operator*(const Vec3A &a, const Vec3A &b) { return Vec3A(_mm_mul_ps(a.v, b.v)); }
+inline Vec3A min(const Vec3A &a, const Vec3A &b) { return Vec3A(_mm_min_ps(a.v, b.v)); }
+inline Vec3A max(const Vec3A &a, const Vec3A &b) { return Vec3A(_mm_max_ps(a.v, b.v)); }
+
+// Largest and smallest of the x, y and z lanes.
+inline float maxComponent(const Vec3A &a) {
+    const __m128 yzx = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 zxy = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 1, 0, 2));
+    return _mm_cvtss_f32(_mm_max_ss(a.v, _mm_max_ss(yzx, zxy)));
+}
+
+inline float minComponent(const Vec3A &a) {
+    const __m128 yzx = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 zxy = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 1, 0, 2));
+    return _mm_cvtss_f32(_mm_min_ss(a.v, _mm_min_ss(yzx, zxy)));
+}
+
+inline float dot(const Vec3A &a, const Vec3A &b) {
+    const __m128 p = _mm_mul_ps(a.v, b.v);
+    const __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 1));
+    const __m128 z = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 2));
+    return _mm_cvtss_f32(_mm_add_ss(p, _mm_add_ss(y, z)));
+}
+
+inline Vec3A cross(const Vec3A &a, const Vec3A &b) {
+    const __m128 aYzx = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 bYzx = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(a.v, bYzx), _mm_mul_ps(aYzx, b.v));
+    return Vec3A(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+}
+#else
+inline Vec3A operator+(const Vec3A &a, const Vec3A &b) { return Vec3A(a.m[0] + b.m[0], a.m[1] + b.m[1], a.m[2] + b.m[2]); }
+inline Vec3A operator-(const Vec3A &a, const Vec3A &b) { return Vec3A(a.m[0] - b.m[0], a.m[1] - b.m[1], a.m[2] - b.m[2]); }
+inline Vec3A operator*(const Vec3A &a, const Vec3A &b) { return Vec3A(a.m[0] * b.m[0], a.m[1] * b.m[1], a.m[2] * b.m[2]); }
+
+inline Vec3A min(const Vec3A &a, const Vec3A &b) {
+    return Vec3A(std::fmin(a.m[0], b.m[0]), std::fmin(a.m[1], b.m[1]), std::fmin(a.m[2], b.m[2]));
+}
+
+inline Vec3A max(const Vec3A &a, const Vec3A &b) {
+    return Vec3A(std::fmax(a.m[0], b.m[0]), std::fmax(a.m[1], b.m[1]), std::fmax(a.m[2], b.m[2]));
+}
+
+inline float maxComponent(const Vec3A &a) { return std::fmax(a.m[0], std::fmax(a.m[1], a.m[2])); }
+inline float minComponent(const Vec3A &a) { return std::fmin(a.m[0], std::fmin(a.m[1], a.m[2])); }
+inline float dot(const Vec3A &a, const Vec3A &b) { return a.m[0] * b.m[0] + a.m[1] * b.m[1] + a.m[2] * b.m[2]; }
+
+inline Vec3A cross(const Vec3A &a, const Vec3A &b) {
+    return Vec3A(a.m[1] * b.m[2] - a.m[2] * b.m[1], a.m[2] * b.m[0] - a.m[0] * b.m[2], a.m[0] * b.m[1] - a.m[1] * b.m[0]);
+}
+#endif
+
+inline Vec3A normalize(const Vec3A &a) {
+    const float l = 1.0f / std::sqrt(dot(a, a));
+    return a * Vec3A(l, l, l);
+}
+
+} // namespace sw
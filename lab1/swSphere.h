@@ -9,15 +9,31 @@ namespace sw {
 class Sphere : public Primitive {
   public:
     Sphere() = default;
-    Sphere(const Vec3 &c, const float &r, const Material &m) : center(c), radius(r), material(m) {}
+    Sphere(const Vec3 &c, const float &r, const Material &m) : center(c), endCenter(c), radius(r), material(m) {}
+    // Moving from c0 at shutter time 0 to c1 at time 1.
+    Sphere(const Vec3 &c0, const Vec3 &c1, float r, const Material &m)
+      : center(c0), endCenter(c1), radius(r), material(m) {}
     Sphere(const Sphere &s) = default;
     Sphere(Sphere &&) = default;
     Sphere &operator=(Sphere &&) = default;
 
     bool intersect(const Ray &r, Intersection &isect) const;
+    AABB bounds() const {
+        AABB b = boundsAt(0.0f);
+        b.extend(boundsAt(1.0f));
+        return b;
+    }
+    bool moving() const { return center[0] != endCenter[0] || center[1] != endCenter[1] || center[2] != endCenter[2]; }
+    AABB boundsAt(float time) const {
+        const Vec3 c = centerAt(time), r(radius, radius, radius);
+        return AABB(c - r, c + r);
+    }
+    Vec3 centerAt(float time) const { return (1.0f - time) * center + time * endCenter; }
+    // Only static spheres, the rasterizer has no notion of time.
+    bool rasterize(Rasterizer &r) const;
 
   public:
-    Vec3 center;
+    Vec3 center, endCenter;
     float radius{0.0f};
     Material material;
 };
@@ -0,0 +1,135 @@
+#include "swStats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#include "stb_image_write.h"
+
+namespace sw {
+
+namespace {
+
+std::mutex totalsMutex;
+StatCounters totals;
+
+} // namespace
+
+#if SW_STATS
+thread_local StatCounters threadCounters;
+
+void flushThreadStats() {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totals.add(threadCounters);
+    threadCounters = StatCounters();
+}
+#endif
+
+const char *rayTypeName(RayType type) {
+    switch (type) {
+    case RayType::Primary: return "primary";
+    case RayType::Shadow: return "shadow";
+    case RayType::Reflect: return "reflect";
+    case RayType::Refract: return "refract";
+    }
+    return "unknown";
+}
+
+void StatCounters::add(const StatCounters &c) {
+    for (int t = 0; t < NumRayTypes; ++t) {
+        rays[t] += c.rays[t];
+        hits[t] += c.hits[t];
+    }
+    nodeVisits += c.nodeVisits;
+    primitiveTests += c.primitiveTests;
+}
+
+uint64_t StatCounters::totalRays() const {
+    uint64_t n = 0;
+    for (uint64_t r : rays) n += r;
+    return n;
+}
+
+StatCounters collectStats() {
+    flushThreadStats();
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    return totals;
+}
+
+void resetStats() {
+    flushThreadStats();
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totals = StatCounters();
+}
+
+bool writeStatsJson(const std::string &path, const StatsReport &report) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not create " << path << std::endl;
+        return false;
+    }
+    auto ratio = [](double a, double b) { return b > 0.0 ? a / b : 0.0; };
+
+    out << "{\n";
+    out << "  \"image\": {\"width\": " << report.width << ", \"height\": " << report.height
+        << ", \"samplesPerPixel\": " << report.samplesPerPixel << "},\n";
+    out << "  \"threads\": " << report.threads << ",\n";
+    out << "  \"renderSeconds\": " << report.renderSeconds << ",\n";
+
+    const HierarchyQuality &q = report.quality;
+    out << "  \"accelerator\": {\"name\": \"" << report.accelerator << "\", \"buildSeconds\": " << report.buildSeconds
+        << ", \"bytes\": " << report.acceleratorBytes << ", \"nodes\": " << q.nodes << ", \"leaves\": " << q.leaves
+        << ", \"maxDepth\": " << q.maxDepth << ", \"averageLeafSize\": " << q.averageLeafSize
+        << ", \"sahCost\": " << q.sahCost << "},\n";
+
+    out << "  \"counters\": ";
+    if (SW_STATS) {
+        const StatCounters &c = report.counters;
+        const double rays = static_cast<double>(c.totalRays());
+        out << "{\n    \"rays\": {";
+        for (int t = 0; t < NumRayTypes; ++t) {
+            out << (t ? ", " : "") << "\"" << rayTypeName(static_cast<RayType>(t)) << "\": {\"count\": " << c.rays[t]
+                << ", \"hits\": " << c.hits[t] << ", \"hitRate\": " << ratio(double(c.hits[t]), double(c.rays[t]))
+                << "}";
+        }
+        out << "},\n";
+        out << "    \"raysPerSecond\": " << ratio(rays, report.renderSeconds) << ",\n";
+        out << "    \"nodeVisits\": " << c.nodeVisits << ", \"nodeVisitsPerRay\": " << ratio(double(c.nodeVisits), rays)
+            << ",\n";
+        out << "    \"primitiveTests\": " << c.primitiveTests
+            << ", \"primitiveTestsPerRay\": " << ratio(double(c.primitiveTests), rays) << "\n  },\n";
+    } else {
+        out << "null,\n";
+    }
+
+    const TileTimes &tiles = report.tiles;
+    out << "  \"tiles\": {\"size\": " << tiles.tileSize << ", \"columns\": " << tiles.columns
+        << ", \"rows\": " << tiles.rows << ", \"seconds\": [";
+    for (size_t i = 0; i < tiles.seconds.size(); ++i) out << (i ? ", " : "") << tiles.seconds[i];
+    out << "]}\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool writeTileHeatmap(const std::string &path, const TileTimes &tiles, int width, int height) {
+    if (tiles.seconds.empty()) return false;
+    const auto range = std::minmax_element(tiles.seconds.begin(), tiles.seconds.end());
+    const double lo = *range.first, span = std::max(*range.second - lo, 1e-12);
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int tile = (y / tiles.tileSize) * tiles.columns + x / tiles.tileSize;
+            const float t = static_cast<float>((tiles.seconds[tile] - lo) / span);
+            uint8_t *p = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+            for (int c = 0; c < 3; ++c) p[c] = static_cast<uint8_t>(255.0f * std::min(std::max(3.0f * t - c, 0.0f), 1.0f));
+        }
+    }
+    if (!stbi_write_png(path.c_str(), width, height, 3, pixels.data(), width * 3)) {
+        std::cerr << "Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace sw
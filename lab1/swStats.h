@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Event counters are compiled in unless SW_STATS is defined to 0, see the
+// SWTRACER_STATS CMake option.
+#ifndef SW_STATS
+#define SW_STATS 1
+#endif
+
+namespace sw {
+
+enum class RayType { Primary, Shadow, Reflect, Refract };
+const int NumRayTypes = 4;
+const char *rayTypeName(RayType type);
+
+// Event counts of one thread, or summed over all threads.
+struct StatCounters {
+    uint64_t rays[NumRayTypes]{};
+    uint64_t hits[NumRayTypes]{}; // occluded for shadow rays
+    uint64_t nodeVisits{0};       // BVH/kd-tree nodes, grid cells and heightfield quadtree nodes
+    uint64_t primitiveTests{0};   // includes the triangles tested inside meshes and heightfields
+
+    void add(const StatCounters &c);
+    uint64_t totalRays() const;
+};
+
+#if SW_STATS
+// Plain thread-local counters, so counting is a single add; parallelFor
+// flushes them into the totals when a worker finishes.
+extern thread_local StatCounters threadCounters;
+#define SW_STAT(expr) (::sw::threadCounters.expr)
+inline void countRay(RayType type, bool hit) {
+    ++threadCounters.rays[static_cast<int>(type)];
+    threadCounters.hits[static_cast<int>(type)] += hit ? 1 : 0;
+}
+void flushThreadStats();
+#else
+#define SW_STAT(expr) ((void)0)
+inline void countRay(RayType, bool) {}
+inline void flushThreadStats() {}
+#endif
+
+// Totals of all flushed threads, after flushing the calling one.
+StatCounters collectStats();
+void resetStats();
+
+// Shape of an accelerator's hierarchy. sahCost is the expected cost of a
+// random ray hitting the root, counting 1 per node visit and 1 per
+// primitive test; zero for accelerators without a tree.
+struct HierarchyQuality {
+    uint64_t nodes{0};
+    uint64_t leaves{0};
+    int maxDepth{0};
+    double averageLeafSize{0.0};
+    double sahCost{0.0};
+};
+
+// Wall-clock render time of every tile, row by row.
+struct TileTimes {
+    int tileSize{0}, columns{0}, rows{0};
+    std::vector<double> seconds;
+};
+
+// Everything written to the JSON report.
+struct StatsReport {
+    int width{0}, height{0}, samplesPerPixel{0}, threads{0};
+    std::string accelerator;
+    double buildSeconds{0.0}, renderSeconds{0.0};
+    size_t acceleratorBytes{0};
+    HierarchyQuality quality;
+    StatCounters counters;
+    TileTimes tiles;
+};
+
+bool writeStatsJson(const std::string &path, const StatsReport &report);
+// Image-sized PNG with every tile coloured by its render time, black for
+// the fastest through red and yellow to white for the slowest.
+bool writeTileHeatmap(const std::string &path, const TileTimes &tiles, int width, int height);
+
+} // namespace sw
@@ -1,53 +1,32 @@
 #include "swTriangle.h"
-#include <iostream>
+
+#include "swKernels.h"
+#include "swRasterizer.h"
 
 namespace sw {
 
 bool Triangle::intersect(const Ray &ray, Intersection &isect) const {
-    
-    const Vec3 v0 = vertices[0];
-    const Vec3 v1 = vertices[1];
-    const Vec3 v2 = vertices[2];
-    
-    const Vec3 e1 = v1 - v0;
-    const Vec3 e2 = v2 - v0;
-    
-    auto n = e1 % e2;
-    auto m = -n * v0;
-    
-    const Vec3 P = ray.orig;
-    const Vec3 d = ray.dir;
-    
-    float t = (n * P + m) / (-n * d);
-    
-    const Vec3 Q = P + t*d;
-    
-    if (t < ray.minT || t > ray.maxT) return false;
-    
-    auto R = Q - v0;
-    
-    auto e1r = e1 % R;
-    
-    auto re2 = R % e2;
-    
-    auto v = sqrt(e1r * e1r) / sqrt(n * n);
-    
-    auto w = sqrt(re2 * re2) / sqrt(n * n);
-    
-    if ((e1 % R) * n >= 0.0f &&
-        (R % e2) * n >= 0.0f &&
-        v + w < 1.0f) {
-        isect.hitT = t;
-        isect.normal = n;
-        isect.normal.normalize();
-        isect.frontFacing = (-d * isect.normal) > 0.0f;
-        if (!isect.frontFacing) isect.normal = -isect.normal;
-        isect.position = Q;
-        isect.material = material;
-        isect.ray = ray;
-        return true;
-    }
-    return !true;
+    FloatN<1> t;
+    Vec3xN<1> n;
+    const Vec3 a = vertexAt(0, ray.time), b = vertexAt(1, ray.time), c = vertexAt(2, ray.time);
+    if (!intersectTriangleN<1>(ray.orig, ray.dir, ray.minT, ray.maxT, a, b, c, t, n)[0]) return false;
+
+    const Vec3 &d = ray.dir;
+    isect.hitT = t[0];
+    isect.normal = n.get(0);
+    isect.normal.normalize();
+    isect.frontFacing = (-d * isect.normal) > 0.0f;
+    if (!isect.frontFacing) isect.normal = -isect.normal;
+    isect.position = ray.orig + isect.hitT * d;
+    isect.material = material;
+    isect.ray = ray;
+    return true;
+}
+
+bool Triangle::rasterize(Rasterizer &r) const {
+    if (moving()) return false;
+    r.addTriangle(0, vertices[0], vertices[1], vertices[2]);
+    return true;
 }
 
 } // namespace sw
@@ -12,14 +12,35 @@ class Triangle : public Primitive {
   public:
     Triangle() = default;
     Triangle(const Vec3 *v, const Material &m) : vertices(v), material(m) {}
+    // Vertices v0 at shutter time 0, moving linearly to v1 at time 1.
+    Triangle(const Vec3 *v0, const Vec3 *v1, const Material &m) : vertices(v0), endVertices(v1), material(m) {}
     Triangle(const Triangle &t) = default;
     Triangle(Triangle &&) = default;
     Triangle &operator=(Triangle &&) = default;
 
     bool intersect(const Ray &r, Intersection &isect) const;
+    AABB bounds() const {
+        AABB b;
+        for (int i = 0; i < 3; ++i) b.extend(vertices[i]);
+        if (endVertices)
+            for (int i = 0; i < 3; ++i) b.extend(endVertices[i]);
+        return b;
+    }
+    bool moving() const { return endVertices != nullptr; }
+    AABB boundsAt(float time) const {
+        AABB b;
+        for (int i = 0; i < 3; ++i) b.extend(vertexAt(i, time));
+        return b;
+    }
+    Vec3 vertexAt(int i, float time) const {
+        return endVertices ? (1.0f - time) * vertices[i] + time * endVertices[i] : vertices[i];
+    }
+    // Only static triangles, the rasterizer has no notion of time.
+    bool rasterize(Rasterizer &r) const;
 
   public:
     const Vec3 *vertices;
+    const Vec3 *endVertices{nullptr};
     Material material;
 };
 
@@ -71,4 +71,7 @@ class Vec3 {
 
 using Color = Vec3; // RGB color
 
+// Component-wise product, e.g. to filter light by a surface color.
+inline Vec3 mul(const Vec3 &a, const Vec3 &b) { return Vec3(a[0] * b[0], a[1] * b[1], a[2] * b[2]); }
+
 } // namespace sw